@@ -0,0 +1,88 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <memory>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define SIMD_ALIGNMENT          32
+
+/******************************************************************************
+*                                                                             *
+*                               AlignedAllocator     (class)                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Allocator handing out blocks aligned to Alignment bytes (a whole vector    *
+*  register by default), so that arrays of splat attributes can be streamed   *
+*  with aligned SIMD loads. Otherwise behaves as std::allocator.              *
+*                                                                             *
+*******************************************************************************/
+template <typename T, size_t Alignment = SIMD_ALIGNMENT>
+class AlignedAllocator : public std::allocator<T>
+{
+
+public:
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	// Constructors.
+	AlignedAllocator()
+	{
+	}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&)
+	{
+	}
+
+	// Allocate room for n objects, throwing std::bad_alloc on failure.
+	T* allocate(size_t n, const void* = 0)
+	{
+		if (n == 0)
+			return NULL;
+		void* block = NULL;
+#ifdef _WIN32
+		block = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+		if (posix_memalign(&block, Alignment, n * sizeof(T)) != 0)
+			block = NULL;
+#endif
+		if (block == NULL)
+			throw std::bad_alloc();
+		return (T*)block;
+	}
+
+	// Free a block from allocate().
+	void deallocate(T* block, size_t)
+	{
+#ifdef _WIN32
+		_aligned_free(block);
+#else
+		free(block);
+#endif
+	}
+
+};
+
+// A vector whose storage is SIMD-aligned.
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T> >;
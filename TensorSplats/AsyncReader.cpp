@@ -0,0 +1,817 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "AsyncReader.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+// The ring is driven through the raw system calls, so only the kernel headers
+// are needed. Define NO_IO_URING to always use the reader threads.
+#if defined(__linux__) && !defined(NO_IO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+	defined(__NR_io_uring_register)
+#define USE_IO_URING
+#endif
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                                  IoRing     (struct)                        *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  fd                                                                         *
+*           The io_uring instance.                                            *
+*  sq_map, cq_map, sqes                                                       *
+*           The shared submission ring, completion ring and submission        *
+*           entries, and the number of bytes mapped for each.                 *
+*  sq_head, sq_tail, sq_mask, sq_array                                        *
+*           Fields of the submission ring.                                    *
+*  cq_head, cq_tail, cq_mask, cqes                                            *
+*           Fields of the completion ring.                                    *
+*  fixed                                                                      *
+*           Whether the block buffers are registered with the ring; if not,   *
+*           each read passes its buffer in iovs.                              *
+*  pending                                                                    *
+*           Entries written to the submission ring but not yet submitted.     *
+*  reads, busy                                                                *
+*           On Windows, the overlapped read of each block buffer and whether  *
+*           it is in flight.                                                  *
+*                                                                             *
+*******************************************************************************/
+struct IoRing
+{
+
+#ifdef USE_IO_URING
+	int                   fd;
+	void*                 sq_map;
+	size_t                sq_map_bytes;
+	void*                 cq_map;
+	size_t                cq_map_bytes;
+	io_uring_sqe*         sqes;
+	size_t                sqes_bytes;
+	unsigned*             sq_head;
+	unsigned*             sq_tail;
+	unsigned              sq_mask;
+	unsigned*             sq_array;
+	unsigned*             cq_head;
+	unsigned*             cq_tail;
+	unsigned              cq_mask;
+	io_uring_cqe*         cqes;
+	bool                  fixed;
+	std::vector<iovec>    iovs;
+	unsigned              pending;
+#endif
+
+#ifdef _WIN32
+	std::vector<OVERLAPPED>  reads;
+	std::vector<bool>        busy;
+#endif
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                  read_at                                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file                                                                       *
+*           Operating system handle of the file.                              *
+*  dst                                                                        *
+*           Buffer receiving the bytes.                                       *
+*  bytes                                                                      *
+*           Number of bytes to read.                                          *
+*  pos                                                                        *
+*           Byte offset in the file of the first byte.                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if every byte was read, false on an error or the end of the file.     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads at an explicit offset without moving a shared file position, so any  *
+*  number of threads may read the same handle at once. On Windows the file is *
+*  opened for overlapped reads, so each read waits for its own completion.    *
+*                                                                             *
+*******************************************************************************/
+static bool read_at(intptr_t file, unsigned char* dst, size_t bytes, uint64_t pos)
+{
+	while (bytes > 0)
+	{
+		size_t want = (bytes < ((size_t)1 << 30)) ? bytes : ((size_t)1 << 30);
+#ifdef _WIN32
+		OVERLAPPED at;
+		memset(&at, 0, sizeof(at));
+		at.Offset     = (DWORD)pos;
+		at.OffsetHigh = (DWORD)(pos >> 32);
+		at.hEvent     = CreateEventA(NULL, TRUE, FALSE, NULL);
+		DWORD got = 0;
+		bool ok = (at.hEvent != NULL) &&
+			(ReadFile((HANDLE)file, dst, (DWORD)want, NULL, &at) ||
+			GetLastError() == ERROR_IO_PENDING) &&
+			GetOverlappedResult((HANDLE)file, &at, &got, TRUE);
+		if (at.hEvent != NULL)
+			CloseHandle(at.hEvent);
+		if (!ok || got == 0)
+			return false;
+#else
+		ssize_t got = pread((int)file, dst, want, (off_t)pos);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			return false;
+#endif
+		dst   += got;
+		bytes -= got;
+		pos   += got;
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::AsyncReader                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the AsyncReader object. Nothing is read until       *
+*  open() is called.                                                          *
+*                                                                             *
+*******************************************************************************/
+AsyncReader::AsyncReader() :
+file(-1), ring(NULL), offset(0), length(0), block_bytes(0), num_blocks(0),
+issued(0), released(0), holding(false), in_flight(0), failed(false),
+stopping(false)
+{
+}
+AsyncReader::~AsyncReader()
+{
+	close();
+}
+
+/******************************************************************************
+*                                                                             *
+*                             AsyncReader::open                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file_path                                                                  *
+*           Path to the file to read.                                         *
+*  offset                                                                     *
+*           Byte offset of the range to read.                                 *
+*  length                                                                     *
+*           Number of bytes in the range.                                     *
+*  block_bytes                                                                *
+*           Size of the blocks the range is read and handed out in.           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the file was opened and the first reads started, false otherwise.  *
+*                                                                             *
+*******************************************************************************/
+bool AsyncReader::open(const std::string& file_path, uint64_t offset,
+	uint64_t length, size_t block_bytes)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN |
+		FILE_FLAG_OVERLAPPED, NULL);
+	file = (handle == INVALID_HANDLE_VALUE) ? -1 : (intptr_t)handle;
+#else
+	file = ::open(file_path.c_str(), O_RDONLY);
+#endif
+	if (file == -1)
+	{
+		fprintf(stderr, "\nError opening file %s\n", file_path.c_str());
+		return false;
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise((int)file, (off_t)offset, (off_t)length, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	// A single read's length must fit in 32 bits.
+	if (block_bytes == 0)
+		block_bytes = ASYNC_READ_BLOCK_BYTES;
+	if (block_bytes > ((size_t)1 << 30))
+		block_bytes = (size_t)1 << 30;
+
+	this->offset      = offset;
+	this->length      = length;
+	this->block_bytes = block_bytes;
+	num_blocks        = (length + block_bytes - 1) / block_bytes;
+	issued            = 0;
+	released          = 0;
+	holding           = false;
+	in_flight         = 0;
+	failed            = false;
+	stopping          = false;
+
+	// No more buffers than blocks.
+	size_t depth = (num_blocks < ASYNC_READ_DEPTH) ? (size_t)num_blocks : ASYNC_READ_DEPTH;
+	slots.resize(depth);
+	for (size_t s = 0; s < depth; s++)
+	{
+		slots[s].buffer.resize((length < block_bytes) ? (size_t)length : block_bytes);
+		slots[s].block = 0;
+		slots[s].done  = 0;
+		slots[s].ready = false;
+	}
+	if (depth == 0)
+		return true;
+
+	if (start_ring())
+		readers.push_back(std::thread(&AsyncReader::ring_loop, this));
+	else
+	{
+		size_t count = (depth < ASYNC_READ_THREADS) ? depth : ASYNC_READ_THREADS;
+		for (size_t t = 0; t < count; t++)
+			readers.push_back(std::thread(&AsyncReader::read_loop, this));
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             AsyncReader::close                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Waits for the reads in flight, stops the reader threads or the ring,       *
+*  closes the file and frees the block buffers.                               *
+*                                                                             *
+*******************************************************************************/
+void AsyncReader::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	for (size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+	readers.clear();
+	stop_ring();
+
+	if (file != -1)
+	{
+#ifdef _WIN32
+		CloseHandle((HANDLE)file);
+#else
+		::close((int)file);
+#endif
+		file = -1;
+	}
+
+	std::vector<Slot>().swap(slots);
+	num_blocks = 0;
+	issued     = 0;
+	released   = 0;
+	holding    = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             AsyncReader::next                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  bytes                                                                      *
+*           Receives the length of the block, or 0.                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The next block of the range, or NULL at its end or after a failed read.    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gives back the block handed out by the previous call, whose buffer is then *
+*  reused for a block further along, and waits until the following block has  *
+*  been read in full. The reads themselves are made by the reader's own       *
+*  threads, so the caller does nothing here but wait.                         *
+*                                                                             *
+*******************************************************************************/
+const void* AsyncReader::next(size_t& bytes)
+{
+	bytes = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (holding)
+	{
+		slots[released % slots.size()].ready = false;
+		released++;
+		holding = false;
+		changed.notify_all();
+	}
+	if (released >= num_blocks || failed)
+		return NULL;
+
+	Slot& slot = slots[released % slots.size()];
+	while (!failed && !(slot.ready && slot.block == released))
+		changed.wait(lock);
+	if (failed)
+		return NULL;
+
+	holding = true;
+	bytes = block_length(released);
+	return &slot.buffer[0];
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::evict_cached                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file_path                                                                  *
+*           Path to the file whose cached pages are dropped.                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the cache was asked to drop the file, false if it cannot be.       *
+*                                                                             *
+*******************************************************************************/
+bool AsyncReader::evict_cached(const std::string& file_path)
+{
+#ifdef POSIX_FADV_DONTNEED
+	int fd = ::open(file_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	::close(fd);
+	return dropped;
+#else
+	(void)file_path;
+	return false;
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                            AsyncReader::backend                             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The name of the way the reads are made, for the load benchmark.            *
+*                                                                             *
+*******************************************************************************/
+const char* AsyncReader::backend() const
+{
+#ifdef _WIN32
+	return ring ? "overlapped" : "threads";
+#else
+	return ring ? "io_uring" : "threads";
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                         AsyncReader::block_length                           *
+*                                                                             *
+*******************************************************************************/
+size_t AsyncReader::block_length(uint64_t block) const
+{
+	uint64_t left = length - (block * block_bytes);
+	return (left < block_bytes) ? (size_t)left : block_bytes;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::read_loop                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Body of each reader thread when there is no ring. Claims the next block    *
+*  whose buffer is free, reads it outside the lock, and marks it ready.       *
+*                                                                             *
+*******************************************************************************/
+void AsyncReader::read_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		while (!stopping && !failed &&
+			!(issued < num_blocks && issued < released + slots.size()))
+			changed.wait(lock);
+		if (stopping || failed)
+			return;
+
+		Slot& slot = slots[issued % slots.size()];
+		slot.block = issued++;
+		slot.ready = false;
+
+		lock.unlock();
+		bool ok = read_at(file, &slot.buffer[0], block_length(slot.block),
+			offset + (slot.block * block_bytes));
+		lock.lock();
+
+		if (ok)
+			slot.ready = true;
+		else
+			failed = true;
+		changed.notify_all();
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::ring_loop                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Body of the thread driving the ring. Queues a read for every free buffer,  *
+*  waits outside the lock for one to complete, and marks the blocks read in   *
+*  full ready; with nothing in flight it sleeps until a buffer is given back. *
+*  Once stopping it queues nothing more, but still waits for the reads in     *
+*  flight, since they write into the block buffers.                           *
+*                                                                             *
+*******************************************************************************/
+void AsyncReader::ring_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		if (!stopping && !failed)
+			queue_reads();
+		if (in_flight == 0)
+		{
+			if (stopping || failed)
+				return;
+			changed.wait(lock);
+			continue;
+		}
+
+		bool ok = reap(lock);
+		changed.notify_all();
+		if (!ok)
+			return;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::start_ring                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if io_uring or overlapped reads were set up, false to use threads.    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Creates a ring with one submission entry per block buffer and maps its     *
+*  queues. The buffers are registered with it, so the kernel pins them once   *
+*  instead of on every read; if registration is refused (the locked memory    *
+*  limit of older kernels) plain vectored reads are queued instead. On        *
+*  Windows each buffer gets an OVERLAPPED with an event to wait on instead.   *
+*                                                                             *
+*******************************************************************************/
+bool AsyncReader::start_ring()
+{
+#ifdef USE_IO_URING
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = (int)syscall(__NR_io_uring_setup, (unsigned)slots.size(), &params);
+	if (fd < 0)
+		return false;
+
+	ring = new IoRing();
+	ring->fd       = fd;
+	ring->sq_map   = MAP_FAILED;
+	ring->cq_map   = MAP_FAILED;
+	ring->sqes     = (io_uring_sqe*)MAP_FAILED;
+	ring->pending  = 0;
+
+	ring->sq_map_bytes = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+	ring->cq_map_bytes = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+	ring->sqes_bytes   = params.sq_entries * sizeof(io_uring_sqe);
+
+	// Newer kernels share one mapping between both rings.
+	bool single = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+	single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+	if (single && ring->cq_map_bytes > ring->sq_map_bytes)
+		ring->sq_map_bytes = ring->cq_map_bytes;
+
+	ring->sq_map = mmap(NULL, ring->sq_map_bytes, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (single)
+		ring->cq_map = ring->sq_map;
+	else
+		ring->cq_map = mmap(NULL, ring->cq_map_bytes, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	ring->sqes = (io_uring_sqe*)mmap(NULL, ring->sqes_bytes, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED ||
+		ring->sqes == MAP_FAILED)
+	{
+		stop_ring();
+		return false;
+	}
+
+	unsigned char* sq = (unsigned char*)ring->sq_map;
+	unsigned char* cq = (unsigned char*)ring->cq_map;
+	ring->sq_head  = (unsigned*)(sq + params.sq_off.head);
+	ring->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+	ring->sq_mask  = *(unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring->cq_head  = (unsigned*)(cq + params.cq_off.head);
+	ring->cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+	ring->cq_mask  = *(unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes     = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	ring->iovs.resize(slots.size());
+	for (size_t s = 0; s < slots.size(); s++)
+	{
+		ring->iovs[s].iov_base = &slots[s].buffer[0];
+		ring->iovs[s].iov_len  = slots[s].buffer.size();
+	}
+	ring->fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+		&ring->iovs[0], (unsigned)ring->iovs.size()) == 0;
+	return true;
+#elif defined(_WIN32)
+	ring = new IoRing();
+	ring->reads.resize(slots.size());
+	ring->busy.assign(slots.size(), false);
+	for (size_t s = 0; s < slots.size(); s++)
+	{
+		memset(&ring->reads[s], 0, sizeof(OVERLAPPED));
+		ring->reads[s].hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+		if (ring->reads[s].hEvent == NULL)
+		{
+			stop_ring();
+			return false;
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                           AsyncReader::stop_ring                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Unmaps and closes the ring, once its thread has waited for the reads in    *
+*  flight. On Windows any read still in flight, left only if waiting on it    *
+*  failed, is cancelled first, since it writes into a block buffer.           *
+*                                                                             *
+*******************************************************************************/
+void AsyncReader::stop_ring()
+{
+#ifdef USE_IO_URING
+	if (ring == NULL)
+		return;
+
+	if (ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_bytes);
+	if (ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+		munmap(ring->cq_map, ring->cq_map_bytes);
+	if (ring->sq_map != MAP_FAILED)
+		munmap(ring->sq_map, ring->sq_map_bytes);
+	::close(ring->fd);
+	delete ring;
+	ring = NULL;
+	in_flight = 0;
+#elif defined(_WIN32)
+	if (ring == NULL)
+		return;
+
+	for (size_t s = 0; s < ring->reads.size(); s++)
+	{
+		if (ring->busy[s])
+		{
+			DWORD got;
+			CancelIoEx((HANDLE)file, &ring->reads[s]);
+			GetOverlappedResult((HANDLE)file, &ring->reads[s], &got, TRUE);
+		}
+		if (ring->reads[s].hEvent != NULL)
+			CloseHandle(ring->reads[s].hEvent);
+	}
+	delete ring;
+	ring = NULL;
+	in_flight = 0;
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::queue_reads                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Queues a read for every block that has a free buffer. On Linux they are    *
+*  submitted together by the next reap(); overlapped reads start at once.     *
+*                                                                             *
+*******************************************************************************/
+void AsyncReader::queue_reads()
+{
+	while (issued < num_blocks && issued < released + slots.size())
+	{
+		Slot& slot = slots[issued % slots.size()];
+		slot.block = issued++;
+		slot.done  = 0;
+		slot.ready = false;
+		submit_read(slot);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          AsyncReader::submit_read                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slot                                                                       *
+*           Buffer whose block, or the rest of it, is to be read.             *
+*                                                                             *
+*******************************************************************************/
+void AsyncReader::submit_read(Slot& slot)
+{
+#ifdef USE_IO_URING
+	unsigned s     = (unsigned)(&slot - &slots[0]);
+	unsigned tail  = *ring->sq_tail;
+	unsigned index = tail & ring->sq_mask;
+	size_t bytes   = block_length(slot.block) - slot.done;
+
+	io_uring_sqe* sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->fd        = (int)file;
+	sqe->off       = offset + (slot.block * block_bytes) + slot.done;
+	sqe->user_data = s;
+	if (ring->fixed)
+	{
+		sqe->opcode    = IORING_OP_READ_FIXED;
+		sqe->addr      = (uint64_t)(uintptr_t)(&slot.buffer[0] + slot.done);
+		sqe->len       = (uint32_t)bytes;
+		sqe->buf_index = (uint16_t)s;
+	}
+	else
+	{
+		ring->iovs[s].iov_base = &slot.buffer[0] + slot.done;
+		ring->iovs[s].iov_len  = bytes;
+		sqe->opcode    = IORING_OP_READV;
+		sqe->addr      = (uint64_t)(uintptr_t)&ring->iovs[s];
+		sqe->len       = 1;
+	}
+
+	ring->sq_array[index] = index;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring->pending++;
+	in_flight++;
+#elif defined(_WIN32)
+	size_t s     = &slot - &slots[0];
+	uint64_t pos = offset + (slot.block * block_bytes) + slot.done;
+
+	OVERLAPPED& at = ring->reads[s];
+	HANDLE event = at.hEvent;
+	memset(&at, 0, sizeof(at));
+	at.Offset     = (DWORD)pos;
+	at.OffsetHigh = (DWORD)(pos >> 32);
+	at.hEvent     = event;
+	if (!ReadFile((HANDLE)file, &slot.buffer[0] + slot.done,
+		(DWORD)(block_length(slot.block) - slot.done), NULL, &at) &&
+		GetLastError() != ERROR_IO_PENDING)
+	{
+		failed = true;
+		return;
+	}
+	ring->busy[s] = true;
+	in_flight++;
+#else
+	(void)slot;
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                              AsyncReader::reap                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  lock                                                                       *
+*           The caller's hold on the mutex, released while waiting.           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  false if the ring itself failed, true otherwise.                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Submits the queued reads, waits for at least one to complete and handles   *
+*  the completed ones. A short read has the rest of its block queued again; a *
+*  block read in full is marked ready. An error, or the end of the file       *
+*  before the range ends, fails the reader. Only the ring's thread calls it,  *
+*  so the ring needs no lock of its own.                                      *
+*                                                                             *
+*******************************************************************************/
+bool AsyncReader::reap(std::unique_lock<std::mutex>& lock)
+{
+#ifdef USE_IO_URING
+	unsigned submit = ring->pending;
+	lock.unlock();
+	int ret = (int)syscall(__NR_io_uring_enter, ring->fd, submit, 1,
+		IORING_ENTER_GETEVENTS, NULL, 0);
+	int error = errno;
+	lock.lock();
+	if (ret < 0 && error != EINTR)
+	{
+		failed = true;
+		return false;
+	}
+	if (ret > 0)
+		ring->pending -= ((unsigned)ret < ring->pending) ? (unsigned)ret : ring->pending;
+
+	unsigned head = *ring->cq_head;
+	unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++)
+	{
+		const io_uring_cqe& cqe = ring->cqes[head & ring->cq_mask];
+		Slot& slot = slots[(size_t)cqe.user_data];
+		in_flight--;
+
+		if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+			submit_read(slot);
+		else if (cqe.res <= 0)
+			failed = true;
+		else
+		{
+			slot.done += cqe.res;
+			if (slot.done < block_length(slot.block))
+				submit_read(slot);
+			else
+				slot.ready = true;
+		}
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	return true;
+#elif defined(_WIN32)
+	HANDLE events[ASYNC_READ_DEPTH];
+	DWORD count = 0;
+	for (size_t s = 0; s < slots.size(); s++)
+		if (ring->busy[s])
+			events[count++] = ring->reads[s].hEvent;
+
+	lock.unlock();
+	DWORD woke = WaitForMultipleObjects(count, events, FALSE, INFINITE);
+	lock.lock();
+	if (woke == WAIT_FAILED)
+	{
+		failed = true;
+		return false;
+	}
+
+	for (size_t s = 0; s < slots.size(); s++)
+	{
+		DWORD got = 0;
+		if (!ring->busy[s])
+			continue;
+		if (!GetOverlappedResult((HANDLE)file, &ring->reads[s], &got, FALSE))
+		{
+			if (GetLastError() == ERROR_IO_INCOMPLETE)
+				continue;
+			got = 0;
+		}
+
+		Slot& slot = slots[s];
+		ring->busy[s] = false;
+		in_flight--;
+		if (got == 0)
+			failed = true;
+		else
+		{
+			slot.done += got;
+			if (slot.done < block_length(slot.block))
+				submit_read(slot);
+			else
+				slot.ready = true;
+		}
+	}
+	return true;
+#else
+	(void)lock;
+	return false;
+#endif
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define ASYNC_READ_DEPTH        8
+#define ASYNC_READ_BLOCK_BYTES  ((size_t)4 << 20)
+#define ASYNC_READ_THREADS      4
+
+struct IoRing;
+
+/******************************************************************************
+*                                                                             *
+*                                  AsyncReader      (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  file                                                                       *
+*           Operating system handle of the open file, or -1.                  *
+*  ring                                                                       *
+*           The io_uring, or on Windows the overlapped reads, the blocks are  *
+*           read through, or NULL when the reader threads make the reads.     *
+*  slots                                                                      *
+*           ASYNC_READ_DEPTH block buffers; block b is read into b % depth.   *
+*  offset, length                                                             *
+*           Byte range of the file being read.                                *
+*  block_bytes                                                                *
+*           Size of every block but the last.                                 *
+*  num_blocks                                                                 *
+*           Number of blocks in the range.                                    *
+*  issued                                                                     *
+*           Number of blocks whose reads have been started.                   *
+*  released                                                                   *
+*           Number of blocks handed out and given back; the next block to     *
+*           hand out.                                                         *
+*  holding                                                                    *
+*           Whether the caller holds block released.                          *
+*  in_flight                                                                  *
+*           Reads queued on the ring and not yet completed.                   *
+*  failed                                                                     *
+*           Set once a read has failed or hit the end of the file.            *
+*  stopping                                                                   *
+*           Tells the reader threads to exit.                                 *
+*  readers                                                                    *
+*           Threads making positioned reads when there is no ring, or the     *
+*           one thread driving the ring.                                      *
+*  mutex, changed                                                             *
+*           Guard the block state, and wake whoever waits on it.              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads a range of a file in fixed-size blocks, keeping up to a whole ring   *
+*  of block reads in flight so the device stays busy while earlier blocks are *
+*  parsed. Blocks are handed out in file order whatever order the reads       *
+*  complete in. On Linux the reads go through an io_uring with the buffers    *
+*  registered up front, and on Windows they are overlapped reads; either way  *
+*  one thread of the reader's own issues and completes them, so the thread    *
+*  calling next() only ever waits for data and spends the rest of its time    *
+*  parsing. Where neither is available (other systems, old kernels, or a      *
+*  sandbox refusing the calls) a few threads make positioned reads into the   *
+*  same buffers instead. Memory is fixed at depth blocks.                     *
+*                                                                             *
+*******************************************************************************/
+class AsyncReader
+{
+
+public:
+
+	// Constructors. Destroying the reader waits for its reads to finish.
+	AsyncReader();
+	~AsyncReader();
+
+	// Start reading length bytes from the given offset in blocks of at
+	// most block_bytes.
+	bool open(const std::string& file_path, uint64_t offset, uint64_t length,
+		size_t block_bytes = ASYNC_READ_BLOCK_BYTES);
+	void close();
+
+	// Wait for the next block in file order. The data stays valid until the
+	// following call; NULL at the end of the range or after a failed read.
+	const void* next(size_t& bytes);
+
+	// Drop the file's pages from the operating system cache, so the next
+	// read of it comes from the device. false where this is unsupported.
+	static bool evict_cached(const std::string& file_path);
+
+	// Getters.
+	bool          has_failed() const        {  return failed;                 }
+	const char*   backend() const;
+
+private:
+
+	// One block buffer and the state of its read.
+	struct Slot
+	{
+		std::vector<unsigned char>  buffer;
+		uint64_t                    block;
+		size_t                      done;
+		bool                        ready;
+	};
+
+	intptr_t                   file;
+	IoRing*                    ring;
+	std::vector<Slot>          slots;
+	uint64_t                   offset;
+	uint64_t                   length;
+	size_t                     block_bytes;
+	uint64_t                   num_blocks;
+	uint64_t                   issued;
+	uint64_t                   released;
+	bool                       holding;
+	unsigned                   in_flight;
+	bool                       failed;
+	bool                       stopping;
+	std::vector<std::thread>   readers;
+	std::mutex                 mutex;
+	std::condition_variable    changed;
+
+	// Helpers.
+	size_t block_length(uint64_t block) const;
+	bool start_ring();
+	void stop_ring();
+	void queue_reads();
+	void submit_read(Slot& slot);
+	bool reap(std::unique_lock<std::mutex>& lock);
+	void ring_loop();
+	void read_loop();
+
+	// Readers are not copyable.
+	AsyncReader(const AsyncReader& other);
+	AsyncReader& operator=(const AsyncReader& other);
+
+};
@@ -0,0 +1,800 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "Benchmarks.h"
+#include "TensorSplat.h"
+#include "NiftiVolume.h"
+#include "AsyncReader.h"
+#include "ThreadPool.h"
+#include "CompactSplat.h"
+#include "SplatKernel.h"
+#include "SplatGeometry.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+// Each workload returns a sum of what it computed, kept here so that none of
+// the work can be optimized away.
+static volatile double benchmark_checksum;
+
+// Milliseconds since a performance counter reading.
+static double elapsed_ms(Uint64 start)
+{
+	return 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+/******************************************************************************
+*                                                                             *
+*                               load_samples                                  *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to the header, or to a tensor volume if eig_file_path is     *
+*           empty.                                                            *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*  samples                                                                    *
+*           If given, receives every sample of the volume, and the field is   *
+*           left without splats; otherwise the field's splats are created.    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The loaded field, or NULL if it could not be loaded or holds no splats, in *
+*  which case there is nothing to benchmark and that has been reported.       *
+*                                                                             *
+*******************************************************************************/
+static TensorField* load_samples(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index, SampleList* samples = NULL)
+{
+	SampleSink keep;
+	if (samples != NULL)
+		keep = [samples](TensorField*, SampleList& slab)
+		{
+			samples->insert(samples->end(), slab.begin(), slab.end());
+			return true;
+		};
+
+	TensorField* tf = eig_file_path.empty() ?
+		TensorField::read_nifti_file(nifti_file_path, index, keep) :
+		TensorField::read_eig_file(nifti_file_path, eig_file_path, EIG_LOAD_ASYNC, index, keep);
+	if (tf == NULL || ((samples != NULL) ? samples->empty() : tf->store.empty()))
+	{
+		fprintf(stderr, "\nNothing to benchmark in %s\n", nifti_file_path.c_str());
+		if (tf != NULL)
+		{
+			tf->cleanUp();
+			delete tf;
+		}
+		return NULL;
+	}
+	return tf;
+}
+
+// The smallest box holding the position of every splat of a store.
+static void field_bounds(const SplatStore& store, glm::vec3& lo, glm::vec3& hi)
+{
+	lo = hi = store.position(0);
+	for (GLuint s = 1; s < store.size(); s++)
+	{
+		lo = glm::min(lo, store.position(s));
+		hi = glm::max(hi, store.position(s));
+	}
+}
+
+// An eye looking at the center of a box from a direction, well outside it.
+static glm::vec3 eye_around(const glm::vec3& lo, const glm::vec3& hi,
+	const glm::vec3& direction)
+{
+	return ((lo + hi) * 0.5f) + (glm::normalize(direction + glm::vec3(0.0f, 0.0f, 1e-3f)) *
+		(2.0f * glm::length(hi - lo) + 1.0f));
+}
+
+// The same count random eyes around a box on every run, from a fixed seed.
+static std::vector<glm::vec3> random_eyes(const glm::vec3& lo, const glm::vec3& hi,
+	GLuint count)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<GLfloat> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> eyes;
+	for (GLuint n = 0; n < count; n++)
+	{
+		glm::vec3 direction(unit(random), unit(random), unit(random));
+		eyes.push_back(eye_around(lo, hi, direction));
+	}
+	return eyes;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            Benchmarks::eig_load                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to file containing the relevant header information.          *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Shows how close each load mode comes to the speed of the device. The first *
+*  run only reads the volume through an AsyncReader, which is as fast as any  *
+*  load can go; each mode then loads it with the samples counted and thrown   *
+*  away. Bandwidth is the volume's size over the time taken. Where the system *
+*  allows it the file is dropped from the page cache before every run, so the *
+*  reads come from the device rather than from memory.                        *
+*                                                                             *
+*******************************************************************************/
+void Benchmarks::eig_load(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	static const char* names[] = { "reads only", "mapped", "buffered", "streamed", "async" };
+	static const GLint modes[] = { -1, EIG_LOAD_MAPPED, EIG_LOAD_BUFFERED, EIG_LOAD_STREAMED,
+		EIG_LOAD_ASYNC };
+
+	NiftiVolume volume;
+	if (!volume.read_header(nifti_file_path))
+		return;
+	if (index >= volume.num_volumes())
+	{
+		fprintf(stderr, "\n%s has no volume %u\n", nifti_file_path.c_str(), index);
+		return;
+	}
+	uint64_t bytes = sizeof(GLfloat) * (uint64_t)volume.volume_values() * EIG_STRIDE;
+
+	size_t count = 0;
+	SampleSink discard = [&count](TensorField*, SampleList& samples)
+	{
+		count += samples.size();
+		return true;
+	};
+
+	fprintf(stderr, "\nLoad benchmark of %s, volume %u (%.1f MB):\n",
+		eig_file_path.c_str(), index, (double)bytes / (1 << 20));
+	bool cold = true;
+	for (GLuint run = 0; run < ARRAY_SIZE(modes); run++)
+	{
+		cold = AsyncReader::evict_cached(eig_file_path) && cold;
+		count = 0;
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		bool ok;
+		if (modes[run] < 0)
+		{
+			AsyncReader reader;
+			ok = reader.open(eig_file_path, bytes * index, bytes);
+			size_t block_bytes;
+			while (ok && reader.next(block_bytes) != NULL)
+				count++;
+			ok = ok && !reader.has_failed();
+			if (ok)
+				fprintf(stderr, "  (reads through %s)\n", reader.backend());
+		}
+		else
+		{
+			TensorField* tf = TensorField::read_eig_uncached(volume, eig_file_path, modes[run],
+				index, discard);
+			ok = tf != NULL;
+			if (ok)
+			{
+				tf->cleanUp();
+				delete tf;
+			}
+		}
+		double seconds = elapsed_ms(start) / 1000.0;
+
+		if (ok)
+			fprintf(stderr, "  %-12s %8.3f s %10.1f MB/s %10lu %s\n", names[run], seconds,
+				(double)bytes / (1 << 20) / seconds, (unsigned long)count,
+				(modes[run] < 0) ? "blocks" : "splats");
+		else
+			fprintf(stderr, "  %-12s failed\n", names[run]);
+	}
+	if (!cold)
+		fprintf(stderr, "  The page cache could not be dropped; these are cached reads.\n");
+}
+
+// Expand every splat of every slice along an axis, as drawing its view does.
+static double sweep_slices(SplatStore& store, const TensorField* tf, const glm::vec3& eye,
+	GLuint axis)
+{
+	TensorSplat_Vertex vertices[SPLAT_NUM_VERTICES];
+	GLuint sizes[3] = { tf->z_size, tf->x_size, tf->y_size };
+	double sum = 0;
+	for (GLuint n = 0; n < sizes[axis]; n++)
+	{
+		Slice slice = store.get_slice(axis, n);
+		for (size_t s = 0; s < slice.count; s++)
+			sum += store.recalculate(slice.slots[s], eye, glm::vec3(0, 1, 0), vertices);
+	}
+	return sum;
+}
+
+// Count the splats within a sphere around each of a set of random voxels,
+// finding the occupied voxels of its bounding box through the store.
+static double cull_boxes(SplatStore& store, const TensorField* tf,
+	const std::vector<glm::uvec3>& centers, GLuint radius)
+{
+	std::vector<GLuint> slots;
+	double sum = 0;
+	for (size_t b = 0; b < centers.size(); b++)
+	{
+		glm::uvec3 lo(0);
+		for (GLuint a = 0; a < 3; a++)
+			lo[a] = (centers[b][a] > radius) ? centers[b][a] - radius : 0;
+		slots.clear();
+		store.find_in_box(lo, centers[b] + radius + 1u, slots);
+
+		for (size_t s = 0; s < slots.size(); s++)
+		{
+			size_t voxel = store.voxels[slots[s]];
+			glm::ivec3 d = glm::ivec3((GLint)(voxel % tf->x_size),
+				(GLint)((voxel / tf->x_size) % tf->y_size),
+				(GLint)(voxel / ((size_t)tf->x_size * tf->y_size))) - glm::ivec3(centers[b]);
+			if ((GLuint)((d.x * d.x) + (d.y * d.y) + (d.z * d.z)) <= radius * radius)
+				sum += store.positions[slots[s]].z * store.c[LINEAR][slots[s]];
+		}
+	}
+	return sum;
+}
+
+// Sort every slice along each axis back to front for an eye.
+static double sort_slices(SplatStore& store, const TensorField* tf, const glm::vec3& eye)
+{
+	GLuint sizes[3] = { tf->z_size, tf->x_size, tf->y_size };
+	std::vector<std::pair<GLfloat, GLuint> > depths;
+	double sum = 0;
+	for (GLuint axis = 0; axis < 3; axis++)
+	for (GLuint n = 0; n < sizes[axis]; n++)
+	{
+		Slice slice = store.get_slice(axis, n);
+		depths.clear();
+		for (size_t s = 0; s < slice.count; s++)
+		{
+			glm::vec3 d = store.positions[slice.slots[s]] - eye;
+			depths.push_back(std::make_pair(-glm::dot(d, d), slice.slots[s]));
+		}
+		std::sort(depths.begin(), depths.end());
+		if (!depths.empty())
+			sum += depths[0].second;
+	}
+	return sum;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Benchmarks::layout                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to the header, or to a tensor volume if eig_file_path is     *
+*           empty.                                                            *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Compares the scan order the loaders add splats in with the Morton order    *
+*  fields are kept in once loaded. One volume is stored both ways, and each   *
+*  store runs the same workloads: expanding every slice along each axis in    *
+*  turn, as drawing that view does; culling the splats around random voxels   *
+*  through the index; and depth-sorting every slice for random eyes. Times    *
+*  are the best of LAYOUT_BENCHMARK_RUNS.                                     *
+*                                                                             *
+*******************************************************************************/
+void Benchmarks::layout(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	static const char* names[] = { "axial", "sagittal", "coronal", "cull", "sort" };
+
+	SampleList samples;
+	TensorField* tf = load_samples(nifti_file_path, eig_file_path, index, &samples);
+	if (tf == NULL)
+		return;
+
+	SplatStore scan(tf->x_size, tf->y_size, tf->z_size, true);
+	SplatStore morton(tf->x_size, tf->y_size, tf->z_size, true);
+	for (size_t s = 0; s < samples.size(); s++)
+	{
+		scan.add(samples[s]);
+		morton.add(samples[s]);
+	}
+	morton.sort_morton();
+	SplatStore* layouts[] = { &scan, &morton };
+
+	// The same random eyes, well outside the field, and voxels for both layouts.
+	glm::vec3 lo, hi;
+	field_bounds(scan, lo, hi);
+	std::vector<glm::vec3> eyes = random_eyes(lo, hi, LAYOUT_BENCHMARK_RUNS);
+	std::mt19937 random(1);
+	std::vector<glm::uvec3> centers;
+	for (GLuint n = 0; n < 256; n++)
+		centers.push_back(glm::uvec3(random() % tf->x_size, random() % tf->y_size,
+			random() % tf->z_size));
+	GLuint radius = std::max(std::max(tf->x_size, tf->y_size), tf->z_size) / 16 + 1;
+
+	fprintf(stderr, "\nLayout benchmark of %lu splats in %u x %u x %u voxels:\n",
+		(unsigned long)samples.size(), tf->x_size, tf->y_size, tf->z_size);
+	fprintf(stderr, "  %-8s %12s %12s %8s\n", "", "scan ms", "morton ms", "speedup");
+	for (GLuint work = 0; work < ARRAY_SIZE(names); work++)
+	{
+		double best[2] = { 0, 0 };
+		for (GLuint layout = 0; layout < 2; layout++)
+		{
+			SplatStore& store = *layouts[layout];
+			store.get_all();
+			for (GLuint run = 0; run < LAYOUT_BENCHMARK_RUNS; run++)
+			{
+				Uint64 start = SDL_GetPerformanceCounter();
+				benchmark_checksum = (work <= CORONAL) ? sweep_slices(store, tf, eyes[run], work) :
+					(work == 3) ? cull_boxes(store, tf, centers, radius) :
+					sort_slices(store, tf, eyes[run]);
+				double ms = elapsed_ms(start);
+				if (run == 0 || ms < best[layout])
+					best[layout] = ms;
+			}
+		}
+		fprintf(stderr, "  %-8s %12.3f %12.3f %7.2fx\n", names[work], best[0], best[1],
+			best[0] / best[1]);
+	}
+
+	tf->cleanUp();
+	delete tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Benchmarks::compact                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to the header, or to a tensor volume if eig_file_path is     *
+*           empty.                                                            *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Stores one volume in full and in compact form and prints what each costs   *
+*  per splat, how far the compact tensors, positions, colors and metrics are  *
+*  from the full ones, how far apart the quads drawn from them are for        *
+*  COMPACT_BENCHMARK_EYES random eyes (relative to the size of each quad),    *
+*  how many splats land on the other side of a threshold, and how long        *
+*  expanding every splat takes in each.                                       *
+*                                                                             *
+*******************************************************************************/
+void Benchmarks::compact(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	SampleList samples;
+	TensorField* tf = load_samples(nifti_file_path, eig_file_path, index, &samples);
+	if (tf == NULL)
+		return;
+
+	SplatStore full(tf->x_size, tf->y_size, tf->z_size, true);
+	SplatStore compact(tf->x_size, tf->y_size, tf->z_size, true);
+	compact.set_compact(tf->voxel_to_world);
+	for (size_t s = 0; s < samples.size(); s++)
+	{
+		full.add(samples[s]);
+		compact.add(samples[s]);
+	}
+
+	// Both stores were filled in the same order, so their slots match that of
+	// the sample each was made from.
+	double tensor_max = 0, tensor_sum = 0, position_max = 0, color_max = 0, metric_max = 0;
+	for (GLuint s = 0; s < full.size(); s++)
+	{
+		CompactSplat splat = compact_encode(full.tensors[s], samples[s].c);
+		glm::mat3 d = compact_tensor(splat) - full.tensors[s];
+		double norm = 0, error = 0;
+		for (GLuint c = 0; c < 3; c++)
+		{
+			norm += glm::dot(full.tensors[s][c], full.tensors[s][c]);
+			error += glm::dot(d[c], d[c]);
+		}
+		error = (norm == 0) ? 0 : std::sqrt(error / norm);
+		tensor_max = std::max(tensor_max, error);
+		tensor_sum += error;
+		position_max = std::max(position_max,
+			(double)glm::length(compact.position(s) - full.position(s)));
+		for (GLuint m = 0; m < 3; m++)
+			metric_max = std::max(metric_max,
+				(double)std::fabs(compact.coefficient(m, s) - full.coefficient(m, s)));
+		glm::vec4 color = glm::abs(compact_color(splat) - full.colors[s]);
+		color_max = std::max(color_max, (double)std::max(std::max(color.r, color.g),
+			std::max(color.b, color.a)));
+	}
+
+	// The same random eyes, well outside the field, for both stores.
+	glm::vec3 lo, hi;
+	field_bounds(full, lo, hi);
+	std::vector<glm::vec3> eyes = random_eyes(lo, hi, COMPACT_BENCHMARK_EYES);
+	TensorSplat_Vertex expected[SPLAT_NUM_VERTICES], actual[SPLAT_NUM_VERTICES];
+	double vertex_max = 0, vertex_sum = 0, best[2] = { 0, 0 };
+	for (GLuint n = 0; n < COMPACT_BENCHMARK_EYES; n++)
+	{
+		for (GLuint s = 0; s < full.size(); s++)
+		{
+			full.recalculate(s, eyes[n], glm::vec3(0, 1, 0), expected);
+			compact.recalculate(s, eyes[n], glm::vec3(0, 1, 0), actual);
+			const glm::vec3* e = &expected[0].A_0;
+			const glm::vec3* a = &actual[0].A_0;
+			double extent = 0, error = 0;
+			for (GLuint v = 0; v < 4; v++)
+			{
+				extent = std::max(extent, (double)glm::length(e[v] - full.position(s)));
+				error = std::max(error, (double)glm::length(a[v] - e[v]));
+			}
+			error = (extent == 0) ? 0 : error / extent;
+			vertex_max = std::max(vertex_max, error);
+			vertex_sum += error;
+		}
+
+		SplatStore* stores[] = { &full, &compact };
+		for (GLuint store = 0; store < 2; store++)
+		{
+			Uint64 start = SDL_GetPerformanceCounter();
+			double sum = 0;
+			for (GLuint s = 0; s < stores[store]->size(); s++)
+				sum += stores[store]->recalculate(s, eyes[n], glm::vec3(0, 1, 0), actual);
+			benchmark_checksum = sum;
+			double ms = elapsed_ms(start);
+			if (n == 0 || ms < best[store])
+				best[store] = ms;
+		}
+	}
+
+	fprintf(stderr, "\nCompact benchmark of %lu splats in %u x %u x %u voxels:\n",
+		(unsigned long)samples.size(), tf->x_size, tf->y_size, tf->z_size);
+	fprintf(stderr, "  %-10s %12s %12s\n", "", "full", "compact");
+	fprintf(stderr, "  %-10s %12lu %12lu\n", "bytes", (unsigned long)SPLAT_SLOT_BYTES,
+		(unsigned long)COMPACT_SLOT_BYTES);
+	fprintf(stderr, "  %-10s %12.3f %12.3f\n", "expand ms", best[0], best[1]);
+	fprintf(stderr, "  tensor error   max %.2e  mean %.2e (relative)\n", tensor_max,
+		tensor_sum / full.size());
+	fprintf(stderr, "  vertex error   max %.2e  mean %.2e (of splat size)\n", vertex_max,
+		vertex_sum / ((double)full.size() * COMPACT_BENCHMARK_EYES));
+	fprintf(stderr, "  position error max %.2e\n", position_max);
+	fprintf(stderr, "  metric error   max %.2e\n", metric_max);
+	fprintf(stderr, "  color error    max %.2e\n", color_max);
+	for (GLuint t = 3; t <= 9; t++)
+	{
+		GLfloat threshold = t / 10.0f;
+		size_t moved[2] = { 0, 0 };
+		for (GLuint s = 0; s < full.size(); s++)
+		for (GLuint m = LINEAR; m <= PLANAR; m++)
+			if ((full.coefficient(m, s) >= threshold) != (compact.coefficient(m, s) >= threshold))
+				moved[m - LINEAR]++;
+		fprintf(stderr, "  threshold %.1f: %lu linear and %lu planar splats change sides\n",
+			threshold, (unsigned long)moved[0], (unsigned long)moved[1]);
+	}
+
+	tf->cleanUp();
+	delete tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            Benchmarks::snapshot                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to the header, or to a tensor volume if eig_file_path is     *
+*           empty.                                                            *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Plays the renderer's part for SNAPSHOT_BENCH_FRAMES frames: refill the     *
+*  slices whenever a new version is out, then expand every splat of the one   *
+*  held. It does so alone, and again while every other hardware thread keeps  *
+*  deriving versions that drop or restore the most spherical splats and       *
+*  publishing them. Prints the frame times of each run and how many versions  *
+*  were published, drawn, and lost to a race with another publisher.          *
+*                                                                             *
+*******************************************************************************/
+void Benchmarks::snapshot(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	TensorField* tf = load_samples(nifti_file_path, eig_file_path, index);
+	if (tf == NULL)
+		return;
+	tf->publish();
+
+	// Every version is derived from the loaded one, so they alternate.
+	FieldSnapshot original = tf->snapshot();
+	glm::vec3 lo, hi;
+	field_bounds(*original, lo, hi);
+	glm::vec3 eye = eye_around(lo, hi, glm::vec3(0.0f, 0.0f, 1.0f));
+
+	unsigned analysts = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	fprintf(stderr, "\nSnapshot benchmark of %lu splats, %u frames each:\n",
+		(unsigned long)original->count(), SNAPSHOT_BENCH_FRAMES);
+	fprintf(stderr, "  %-10s %10s %10s %10s %10s %10s\n", "", "mean ms", "worst ms",
+		"drawn", "published", "lost");
+	for (GLuint run = 0; run < 2; run++)
+	{
+		std::atomic<bool> stop(false);
+		std::atomic<GLuint> published(0), lost(0);
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; run == 1 && t < analysts; t++)
+			threads.push_back(std::thread([&, t]()
+		{
+			for (GLuint n = t; !stop; n++)
+			{
+				FieldSnapshot base = tf->snapshot();
+				std::shared_ptr<SplatStore> next = std::make_shared<SplatStore>(
+					tf->x_size, tf->y_size, tf->z_size, true);
+				if (original->is_compact())
+					next->set_compact(tf->voxel_to_world);
+				Slice all = original->get_all();
+				for (size_t s = 0; s < all.count; s++)
+					if ((n % 2) == 0 || original->coefficient(SPHERICAL, all.slots[s]) < 0.5f)
+						next->add(original->sample(all.slots[s]));
+				next->prepare();
+				if (tf->publish(base, next))
+					published++;
+				else
+					lost++;
+			}
+		}));
+
+		SliceList slices;
+		TensorSplat_Vertex vertices[SPLAT_NUM_VERTICES];
+		double total = 0, worst = 0;
+		GLuint drawn_versions = 0;
+		for (GLuint frame = 0; frame < SNAPSHOT_BENCH_FRAMES; frame++)
+		{
+			Uint64 start = SDL_GetPerformanceCounter();
+			if (frame == 0 || tf->is_stale())
+			{
+				tf->get_slices(slices, ALL, 0.0f);
+				drawn_versions++;
+			}
+			const SplatStore& store = tf->get_store();
+			double sum = 0;
+			for (size_t s = 0; s < slices[0].count; s++)
+				sum += store.recalculate(slices[0].slots[s], eye, glm::vec3(0, 1, 0), vertices);
+			benchmark_checksum = sum;
+			double ms = elapsed_ms(start);
+			total += ms;
+			worst = std::max(worst, ms);
+		}
+
+		stop = true;
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+		fprintf(stderr, "  %-10s %10.3f %10.3f %10u %10u %10u\n",
+			(run == 0) ? "alone" : "analysing", total / SNAPSHOT_BENCH_FRAMES, worst,
+			drawn_versions, (GLuint)published, (GLuint)lost);
+	}
+	fprintf(stderr, "  (%u analysis threads)\n", analysts);
+
+	tf->cleanUp();
+	delete tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Benchmarks::kernel                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to the header, or to a tensor volume if eig_file_path is     *
+*           empty.                                                            *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Expands every splat, in batches of KERNEL_BENCH_BATCH as the display does, *
+*  one slot at a time and then with each SplatKernel instruction set up to    *
+*  the widest, and prints the best of KERNEL_BENCH_RUNS times for each and    *
+*  how far the batched quads are from the one-at-a-time ones, relative to     *
+*  the size of each quad. Then expands the whole frame on pools of 1, 2, 4    *
+*  ... threads up to one per hardware thread, one batch per task, as the      *
+*  display does. Last, orbits the field for ORBIT_BENCH_FRAMES frames at a    *
+*  few speeds, keeping quads within a few view tolerances, and prints the     *
+*  time and splats expanded per frame and the furthest any corner of a kept   *
+*  quad came from that of an exact one, relative to the quad's size: in its   *
+*  splat's parameter space, where the tolerance is measured, and in world     *
+*  space, where a thin splat stretches it.                                    *
+*                                                                             *
+*******************************************************************************/
+void Benchmarks::kernel(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	TensorField* tf = load_samples(nifti_file_path, eig_file_path, index);
+	if (tf == NULL)
+		return;
+	tf->store.sort_morton();
+	tf->store.prepare();
+	const SplatStore& store = tf->store;
+	Slice all = store.get_all();
+
+	glm::vec3 lo, hi;
+	field_bounds(store, lo, hi);
+	glm::vec3 eye = eye_around(lo, hi, glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::vec3 up(0, 1, 0);
+
+	std::vector<TensorSplat_Vertex> expected(KERNEL_BENCH_BATCH * SPLAT_NUM_VERTICES);
+	std::vector<TensorSplat_Vertex> actual(expected.size());
+	GLuint widest = SplatKernel::instruction_set();
+	fprintf(stderr, "\nKernel benchmark of %lu splats in batches of %u:\n",
+		(unsigned long)all.count, KERNEL_BENCH_BATCH);
+	fprintf(stderr, "  %-10s %10s %10s %12s\n", "", "ms", "speedup", "max error");
+
+	// One slot at a time first, then each instruction set in turn.
+	double slot_ms = 0;
+	for (GLint set = -1; set <= (GLint)widest; set++)
+	{
+		if (set >= 0)
+			SplatKernel::use(set);
+
+		double best = 0;
+		for (GLuint run = 0; run < KERNEL_BENCH_RUNS; run++)
+		{
+			Uint64 start = SDL_GetPerformanceCounter();
+			for (size_t first = 0; first < all.count; first += KERNEL_BENCH_BATCH)
+			{
+				size_t count = std::min(all.count - first, (size_t)KERNEL_BENCH_BATCH);
+				if (set < 0)
+					for (size_t s = 0; s < count; s++)
+						store.recalculate(all.slots[first + s], eye, up,
+							&actual[s * SPLAT_NUM_VERTICES]);
+				else
+					store.recalculate(&all.slots[first], count, eye, up, &actual[0]);
+			}
+			benchmark_checksum = actual[0].A_0.x;
+			double ms = elapsed_ms(start);
+			if (run == 0 || ms < best)
+				best = ms;
+		}
+		if (set < 0)
+		{
+			slot_ms = best;
+			fprintf(stderr, "  %-10s %10.3f\n", "per slot", best);
+			continue;
+		}
+
+		double error_max = 0;
+		for (size_t first = 0; first < all.count; first += KERNEL_BENCH_BATCH)
+		{
+			size_t count = std::min(all.count - first, (size_t)KERNEL_BENCH_BATCH);
+			store.recalculate(&all.slots[first], count, eye, up, &actual[0]);
+			for (size_t s = 0; s < count; s++)
+			{
+				store.recalculate(all.slots[first + s], eye, up, &expected[s * SPLAT_NUM_VERTICES]);
+				const TensorSplat_Vertex* e = &expected[s * SPLAT_NUM_VERTICES];
+				const TensorSplat_Vertex* a = &actual[s * SPLAT_NUM_VERTICES];
+				double extent = glm::length(e[0].A_0 - e[2].A_0), error = 0;
+				for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+					error = std::max(error, (double)glm::length(a[v].A_0 - e[v].A_0));
+				error = (extent == 0) ? 0 : error / extent;
+				error_max = std::max(error_max, error);
+			}
+		}
+		fprintf(stderr, "  %-10s %10.3f %10.2f %12.2e\n", SplatKernel::name(), best,
+			slot_ms / best, error_max);
+	}
+	SplatKernel::use(widest);
+
+	// Each task writes its own range of one frame-sized buffer.
+	std::vector<TensorSplat_Vertex> frame(all.count * SPLAT_NUM_VERTICES);
+	size_t num_tasks = (all.count + KERNEL_BENCH_BATCH - 1) / KERNEL_BENCH_BATCH;
+	unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+	double single_ms = 0;
+	for (unsigned threads = 1; threads <= hardware; threads = (threads == hardware) ?
+		hardware + 1 : std::min(threads * 2, hardware))
+	{
+		ThreadPool pool(threads);
+		double best = 0;
+		for (GLuint run = 0; run < KERNEL_BENCH_RUNS; run++)
+		{
+			Uint64 start = SDL_GetPerformanceCounter();
+			pool.parallel_for(num_tasks, [&](size_t task)
+			{
+				size_t first = task * KERNEL_BENCH_BATCH;
+				size_t count = std::min(all.count - first, (size_t)KERNEL_BENCH_BATCH);
+				store.recalculate(&all.slots[first], count, eye, up,
+					&frame[first * SPLAT_NUM_VERTICES]);
+			});
+			benchmark_checksum = frame[0].A_0.x;
+			double ms = elapsed_ms(start);
+			if (run == 0 || ms < best)
+				best = ms;
+		}
+		if (threads == 1)
+			single_ms = best;
+		fprintf(stderr, "  %3u %-6s %10.3f %10.2f\n", threads,
+			(threads == 1) ? "thread" : "threads", best, single_ms / best);
+	}
+
+	// Orbit the field about its center, a step of so many degrees a frame.
+	const GLfloat orbit_steps[] = { 0.1f, 0.5f, 2.0f };
+	const GLfloat tolerances[] = { 0.0f, 0.25f, 1.0f };
+	glm::vec3 center = (lo + hi) * 0.5f;
+	GLfloat radius = glm::length(eye - center);
+	ThreadPool pool(hardware);
+	std::vector<TensorSplat_Instance> instances(KERNEL_BENCH_BATCH);
+	fprintf(stderr, "\nOrbit of %u frames, per frame:\n", ORBIT_BENCH_FRAMES);
+	fprintf(stderr, "  %-6s %10s %10s %12s %12s %12s\n", "step", "tolerance", "ms", "expanded",
+		"param error", "world error");
+	for (GLuint o = 0; o < ARRAY_SIZE(orbit_steps); o++)
+	{
+		for (GLuint t = 0; t < ARRAY_SIZE(tolerances); t++)
+		{
+			SplatGeometry geometry(pool);
+			geometry.set_tolerance(glm::radians(tolerances[t]));
+			double total_ms = 0, param_max = 0, world_max = 0;
+			size_t total_expanded = 0;
+			for (GLuint frame = 0; frame <= ORBIT_BENCH_FRAMES; frame++)
+			{
+				GLfloat angle = glm::radians(orbit_steps[o] * frame);
+				glm::vec3 at = center + (radius * glm::vec3(std::sin(angle), 0.0f, std::cos(angle)));
+				Uint64 start = SDL_GetPerformanceCounter();
+				geometry.update(store, all, frame == 0, at, up);
+				if (frame == 0)
+					continue;
+				total_ms += elapsed_ms(start);
+				total_expanded += geometry.expanded_count();
+
+				// Compare the corners of the frame's quads to exact ones.
+				const TensorSplat_Vertex* kept = geometry.get_vertices();
+				for (size_t first = 0; first < all.count; first += KERNEL_BENCH_BATCH)
+				{
+					size_t count = std::min(all.count - first, (size_t)KERNEL_BENCH_BATCH);
+					store.recalculate(&all.slots[first], count, at, up, &expected[0]);
+					store.get_instances(&all.slots[first], count, &instances[0]);
+					for (size_t s = 0; s < count; s++)
+					{
+						const TensorSplat_Vertex* e = &expected[s * SPLAT_NUM_VERTICES];
+						const TensorSplat_Vertex* k = &kept[(first + s) * SPLAT_NUM_VERTICES];
+						const glm::mat3& to_param = instances[s].tensor_inv;
+						double world_extent = glm::length(e[0].A_0 - e[2].A_0);
+						double param_extent = glm::length(to_param * (e[0].A_0 - e[2].A_0));
+						for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+						{
+							glm::vec3 offset = (k[v].A_0 + geometry.get_origin()) - (e[v].A_0 + at);
+							if (world_extent > 0)
+								world_max = std::max(world_max, glm::length(offset) / world_extent);
+							if (param_extent > 0)
+								param_max = std::max(param_max,
+									glm::length(to_param * offset) / param_extent);
+						}
+					}
+				}
+			}
+			fprintf(stderr, "  %-6.1f %10.2f %10.3f %12lu %12.2e %12.2e\n", orbit_steps[o],
+				tolerances[t], total_ms / ORBIT_BENCH_FRAMES,
+				(unsigned long)(total_expanded / ORBIT_BENCH_FRAMES), param_max, world_max);
+		}
+	}
+
+	tf->cleanUp();
+	delete tf;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <GL\glew.h>
+#include <string>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define LAYOUT_BENCHMARK_RUNS   5
+#define COMPACT_BENCHMARK_EYES  16
+#define SNAPSHOT_BENCH_FRAMES   60
+#define KERNEL_BENCH_RUNS       5
+#define KERNEL_BENCH_BATCH      1024
+#define ORBIT_BENCH_FRAMES      60
+
+/******************************************************************************
+*                                                                             *
+*                                Benchmarks     (class)                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The command-line benchmarks. Each loads one volume of a field, given as a  *
+*  header and eigen file or, with no eigen file, as a tensor volume, runs its *
+*  workloads over it and prints the results to stderr. None of them draws or  *
+*  touches GL state, so they run without a window.                            *
+*                                                                             *
+*******************************************************************************/
+class Benchmarks
+{
+
+public:
+
+	// Time each way of loading one volume of an eigen file, and the reads
+	// alone, and print the bandwidth of each. Nothing is cached.
+	static void eig_load(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+	// Time drawing, culling and sorting workloads over one volume stored in
+	// scan order and in Morton order, and print both.
+	static void layout(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+	// Load one volume into a full and a compact store, and print the memory
+	// of each and the error of the compact one.
+	static void compact(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+	// Expand every splat of one volume each frame for a number of frames,
+	// alone and while another thread keeps deriving and publishing new
+	// versions of it, and print the frame times of both.
+	static void snapshot(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+	// Expand every splat of one volume a slot at a time and in batches with
+	// each SIMD kernel the processor supports, then on ever larger thread
+	// pools, and print the time of each and the error of the batches.
+	static void kernel(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+};
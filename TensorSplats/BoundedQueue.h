@@ -0,0 +1,102 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/******************************************************************************
+*                                                                             *
+*                                  BoundedQueue     (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  items                                                                      *
+*           The queued items, oldest first.                                   *
+*  capacity                                                                   *
+*           Maximum number of items held at once.                             *
+*  closed                                                                     *
+*           Set once no more items will be pushed.                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Blocking first-in first-out queue of fixed capacity, used to hand work     *
+*  from a producer thread to a consumer. push() waits while the queue is      *
+*  full, so a fast producer can never run more than capacity items ahead.     *
+*                                                                             *
+*******************************************************************************/
+template <typename T>
+class BoundedQueue
+{
+
+public:
+
+	// Constructor.
+	explicit BoundedQueue(size_t capacity) :
+	capacity(capacity), closed(false)
+	{
+	}
+
+	// Add an item, waiting for room. Returns false if the queue was closed.
+	bool push(const T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!closed && items.size() >= capacity)
+			not_full.wait(lock);
+		if (closed)
+			return false;
+		items.push_back(item);
+		not_empty.notify_one();
+		return true;
+	}
+
+	// Remove the oldest item, waiting for one. Returns false once the queue
+	// is closed and drained.
+	bool pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!closed && items.empty())
+			not_empty.wait(lock);
+		if (items.empty())
+			return false;
+		item = items.front();
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	// Empty the queue and reopen it for a new producer.
+	void reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		items.clear();
+		closed = false;
+	}
+
+	// Wake every waiter; later pushes fail and pops drain what is left.
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_full.notify_all();
+		not_empty.notify_all();
+	}
+
+private:
+
+	std::deque<T>              items;
+	size_t                     capacity;
+	bool                       closed;
+	std::mutex                 mutex;
+	std::condition_variable    not_full;
+	std::condition_variable    not_empty;
+
+	// Queues are not copyable.
+	BoundedQueue(const BoundedQueue& other);
+	BoundedQueue& operator=(const BoundedQueue& other);
+
+};
@@ -0,0 +1,433 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "BrickCache.h"
+#include "Morton.h"
+#include <algorithm>
+
+// Memory charged for one loaded splat: its slot in the store and its place
+// in the three slice orders of its brick.
+#define BRICK_SPLAT_BYTES  (SPLAT_SLOT_BYTES + (3 * sizeof(GLuint)))
+
+// Number of slices a view has; the whole-volume views keep everything in the
+// first of z_size slices, as TensorField::get_slices does.
+static GLuint view_slices(const BrickFileHeader& header, GLuint view_plane)
+{
+	switch (view_plane)
+	{
+	case SAGITTAL:
+		return header.x_size;
+	case CORONAL:
+		return header.y_size;
+	default:
+		return header.z_size;
+	}
+}
+
+// Order a brick's splats by one local coordinate, keeping their relative
+// order, and record where each local slice begins.
+static void order_by(const SampleList& samples, const std::vector<GLuint>& splats,
+	GLuint TensorSample::* axis, std::vector<GLuint>& ordered, GLuint* start)
+{
+	GLuint counts[BRICK_SIZE + 1] = { 0 };
+	for (size_t s = 0; s < samples.size(); s++)
+		counts[(samples[s].*axis % BRICK_SIZE) + 1]++;
+
+	start[0] = 0;
+	for (GLuint l = 0; l < BRICK_SIZE; l++)
+		start[l + 1] = start[l] + counts[l + 1];
+
+	GLuint next[BRICK_SIZE];
+	for (GLuint l = 0; l < BRICK_SIZE; l++)
+		next[l] = start[l];
+
+	ordered.resize(splats.size());
+	for (size_t s = 0; s < samples.size(); s++)
+		ordered[next[samples[s].*axis % BRICK_SIZE]++] = splats[s];
+}
+
+/******************************************************************************
+*                                                                             *
+*                           BrickCache::BrickCache                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file                                                                       *
+*           Brick file opened by BrickFile::open, which the cache now owns.   *
+*  header                                                                     *
+*           Its header.                                                       *
+*  entries                                                                    *
+*           Its directory.                                                    *
+*  budget                                                                     *
+*           Bytes the loaded bricks may use.                                  *
+*                                                                             *
+*******************************************************************************/
+BrickCache::BrickCache(FILE* file, const BrickFileHeader& header,
+	const std::vector<BrickEntry>& entries, size_t budget) :
+file(file), header(header), entries(entries),
+store(header.x_size, header.y_size, header.z_size, false), resident(entries.size(), (Brick*)NULL),
+budget(budget), used(0), pass(0), view(-1), view_threshold(0), view_slice(0),
+complete(false)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                           BrickCache::~BrickCache                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Frees every loaded brick and closes the file. Must run on the GL thread.   *
+*  The bricks' slots go with the whole store rather than one at a time, as    *
+*  evicting them would.                                                       *
+*                                                                             *
+*******************************************************************************/
+BrickCache::~BrickCache()
+{
+	for (std::list<GLuint>::iterator brick = lru.begin(); brick != lru.end(); ++brick)
+		delete resident[*brick];
+	store.clear();
+	fclose(file);
+}
+
+/******************************************************************************
+*                                                                             *
+*                          BrickCache::open_or_build                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  brick_path                                                                 *
+*           Path to the .tbrick file.                                         *
+*  key                                                                        *
+*           Source key of the files the field is loaded from.                 *
+*  budget                                                                     *
+*           Bytes the loaded bricks may use.                                  *
+*  build                                                                      *
+*           Runs the loader with the sink it is given; called only when the   *
+*           brick file cannot be used.                                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A cache with no bricks loaded, or NULL if the file could not be opened or  *
+*  built.                                                                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The loader's slabs go straight into a BrickFile and never become splats,   *
+*  so building the file needs memory for one layer of bricks rather than for  *
+*  the whole field. Touches no GL state, so it may run on a loader thread. A  *
+*  load that was cancelled leaves no brick file behind.                       *
+*                                                                             *
+*******************************************************************************/
+BrickCache* BrickCache::open_or_build(const std::string& brick_path, uint64_t key,
+	size_t budget, const std::function<TensorField*(const SampleSink&)>& build)
+{
+	BrickFileHeader header;
+	std::vector<BrickEntry> entries;
+	FILE* fp = BrickFile::open(brick_path, key, header, entries);
+
+	if (fp == NULL)
+	{
+		BrickFile writer;
+		if (!writer.create(brick_path, key))
+			return NULL;
+
+		TensorField* built = NULL;
+		TensorField* tf = build([&](TensorField* field, SampleList& samples)
+		{
+			built = field;
+			writer.append(field, samples);
+			return true;
+		});
+
+		// The field only carried the samples to the writer; it holds no splats.
+		// A cancelled load is incomplete, so its brick file is never finished.
+		TensorField* carrier = (tf != NULL) ? tf : built;
+		bool cancelled = (carrier != NULL) && carrier->cancelled;
+		if (carrier != NULL)
+		{
+			carrier->cleanUp();
+			delete carrier;
+		}
+		if (tf == NULL || cancelled || !writer.finish())
+		{
+			writer.abort();
+			return NULL;
+		}
+
+		fp = BrickFile::open(brick_path, key, header, entries);
+		if (fp == NULL)
+			return NULL;
+	}
+
+	fprintf(stderr, "\nOpened %s: %lu splats in %u x %u x %u bricks\n", brick_path.c_str(),
+		(unsigned long)header.record_count, header.x_bricks, header.y_bricks, header.z_bricks);
+	return new BrickCache(fp, header, entries, budget);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            BrickCache::get_slice                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  splats                                                                     *
+*           Slice list to fill. It is sized to the view, and only the slice   *
+*           asked for holds splats; the rest are left empty.                  *
+*  view_plane                                                                 *
+*           One of AXIAL, CORONAL, SAGITTAL, ALL_LINEAR, ALL_PLANAR or ALL.   *
+*  threshold                                                                  *
+*           Smallest coefficient shown by ALL_LINEAR and ALL_PLANAR.          *
+*  slice                                                                      *
+*           Slice to fill; always 0 for the whole-volume views.               *
+*  budget_ms                                                                  *
+*           Time after which no further brick is read this call.              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true once the slice holds everything it can; false while bricks are still  *
+*  to be read, in which case the caller should call again next frame.         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Called every frame; it returns at once if the view has not changed. A      *
+*  slice's bricks are all kept even if they exceed the budget, since none of  *
+*  them can be left out; the whole-volume views instead stop reading bricks   *
+*  once the budget is spent and show only those that fit.                     *
+*                                                                             *
+*******************************************************************************/
+bool BrickCache::get_slice(SliceList& splats, GLuint view_plane, GLfloat threshold,
+	GLuint slice, GLuint budget_ms)
+{
+	GLuint count = view_slices(header, view_plane);
+	Slice none = { NULL, 0 };
+	if (splats.size() != count)
+	{
+		splats.assign(count, none);
+		invalidate();
+	}
+	if (slice >= count)
+		return true;
+
+	bool same_view = view == (GLint)view_plane && view_threshold == threshold &&
+		view_slice == slice;
+	if (same_view && complete)
+		return true;
+	if (!same_view)
+	{
+		if (view_slice < count)
+			splats[view_slice] = none;
+		view = (GLint)view_plane;
+		view_threshold = threshold;
+		view_slice = slice;
+		pass++;
+	}
+
+	std::vector<GLuint> bricks;
+	needed_bricks(view_plane, threshold, slice, bricks);
+	bool whole_volume = (view_plane != AXIAL && view_plane != CORONAL &&
+		view_plane != SAGITTAL);
+	GLuint local = slice % BRICK_SIZE;
+
+	std::vector<GLuint>& out = slice_slots;
+	out.clear();
+	complete = true;
+	bool full = false;
+	GLuint start_ms = SDL_GetTicks();
+
+	for (size_t n = 0; n < bricks.size(); n++)
+	{
+		GLuint b = bricks[n];
+		Brick* brick = resident[b];
+		if (brick == NULL)
+		{
+			if (full)
+				continue;
+			if (SDL_GetTicks() - start_ms >= budget_ms)
+			{
+				complete = false;
+				continue;
+			}
+			brick = load(b, !whole_volume);
+			if (brick == NULL)
+			{
+				// Either damaged, and now marked empty, or out of room.
+				if (entries[b].count != 0)
+				{
+					fprintf(stderr, "\nBrick cache full; showing part of the volume\n");
+					full = true;
+				}
+				continue;
+			}
+		}
+
+		brick->pass = pass;
+		lru.splice(lru.end(), lru, brick->lru_entry);
+
+		switch (view_plane)
+		{
+		case AXIAL:
+			out.insert(out.end(), brick->splats.begin() + brick->k_start[local],
+				brick->splats.begin() + brick->k_start[local + 1]);
+			break;
+		case CORONAL:
+			out.insert(out.end(), brick->by_j.begin() + brick->j_start[local],
+				brick->by_j.begin() + brick->j_start[local + 1]);
+			break;
+		case SAGITTAL:
+			out.insert(out.end(), brick->by_i.begin() + brick->i_start[local],
+				brick->by_i.begin() + brick->i_start[local + 1]);
+			break;
+		case ALL_LINEAR:
+		case ALL_PLANAR:
+			for (size_t s = 0; s < brick->splats.size(); s++)
+				if (store.coefficient(view_plane == ALL_LINEAR ? LINEAR : PLANAR, brick->splats[s]) >= threshold)
+					out.push_back(brick->splats[s]);
+			break;
+		default:
+			out.insert(out.end(), brick->splats.begin(), brick->splats.end());
+			break;
+		}
+	}
+
+	splats[slice] = none;
+	if (!out.empty())
+	{
+		splats[slice].slots = &out[0];
+		splats[slice].count = out.size();
+	}
+	return complete;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          BrickCache::needed_bricks                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Lists the bricks a slice of a view draws from: the layer of bricks the     *
+*  slice crosses, or every brick for the whole-volume views. Empty bricks,    *
+*  and those whose largest coefficient is under a thresholded view's cut, are *
+*  left out without being read.                                               *
+*                                                                             *
+*******************************************************************************/
+void BrickCache::needed_bricks(GLuint view_plane, GLfloat threshold, GLuint slice,
+	std::vector<GLuint>& bricks) const
+{
+	GLuint x_begin = 0, x_end = header.x_bricks;
+	GLuint y_begin = 0, y_end = header.y_bricks;
+	GLuint z_begin = 0, z_end = header.z_bricks;
+
+	switch (view_plane)
+	{
+	case AXIAL:
+		z_begin = slice / BRICK_SIZE;
+		z_end = z_begin + 1;
+		break;
+	case CORONAL:
+		y_begin = slice / BRICK_SIZE;
+		y_end = y_begin + 1;
+		break;
+	case SAGITTAL:
+		x_begin = slice / BRICK_SIZE;
+		x_end = x_begin + 1;
+		break;
+	}
+
+	for (GLuint z = z_begin; z < z_end; z++)
+	for (GLuint y = y_begin; y < y_end; y++)
+	for (GLuint x = x_begin; x < x_end; x++)
+	{
+		GLuint b = (((z * header.y_bricks) + y) * header.x_bricks) + x;
+		const BrickEntry& entry = entries[b];
+		if (entry.count == 0)
+			continue;
+		if (view_plane == ALL_LINEAR && entry.max_c[LINEAR] < threshold)
+			continue;
+		if (view_plane == ALL_PLANAR && entry.max_c[PLANAR] < threshold)
+			continue;
+		bricks.push_back(b);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BrickCache::load                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  brick                                                                      *
+*           Index of the brick to read.                                       *
+*  over_budget                                                                *
+*           Whether the brick may be loaded when evicting every brick not in  *
+*           the current view still leaves no room for it.                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The loaded brick, or NULL if there is no room or it is damaged. A damaged  *
+*  brick is marked empty so it is not read again.                             *
+*                                                                             *
+*******************************************************************************/
+Brick* BrickCache::load(GLuint brick, bool over_budget)
+{
+	BrickEntry& entry = entries[brick];
+	size_t bytes = sizeof(Brick) + ((size_t)entry.count * BRICK_SPLAT_BYTES);
+
+	// Bricks of the current view are never evicted.
+	while (used + bytes > budget && !lru.empty() && resident[lru.front()]->pass != pass)
+		evict(lru.front());
+	if (used + bytes > budget && !over_budget)
+		return NULL;
+
+	if (!BrickFile::read_brick(file, header, entry, brick, buffer))
+	{
+		entry.count = 0;
+		return NULL;
+	}
+
+	// Store the brick's splats in Morton order, so neighbours share cache lines.
+	std::sort(buffer.begin(), buffer.end(), [](const TensorSample& a, const TensorSample& b)
+	{
+		return morton_encode(a.i, a.j, a.k) < morton_encode(b.i, b.j, b.k);
+	});
+
+	Brick* loaded = new Brick();
+	loaded->splats.resize(buffer.size());
+	for (size_t s = 0; s < buffer.size(); s++)
+		loaded->splats[s] = store.add(buffer[s]);
+
+	std::vector<GLuint> by_k;
+	order_by(buffer, loaded->splats, &TensorSample::k, by_k, loaded->k_start);
+	order_by(buffer, loaded->splats, &TensorSample::j, loaded->by_j, loaded->j_start);
+	order_by(buffer, loaded->splats, &TensorSample::i, loaded->by_i, loaded->i_start);
+	loaded->splats.swap(by_k);
+
+	loaded->bytes = bytes;
+	loaded->pass = pass;
+	loaded->lru_entry = lru.insert(lru.end(), brick);
+	resident[brick] = loaded;
+	used += bytes;
+	return loaded;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BrickCache::evict                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Frees a loaded brick and its splats (GL thread only).                      *
+*                                                                             *
+*******************************************************************************/
+void BrickCache::evict(GLuint brick)
+{
+	Brick* loaded = resident[brick];
+	for (size_t s = 0; s < loaded->splats.size(); s++)
+		store.remove(loaded->splats[s]);
+	used -= loaded->bytes;
+	lru.erase(loaded->lru_entry);
+	resident[brick] = NULL;
+	delete loaded;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cstdio>
+#include <list>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include "TensorSplat.h"
+#include "BrickFile.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define BRICK_CACHE_BYTES       ((size_t)512 << 20)
+#define BRICK_FRAME_BUDGET_MS   8
+#define BRICKED_FIELD_VOXELS    ((size_t)256 * 256 * 256)
+
+/******************************************************************************
+*                                                                             *
+*                                  Brick      (struct)                        *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  splats                                                                     *
+*           Store slots of the brick's splats, ordered by local z-slice.      *
+*  by_j, by_i                                                                 *
+*           The same splats ordered by local y-slice and by local x-slice.    *
+*  k_start, j_start, i_start                                                  *
+*           Where each local slice begins in the matching list.               *
+*  bytes                                                                      *
+*           Memory charged to the brick.                                      *
+*  pass                                                                       *
+*           Last view that used the brick; it is not evicted during it.       *
+*  lru_entry                                                                  *
+*           Position of the brick in the cache's LRU list.                    *
+*                                                                             *
+*******************************************************************************/
+struct Brick
+{
+
+	std::vector<GLuint>            splats;
+	std::vector<GLuint>            by_j;
+	std::vector<GLuint>            by_i;
+	GLuint                         k_start[BRICK_SIZE + 1];
+	GLuint                         j_start[BRICK_SIZE + 1];
+	GLuint                         i_start[BRICK_SIZE + 1];
+	size_t                         bytes;
+	GLuint                         pass;
+	std::list<GLuint>::iterator    lru_entry;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                  BrickCache       (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  file                                                                       *
+*           The open .tbrick file.                                            *
+*  header                                                                     *
+*           Its header.                                                       *
+*  entries                                                                    *
+*           Its directory.                                                    *
+*  store                                                                      *
+*           Splats of the loaded bricks; evicted bricks' slots are reused.    *
+*  resident                                                                   *
+*           The loaded bricks, or NULL, by directory index.                   *
+*  lru                                                                        *
+*           Loaded bricks, least recently used first.                         *
+*  budget                                                                     *
+*           Bytes the loaded bricks may use.                                  *
+*  used                                                                       *
+*           Bytes the loaded bricks do use.                                   *
+*  pass                                                                       *
+*           Number of the current view.                                       *
+*  view, view_threshold, view_slice                                           *
+*           The view the slice list was last filled for.                      *
+*  complete                                                                   *
+*           Whether every brick of that view was loaded.                      *
+*  buffer                                                                     *
+*           Records of the brick being read.                                  *
+*  slice_slots                                                                *
+*           Slots of the slice last filled, which the slice list points to.   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Backs a TensorField that is too large to hold in memory. Only the bricks a *
+*  view needs are read and turned into splats, and the least recently used    *
+*  bricks are dropped to keep the total within the budget. Bricks are read a  *
+*  few milliseconds' worth per frame, so a jump to an unseen part of the      *
+*  volume fills in over several frames instead of stalling one. Everything    *
+*  but open_or_build must run on the GL thread.                               *
+*                                                                             *
+*******************************************************************************/
+class BrickCache
+{
+
+public:
+
+	// Constructors. Destroying the cache frees every loaded brick.
+	BrickCache(FILE* file, const BrickFileHeader& header,
+		const std::vector<BrickEntry>& entries, size_t budget);
+	~BrickCache();
+
+	// Open a brick file, first building it with the loader if it is missing
+	// or out of date. NULL if neither works.
+	static BrickCache* open_or_build(const std::string& brick_path, uint64_t key,
+		size_t budget, const std::function<TensorField*(const SampleSink&)>& build);
+
+	// Fill one slice of a view, loading its bricks within budget_ms. Returns
+	// true once every brick the slice needs has been loaded.
+	bool get_slice(SliceList& splats, GLuint view_plane, GLfloat threshold,
+		GLuint slice, GLuint budget_ms = BRICK_FRAME_BUDGET_MS);
+
+	// Forget the last view, so the next get_slice fills its slice afresh.
+	void invalidate()                       {  complete = false; view = -1;  }
+
+	// Getters.
+	const BrickFileHeader&  get_header() const  {  return header;           }
+	size_t                  get_used() const    {  return used;             }
+	SplatStore&             get_store()         {  return store;            }
+
+private:
+
+	FILE*                      file;
+	BrickFileHeader            header;
+	std::vector<BrickEntry>    entries;
+	SplatStore                 store;
+	std::vector<Brick*>        resident;
+	std::list<GLuint>          lru;
+	size_t                     budget;
+	size_t                     used;
+	GLuint                     pass;
+	GLint                      view;
+	GLfloat                    view_threshold;
+	GLuint                     view_slice;
+	bool                       complete;
+	SampleList                 buffer;
+	std::vector<GLuint>        slice_slots;
+
+	// Helpers.
+	void needed_bricks(GLuint view_plane, GLfloat threshold, GLuint slice,
+		std::vector<GLuint>& bricks) const;
+	Brick* load(GLuint brick, bool over_budget);
+	void evict(GLuint brick);
+
+	// Caches are not copyable.
+	BrickCache(const BrickCache& other);
+	BrickCache& operator=(const BrickCache& other);
+
+};
@@ -0,0 +1,399 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "BrickFile.h"
+#include "SplatCache.h"
+#include <cstring>
+#include <algorithm>
+
+// The directory and records are written straight from memory.
+static_assert(sizeof(BrickFileHeader) == 80, "BrickFileHeader must be 80 bytes");
+static_assert(sizeof(BrickEntry) == 32, "BrickEntry layout changed; bump BRICK_VERSION");
+
+// Seek to, and report, byte offsets that may lie beyond what a long can hold.
+static bool seek_file(FILE* fp, uint64_t offset, int origin)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, origin) == 0;
+#else
+	return fseeko(fp, (off_t)offset, origin) == 0;
+#endif
+}
+static uint64_t tell_file(FILE* fp)
+{
+#ifdef _WIN32
+	return (uint64_t)_ftelli64(fp);
+#else
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                            BrickFile::BrickFile                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the BrickFile object. Nothing is written until      *
+*  create() is called.                                                        *
+*                                                                             *
+*******************************************************************************/
+BrickFile::BrickFile() :
+file(NULL), z_layer(0), ok(false)
+{
+	memset(&header, 0, sizeof(header));
+}
+BrickFile::~BrickFile()
+{
+	abort();
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BrickFile::create                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  brick_path                                                                 *
+*           Path to the .tbrick file to (re)write.                            *
+*  key                                                                        *
+*           Source key of the files the field is being loaded from.           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the temporary file was created, false otherwise.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  As for the splat cache, everything goes to a temporary file that replaces  *
+*  the brick file only once finish() succeeds. The header and directory are   *
+*  reserved when the first slab reveals the size of the field.                *
+*                                                                             *
+*******************************************************************************/
+bool BrickFile::create(const std::string& brick_path, uint64_t key)
+{
+	abort();
+	if (key == 0)
+		return false;
+
+	this->brick_path = brick_path;
+	temp_path = brick_path + ".tmp";
+	file = fopen(temp_path.c_str(), "wb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "\nCannot write brick file %s\n", temp_path.c_str());
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BRICK_MAGIC, sizeof(header.magic));
+	header.version = BRICK_VERSION;
+	header.header_bytes = sizeof(BrickFileHeader);
+	header.entry_bytes = sizeof(BrickEntry);
+	header.record_bytes = sizeof(TensorSample);
+	header.source_key = key;
+	entries.clear();
+	layer.clear();
+	z_layer = 0;
+	ok = true;
+	return ok;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BrickFile::append                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  tf                                                                         *
+*           The field the samples belong to.                                  *
+*  samples                                                                    *
+*           The next slab of samples, in the order the loader produced them.  *
+*                                                                             *
+*******************************************************************************/
+void BrickFile::append(const TensorField* tf, const SampleList& samples)
+{
+	if (file == NULL || !ok)
+		return;
+
+	// The first slab fixes the size of the field and of the directory.
+	if (header.brick_size == 0)
+	{
+		header.brick_size = BRICK_SIZE;
+		header.x_size = tf->x_size;
+		header.y_size = tf->y_size;
+		header.z_size = tf->z_size;
+		header.x_bricks = bricks_along(tf->x_size);
+		header.y_bricks = bricks_along(tf->y_size);
+		header.z_bricks = bricks_along(tf->z_size);
+
+		BrickEntry empty;
+		memset(&empty, 0, sizeof(empty));
+		entries.assign((size_t)header.x_bricks * header.y_bricks * header.z_bricks, empty);
+		layer.assign((size_t)header.x_bricks * header.y_bricks, SampleList());
+
+		ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && !entries.empty())
+			ok = fwrite(&entries[0], sizeof(BrickEntry), entries.size(), file) == entries.size();
+	}
+
+	for (size_t s = 0; s < samples.size() && ok; s++)
+	{
+		const TensorSample& sample = samples[s];
+		if (sample.i >= header.x_size || sample.j >= header.y_size ||
+			sample.k >= header.z_size || sample.k / BRICK_SIZE < z_layer)
+		{
+			fprintf(stderr, "\nCannot brick %s: samples out of order\n", brick_path.c_str());
+			ok = false;
+			return;
+		}
+
+		// A sample beyond the current layer completes it.
+		while (sample.k / BRICK_SIZE > z_layer)
+		{
+			flush_layer();
+			z_layer++;
+		}
+
+		GLuint x_brick = sample.i / BRICK_SIZE, y_brick = sample.j / BRICK_SIZE;
+		layer[((size_t)y_brick * header.x_bricks) + x_brick].push_back(sample);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                            BrickFile::flush_layer                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Writes each brick of the layer z_layer as one run of records, in the k/j/i *
+*  order the loader produced them, and fills in its directory entry.          *
+*                                                                             *
+*******************************************************************************/
+void BrickFile::flush_layer()
+{
+	uint64_t data_start = header.header_bytes + ((uint64_t)entries.size() * sizeof(BrickEntry));
+
+	for (size_t b = 0; b < layer.size() && ok; b++)
+	{
+		SampleList& samples = layer[b];
+		if (samples.empty())
+			continue;
+
+		BrickEntry& entry = entries[((size_t)z_layer * layer.size()) + b];
+		entry.offset = data_start + (header.record_count * sizeof(TensorSample));
+		entry.count = (uint32_t)samples.size();
+		entry.checksum = SplatCache::checksum(&samples[0],
+			sizeof(TensorSample) * samples.size(), FNV_OFFSET);
+		for (size_t s = 0; s < samples.size(); s++)
+		for (GLuint c = 0; c < 3; c++)
+			entry.max_c[c] = std::max(entry.max_c[c], samples[s].c[c]);
+
+		ok = fwrite(&samples[0], sizeof(TensorSample), samples.size(), file) == samples.size();
+		header.record_count += samples.size();
+		SampleList().swap(samples);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BrickFile::finish                              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the brick file was written, false otherwise.                       *
+*                                                                             *
+*******************************************************************************/
+bool BrickFile::finish()
+{
+	if (file == NULL)
+		return false;
+
+	// Nothing was ever announced, so the size of the field is unknown.
+	ok = ok && header.brick_size != 0;
+	if (ok)
+	{
+		flush_layer();
+		header.checksum = entries.empty() ? FNV_OFFSET :
+			SplatCache::checksum(&entries[0], sizeof(BrickEntry) * entries.size(), FNV_OFFSET);
+		ok = ok && seek_file(file, 0, SEEK_SET) && fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && !entries.empty())
+			ok = fwrite(&entries[0], sizeof(BrickEntry), entries.size(), file) == entries.size();
+	}
+	ok = (fclose(file) == 0) && ok;
+	file = NULL;
+	std::vector<SampleList>().swap(layer);
+
+	// rename() will not replace an existing file on Windows.
+	if (ok)
+	{
+		remove(brick_path.c_str());
+		ok = rename(temp_path.c_str(), brick_path.c_str()) == 0;
+	}
+	if (!ok)
+	{
+		fprintf(stderr, "\nCannot write brick file %s\n", brick_path.c_str());
+		remove(temp_path.c_str());
+	}
+	return ok;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BrickFile::abort                               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Closes and deletes an unfinished temporary file.                           *
+*                                                                             *
+*******************************************************************************/
+void BrickFile::abort()
+{
+	if (file != NULL)
+	{
+		fclose(file);
+		file = NULL;
+		remove(temp_path.c_str());
+	}
+	std::vector<SampleList>().swap(layer);
+	ok = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                               BrickFile::open                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  brick_path                                                                 *
+*           Path to the .tbrick file.                                         *
+*  key                                                                        *
+*           Source key the file must have been written with.                  *
+*  header                                                                     *
+*           Receives the header.                                              *
+*  entries                                                                    *
+*           Receives the directory.                                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The open file, or NULL if it is missing, was written for other sources or  *
+*  another version, or its directory is damaged. No records are read.         *
+*                                                                             *
+*******************************************************************************/
+FILE* BrickFile::open(const std::string& brick_path, uint64_t key,
+	BrickFileHeader& header, std::vector<BrickEntry>& entries)
+{
+	if (key == 0)
+		return NULL;
+
+	FILE* fp = fopen(brick_path.c_str(), "rb");
+	if (fp == NULL)
+		return NULL;
+
+	const char* problem = NULL;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		memcmp(header.magic, BRICK_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != BRICK_VERSION ||
+		header.header_bytes != sizeof(BrickFileHeader) ||
+		header.entry_bytes != sizeof(BrickEntry) ||
+		header.record_bytes != sizeof(TensorSample) ||
+		header.brick_size != BRICK_SIZE ||
+		header.x_bricks != bricks_along(header.x_size) ||
+		header.y_bricks != bricks_along(header.y_size) ||
+		header.z_bricks != bricks_along(header.z_size))
+		problem = "written by another version";
+	else if (header.source_key != key)
+		problem = "source files or settings changed";
+
+	uint64_t length = 0;
+	if (problem == NULL)
+	{
+		entries.resize((size_t)header.x_bricks * header.y_bricks * header.z_bricks);
+		if (!entries.empty() &&
+			fread(&entries[0], sizeof(BrickEntry), entries.size(), fp) != entries.size())
+			problem = "truncated";
+		else if ((entries.empty() ? FNV_OFFSET : SplatCache::checksum(&entries[0],
+			sizeof(BrickEntry) * entries.size(), FNV_OFFSET)) != header.checksum)
+			problem = "checksum mismatch";
+		else if (!seek_file(fp, 0, SEEK_END))
+			problem = "truncated";
+		else
+			length = tell_file(fp);
+	}
+
+	uint64_t data_start = header.header_bytes + ((uint64_t)entries.size() * sizeof(BrickEntry));
+	if (problem == NULL && length != data_start + (header.record_count * sizeof(TensorSample)))
+		problem = "truncated";
+	for (size_t b = 0; b < entries.size() && problem == NULL; b++)
+	{
+		if (entries[b].count > 0 && (entries[b].offset < data_start ||
+			entries[b].offset + ((uint64_t)entries[b].count * sizeof(TensorSample)) > length))
+			problem = "brick outside the file";
+	}
+
+	if (problem != NULL)
+	{
+		fprintf(stderr, "\nIgnoring %s: %s\n", brick_path.c_str(), problem);
+		fclose(fp);
+		return NULL;
+	}
+	return fp;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            BrickFile::read_brick                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file                                                                       *
+*           File returned by open().                                          *
+*  header                                                                     *
+*           Its header.                                                       *
+*  entry                                                                      *
+*           Directory entry of the brick.                                     *
+*  brick                                                                      *
+*           Index of the brick in the directory.                              *
+*  samples                                                                    *
+*           Receives the records of the brick.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the records were read, match their checksum and all lie inside     *
+*  the brick; false otherwise.                                                *
+*                                                                             *
+*******************************************************************************/
+bool BrickFile::read_brick(FILE* file, const BrickFileHeader& header,
+	const BrickEntry& entry, GLuint brick, SampleList& samples)
+{
+	samples.resize(entry.count);
+	if (entry.count == 0)
+		return true;
+
+	if (!seek_file(file, entry.offset, SEEK_SET) ||
+		fread(&samples[0], sizeof(TensorSample), entry.count, file) != entry.count ||
+		SplatCache::checksum(&samples[0], sizeof(TensorSample) * entry.count,
+			FNV_OFFSET) != entry.checksum)
+	{
+		fprintf(stderr, "\nBrick %u is damaged; skipping it\n", brick);
+		samples.clear();
+		return false;
+	}
+
+	GLuint i_brick = brick % header.x_bricks;
+	GLuint j_brick = (brick / header.x_bricks) % header.y_bricks;
+	GLuint k_brick = brick / (header.x_bricks * header.y_bricks);
+	for (size_t s = 0; s < samples.size(); s++)
+	{
+		if (samples[s].i / BRICK_SIZE != i_brick || samples[s].j / BRICK_SIZE != j_brick ||
+			samples[s].k / BRICK_SIZE != k_brick)
+		{
+			fprintf(stderr, "\nBrick %u holds voxels of another brick; skipping it\n", brick);
+			samples.clear();
+			return false;
+		}
+	}
+	return true;
+}
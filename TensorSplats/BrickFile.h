@@ -0,0 +1,163 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "TensorSplat.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define BRICK_SIZE              32
+#define BRICK_EXTENSION         ".tbrick"
+#define BRICK_MAGIC             "TBRICK\r\n"
+#define BRICK_VERSION           1
+
+/******************************************************************************
+*                                                                             *
+*                           BrickFileHeader      (struct)                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  First 80 bytes of a .tbrick file. It is followed by the directory, one     *
+*  BrickEntry per brick in z/y/x order, and then by the records of each brick *
+*  in turn. The checksum covers the directory; each entry carries the         *
+*  checksum of its own records, which is checked when the brick is read.      *
+*                                                                             *
+*******************************************************************************/
+struct BrickFileHeader
+{
+
+	char           magic[8];
+	uint32_t       version;
+	uint32_t       header_bytes;
+	uint32_t       entry_bytes;
+	uint32_t       record_bytes;
+	uint32_t       brick_size;
+	uint32_t       x_size;
+	uint32_t       y_size;
+	uint32_t       z_size;
+	uint32_t       x_bricks;
+	uint32_t       y_bricks;
+	uint32_t       z_bricks;
+	uint32_t       reserved;
+	uint64_t       record_count;
+	uint64_t       source_key;
+	uint64_t       checksum;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                              BrickEntry      (struct)                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Directory entry of one brick: where its records start, how many there      *
+*  are, the largest linear, planar and spherical coefficient among them (so   *
+*  a thresholded view can skip the brick unread), and their checksum.         *
+*                                                                             *
+*******************************************************************************/
+struct BrickEntry
+{
+
+	uint64_t       offset;
+	uint32_t       count;
+	GLfloat        max_c[3];
+	uint64_t       checksum;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                  BrickFile        (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  file                                                                       *
+*           Temporary file being written, or NULL.                            *
+*  brick_path                                                                 *
+*           Path the temporary file replaces when it is finished.             *
+*  temp_path                                                                  *
+*           Path of the temporary file.                                       *
+*  header                                                                     *
+*           Header of the file being written.                                 *
+*  entries                                                                    *
+*           Directory of the file being written.                              *
+*  layer                                                                      *
+*           Samples of the current layer of bricks, one list per brick.       *
+*  z_layer                                                                    *
+*           Index of the layer being gathered.                                *
+*  ok                                                                         *
+*           Whether every write so far has succeeded.                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads and writes .tbrick files: the significant splats of a tensor field   *
+*  regrouped into BRICK_SIZE cubes, so any brick can be read on its own. A    *
+*  BrickFile object writes one file from a loader's slabs. These arrive in    *
+*  z order, so only one layer of bricks is ever held in memory; each layer is *
+*  written out as soon as the first slab past it arrives.                     *
+*                                                                             *
+*******************************************************************************/
+class BrickFile
+{
+
+public:
+
+	// Constructors. An unfinished file is deleted.
+	BrickFile();
+	~BrickFile();
+
+	// Start writing a brick file for the given source key.
+	bool create(const std::string& brick_path, uint64_t key);
+
+	// Append a slab of samples of the given field.
+	void append(const TensorField* tf, const SampleList& samples);
+
+	// Complete the file, or throw it away.
+	bool finish();
+	void abort();
+
+	// Open a brick file and read its directory; NULL if it is missing,
+	// stale or corrupt. The caller closes the file.
+	static FILE* open(const std::string& brick_path, uint64_t key,
+		BrickFileHeader& header, std::vector<BrickEntry>& entries);
+
+	// Read and check the records of one brick.
+	static bool read_brick(FILE* file, const BrickFileHeader& header,
+		const BrickEntry& entry, GLuint brick, SampleList& samples);
+
+	// Number of bricks needed to cover size voxels.
+	static GLuint bricks_along(GLuint size)
+	{
+		return (size + BRICK_SIZE - 1) / BRICK_SIZE;
+	}
+
+private:
+
+	FILE*                      file;
+	std::string                brick_path;
+	std::string                temp_path;
+	BrickFileHeader            header;
+	std::vector<BrickEntry>    entries;
+	std::vector<SampleList>    layer;
+	GLuint                     z_layer;
+	bool                       ok;
+
+	// Write the gathered layer of bricks.
+	void flush_layer();
+
+	// Writers are not copyable.
+	BrickFile(const BrickFile& other);
+	BrickFile& operator=(const BrickFile& other);
+
+};
@@ -0,0 +1,214 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "CompactSplat.h"
+#include "TensorSplat.h"
+#include <glm\gtc\packing.hpp>
+#include <glm\gtc\constants.hpp>
+#include <cmath>
+#include <algorithm>
+
+/******************************************************************************
+*                                                                             *
+*                               eigen_symmetric                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  T                                                                          *
+*           A symmetric 3 x 3 matrix.                                         *
+*  values                                                                     *
+*           Receives its eigenvalues.                                         *
+*  vectors                                                                    *
+*           Receives the matching unit eigenvectors, one per column.          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Cyclic Jacobi: rotates away each off-diagonal element in turn until they   *
+*  are all negligible, which for a 3 x 3 takes a handful of sweeps. Works in  *
+*  double precision so the float tensor is the only source of error.          *
+*                                                                             *
+*******************************************************************************/
+static void eigen_symmetric(const glm::mat3& T, double values[3], double vectors[3][3])
+{
+	static const GLuint pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+	double a[3][3];
+	for (GLuint r = 0; r < 3; r++)
+	for (GLuint c = 0; c < 3; c++)
+	{
+		a[r][c] = 0.5 * ((double)T[c][r] + T[r][c]);
+		vectors[r][c] = (r == c) ? 1 : 0;
+	}
+
+	for (GLuint sweep = 0; sweep < COMPACT_JACOBI_SWEEPS; sweep++)
+	{
+		double diagonal = (a[0][0] * a[0][0]) + (a[1][1] * a[1][1]) + (a[2][2] * a[2][2]);
+		double off = (a[0][1] * a[0][1]) + (a[0][2] * a[0][2]) + (a[1][2] * a[1][2]);
+		if (off <= diagonal * 1e-30)
+			break;
+
+		for (GLuint n = 0; n < 3; n++)
+		{
+			GLuint p = pairs[n][0], q = pairs[n][1];
+			if (a[p][q] == 0)
+				continue;
+
+			double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+			double t = ((theta < 0) ? -1 : 1) / (std::fabs(theta) + std::sqrt((theta * theta) + 1));
+			double c = 1 / std::sqrt((t * t) + 1), s = t * c;
+			for (GLuint k = 0; k < 3; k++)
+			{
+				double kp = a[k][p], kq = a[k][q];
+				a[k][p] = (c * kp) - (s * kq);
+				a[k][q] = (s * kp) + (c * kq);
+			}
+			for (GLuint k = 0; k < 3; k++)
+			{
+				double pk = a[p][k], qk = a[q][k];
+				a[p][k] = (c * pk) - (s * qk);
+				a[q][k] = (s * pk) + (c * qk);
+			}
+			for (GLuint k = 0; k < 3; k++)
+			{
+				double kp = vectors[k][p], kq = vectors[k][q];
+				vectors[k][p] = (c * kp) - (s * kq);
+				vectors[k][q] = (s * kp) + (c * kq);
+			}
+		}
+	}
+
+	for (GLuint n = 0; n < 3; n++)
+		values[n] = a[n][n];
+}
+
+/******************************************************************************
+*                                                                             *
+*                                 roll_frame                                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Two unit vectors perpendicular to axis and to each other, from which the   *
+*  roll of the second eigenvector is measured. Encoder and decoder build it   *
+*  from the same decoded axis, so they agree exactly.                         *
+*                                                                             *
+*******************************************************************************/
+static void roll_frame(const glm::vec3& axis, glm::vec3& b1, glm::vec3& b2)
+{
+	glm::vec3 helper = (std::fabs(axis.x) < 0.9f) ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+	b1 = glm::normalize(glm::cross(axis, helper));
+	b2 = glm::cross(axis, b1);
+}
+
+// Unit vector of the upper hemisphere held in hemi-octahedral form.
+static glm::vec3 decode_axis(const int16_t axis[2])
+{
+	GLfloat u = axis[0] / COMPACT_AXIS_SCALE;
+	GLfloat v = axis[1] / COMPACT_AXIS_SCALE;
+	glm::vec2 p(0.5f * (u + v), 0.5f * (u - v));
+	return glm::normalize(glm::vec3(p, 1.0f - (std::fabs(p.x) + std::fabs(p.y))));
+}
+
+/******************************************************************************
+*                                                                             *
+*                               compact_encode                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  T                                                                          *
+*           The 3 x 3 tensor, symmetric.                                      *
+*  c                                                                          *
+*           Its spherical, linear and planar coefficients.                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The compact form of the tensor.                                            *
+*                                                                             *
+*******************************************************************************/
+CompactSplat compact_encode(const glm::mat3& T, const GLfloat c[3])
+{
+	double values[3], vectors[3][3];
+	eigen_symmetric(T, values, vectors);
+
+	GLuint order[3] = { 0, 1, 2 };
+	std::sort(order, order + 3, [&](GLuint a, GLuint b) { return values[a] > values[b]; });
+
+	CompactSplat splat;
+	for (GLuint n = 0; n < 3; n++)
+		splat.eigenvalues[n] = glm::packHalf1x16((GLfloat)values[order[n]]);
+
+	// Either sign of the axis will do; take the one pointing up.
+	glm::vec3 v1(vectors[0][order[0]], vectors[1][order[0]], vectors[2][order[0]]);
+	glm::vec3 v2(vectors[0][order[1]], vectors[1][order[1]], vectors[2][order[1]]);
+	if (v1.z < 0)
+		v1 = -v1;
+	glm::vec2 p = glm::vec2(v1) / (std::fabs(v1.x) + std::fabs(v1.y) + v1.z);
+	splat.axis[0] = (int16_t)std::floor((glm::clamp(p.x + p.y, -1.0f, 1.0f) *
+		COMPACT_AXIS_SCALE) + 0.5f);
+	splat.axis[1] = (int16_t)std::floor((glm::clamp(p.x - p.y, -1.0f, 1.0f) *
+		COMPACT_AXIS_SCALE) + 0.5f);
+
+	// Measure the roll against the axis as it will be decoded.
+	glm::vec3 b1, b2;
+	roll_frame(decode_axis(splat.axis), b1, b2);
+	double angle = std::atan2(glm::dot(v2, b2), glm::dot(v2, b1));
+	if (angle < 0)
+		angle += glm::pi<double>();
+	long steps = (long)std::floor((angle / glm::pi<double>() * COMPACT_ROLL_STEPS) + 0.5);
+	splat.roll = (uint16_t)(steps & 0xFFFF);
+
+	splat.c_linear = (uint8_t)std::floor((glm::clamp(c[LINEAR], 0.0f, 1.0f) *
+		COMPACT_METRIC_SCALE) + 0.5f);
+	splat.c_planar = (uint8_t)std::floor((glm::clamp(c[PLANAR], 0.0f, 1.0f) *
+		COMPACT_METRIC_SCALE) + 0.5f);
+	return splat;
+}
+
+/******************************************************************************
+*                                                                             *
+*                               compact_tensor                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Rebuilds the eigenvectors from the axis and roll and sums each eigenvalue  *
+*  times the outer product of its eigenvector.                                *
+*                                                                             *
+*******************************************************************************/
+glm::mat3 compact_tensor(const CompactSplat& splat)
+{
+	glm::vec3 v[3], b1, b2;
+	v[0] = decode_axis(splat.axis);
+	roll_frame(v[0], b1, b2);
+	GLfloat angle = (GLfloat)(splat.roll * glm::pi<double>() / COMPACT_ROLL_STEPS);
+	v[1] = (std::cos(angle) * b1) + (std::sin(angle) * b2);
+	v[2] = glm::cross(v[0], v[1]);
+
+	glm::mat3 T(0.0f);
+	for (GLuint n = 0; n < 3; n++)
+	{
+		GLfloat value = glm::unpackHalf1x16(splat.eigenvalues[n]);
+		T += glm::outerProduct(v[n], v[n] * value);
+	}
+	return T;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      compact_coefficient / compact_color                    *
+*                                                                             *
+*******************************************************************************/
+GLfloat compact_coefficient(const CompactSplat& splat, GLuint metric)
+{
+	GLfloat c_linear = splat.c_linear / COMPACT_METRIC_SCALE;
+	GLfloat c_planar = splat.c_planar / COMPACT_METRIC_SCALE;
+	return (metric == LINEAR) ? c_linear : (metric == PLANAR) ? c_planar :
+		1.0f - (c_linear + c_planar);
+}
+glm::vec4 compact_color(const CompactSplat& splat)
+{
+	GLfloat c_linear = splat.c_linear / COMPACT_METRIC_SCALE;
+	GLfloat c_planar = splat.c_planar / COMPACT_METRIC_SCALE;
+	GLfloat sum = c_linear + c_planar;
+	GLfloat c_f = (sum == 0) ? 0 : c_linear / sum;
+	return glm::vec4{ 1.0 - c_f, c_f, 0.0, std::exp(-2 * (1.0f - sum)) };
+}
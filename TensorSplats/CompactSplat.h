@@ -0,0 +1,70 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+#include <stdint.h>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define COMPACT_METRIC_SCALE    255.0f
+#define COMPACT_AXIS_SCALE      32767.0f
+#define COMPACT_ROLL_STEPS      65536.0
+#define COMPACT_JACOBI_SWEEPS   16
+
+/******************************************************************************
+*                                                                             *
+*                              CompactSplat     (struct)                      *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  eigenvalues                                                                *
+*           The tensor's eigenvalues, largest first, as half floats.          *
+*  axis                                                                       *
+*           Eigenvector of the largest eigenvalue, turned into the upper      *
+*           hemisphere and stored in hemi-octahedral form, in steps of        *
+*           1 / COMPACT_AXIS_SCALE.                                           *
+*  roll                                                                       *
+*           Angle of the second eigenvector around the first, over [0, pi);   *
+*           the third is their cross product.                                 *
+*  c_linear, c_planar                                                         *
+*           Westin coefficients in steps of 1 / COMPACT_METRIC_SCALE. The     *
+*           spherical coefficient is what remains of 1.                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A splat's tensor and metrics in 14 bytes instead of 60. Its position is    *
+*  not stored at all: it follows from its voxel and the field's voxel-to-     *
+*  world transform, and its color from its metrics, as make_sample derives    *
+*  them. Eigenvector signs are arbitrary, so only their axes are kept.        *
+*                                                                             *
+*******************************************************************************/
+struct CompactSplat
+{
+
+	uint16_t       eigenvalues[3];
+	int16_t        axis[2];
+	uint16_t       roll;
+	uint8_t        c_linear;
+	uint8_t        c_planar;
+
+};
+
+// Encode a symmetric tensor and its Westin coefficients.
+CompactSplat compact_encode(const glm::mat3& T, const GLfloat c[3]);
+
+// Rebuild the tensor of a compact splat.
+glm::mat3 compact_tensor(const CompactSplat& splat);
+
+// The SPHERICAL, LINEAR or PLANAR coefficient of a compact splat.
+GLfloat compact_coefficient(const CompactSplat& splat, GLuint metric);
+
+// The color make_sample gives a tensor with the splat's coefficients.
+glm::vec4 compact_color(const CompactSplat& splat);
@@ -1,389 +1,786 @@
-/******************************************************************************
-*                                                                             *
-*                              Included Header Files                          *
-*                                                                             *
-******************************************************************************/
-#include <gl\glew.h>
-#include <glm\glm.hpp>
-#include <glm\gtc\matrix_transform.hpp>
-#include <glm\gtx\transform.hpp>
-#include <SDL\SDL_video.h>
-#include <iostream>
-#include "Display.h"
-#include "TensorSplat.h"
-
-/******************************************************************************
-*                                                                             *
-*                          Display::Display (Constructor)                     *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  @param title                                                               *
-*           The title of the window to be displayed in the toolbar.           *
-*  @param width                                                               *
-*           The width of the window in pixels.                                *
-*  @param height                                                              *
-*           The height of the window in pixels.                               *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Constructor for the Display class. This constructor creates the window and *
-*  the GL context using SDL (Simple Directmedia Layer) and initializes GLEW.  *
-*  GLEW (GL Extension Wrangler Library) "binds" all of OpenGL's functions     *
-*  to the hardware-specific implementation (OpenGL acts as an Adapter Class)  *
-*                                                                             *
-*******************************************************************************/
-Display::Display(std::string title, GLushort width, GLushort height) :
-mesh_shader(nullptr), splat_shader(nullptr)
-{
-	GLuint x, y;
-	getCenterPos(&x, &y, width, height);
-
-	/* Create the SDL window. */
-	window = SDL_CreateWindow(title.c_str(), x, y, width, height, 
-		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
-
-	/* Create the SDL GL context. */
-	context = SDL_GL_CreateContext(window);
-
-	/* Set the clear color to default. */
-	glClearColor(DEFAULT_CLEAR_COLOR);
-
-	// Enable alpha blending.
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	/* Initialize GLEW (binds all of OpenGL's functions to the hardware). */
-	GLenum status = glewInit();
-
-	/* Validate GLEW initialized correctly. */
-	if (status != GLEW_OK)
-	{
-		/* If the functions were not bound, output error. */
-		std::cerr << "Glew failed to initialize!" << std::endl;
-		std::cerr << "Status: " << glewGetErrorString(status) << std::endl;
-	}
-
-	/* Show the version of GLEW currently being used. */
-	fprintf(stdout, "Stats: Using GLEW %s\n", glewGetString(GLEW_VERSION));
-	
-	/* Update the viewport. */
-	updateViewport();
-
-	createShaders();
-
-	t = 0;
-	ambient_color  = glm::vec4{ 0.05, 0.05, 0.05, 1.0 };
-	diffuse_color  = glm::vec4{ 1.0, 1.0, 1.0, 1.0 };
-	specular_color = glm::vec4{ 1.0, 1.0, 1.0, 1.0 };
-	shininess = 10;
-
-}
-
-
-void Display::createShaders()
-{
-
-	splat_shader = new Shader(SPLAT_VERTEX_SHADER, SPLAT_FRAGMENT_SHADER);
-	splat_shader->use();
-
-	model_to_projection_UL_b = glGetUniformLocation(
-		splat_shader->getProgram(), "model_to_projection");
-	model_to_world_UL_b = glGetUniformLocation(
-		splat_shader->getProgram(), "model_to_world");
-	light_position_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "light_position");
-	ambient_color_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "ambient_color");
-	diffuse_color_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "diffuse_color");
-	specular_color_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "specular_color");
-	shininess_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "shininess");
-	c_0_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "C_0");
-	eye_pos_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "eye_position");
-	color_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "color");
-	texture_UL = glGetUniformLocation(
-		splat_shader->getProgram(), "texture");
-}
-
-/******************************************************************************
-*                                                                             *
-*                        Display::getScreenDimension                          *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  @param d                                                                   *
-*        Dimension to get (height or width).                                  *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  The value of the number of pixels wide the specified dimension is for the  *
-*  specified display.                                                         *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Function which returns the width or height of the display.                 *
-*                                                                             *
-*******************************************************************************/
-GLushort Display::getScreenDimension(Dimension d) 
-{
-	/* Place the dimensions of the screen in an SDL_Rect struct. */
-	SDL_Rect display;
-	SDL_GetDisplayBounds(0, &display);
-	
-	/* Return the indicated Dimension. */
-	if(d == Dimension::HEIGHT)
-		return display.h;
-	else if(d == Dimension::WIDTH)
-		return display.w;
-	else
-		return -1;
-}
-
-/******************************************************************************
-*                                                                             *
-*                        Display::getWindownDimension                         *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  @param d                                                                   *
-*        Dimension to get (height or width).                                  *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  The value of the number of pixels wide the specified dimension is for the  *
-*  specified window.                                                         *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Function which returns the width or height of the window.                  *
-*                                                                             *
-*******************************************************************************/
-GLushort Display::getWindowDimension(Dimension d)
-{
-	/* Place the dimensions of the screen in an SDL_Rect struct. */
-	GLint h, w;
-	SDL_GL_GetDrawableSize(window, &w, &h);
-
-	/* Return the indicated Dimension. */
-	if (d == Dimension::HEIGHT)
-		return (GLushort) h;
-	else if (d == Dimension::WIDTH)
-		return (GLushort) w;
-	else
-		return -1;
-}
-
-
-/******************************************************************************
-*                                                                             *
-*                              Display::maximize                              *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Maximizes the SDL Window to the current screen.                            *
-*                                                                             *
-*******************************************************************************/
-void Display::maximize()
-{
-	/* Maximize the window. */
-	SDL_MaximizeWindow(window);
-}
-
-/******************************************************************************
-*                                                                             *
-*                           Display::updateViweport                           *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Function which gets the width and height of the window and updates the     *
-*  aspect ratio, the glViewwport, and the viewToPorojectionMatrix for the     *
-*  display.                                                                   *
-*                                                                             *
-*******************************************************************************/
-void Display::updateViewport()
-{
-	/* Get the width and height of the window and calculate aspect ratio. */
-	GLint width, height;
-	SDL_GetWindowSize(window, &width, &height);
-	aspectRatio = (GLfloat)width / height;
-
-	/* Update the GLviewport. */
-	glViewport(0, 0, width, height);
-
-	/* Calculate the View-To-Projection matrix. */
-	viewToProjectionMatrix = glm::perspectiveFov((GLfloat) DEFAULT_FOV, 
-		(GLfloat) width,  (GLfloat) height, DEFAULT_NEAR_PLANE,
-		DEFAULT_FAR_PLANE);
-
-}
-
-/******************************************************************************
-*                                                                             *
-*                             Display::repaint                                *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  @param meshes                                                              *
-*           Vector of Mesh objects to be displayed to the screen.             *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Function which clears the window by changing all of the pixels to the      *
-*  specified color and opacity.                                               *
-*                                                                             *
-*******************************************************************************/
-void Display::repaint(std::vector<TensorSplat*>& splats)
-{
-	/* Tell OpenGL to clear the color buffer and depth buffer. */
-	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);	
-
-	/* Get the window dimensions and update the viewport. */
-	updateViewport();
-
-	modelToProjectionMatrix = viewToProjectionMatrix * camera.getWorldToViewMatrix();
-
-	t += 0.001f;
-
-	GLfloat x_radius = 40.0f, y_radius = 40.0f;
-	light_position = glm::vec4{ cosf(t)  * x_radius, 5.0f, sinf(t) * y_radius, 1.0f };
-	
-	splat_shader->use();
-	
-	glUniform4fv(light_position_UL, 1, &(light_position.x));
-	glUniform4fv(ambient_color_UL, 1, &(ambient_color.x));
-	glUniform4fv(diffuse_color_UL, 1, &(diffuse_color.x));
-	glUniform4fv(specular_color_UL, 1, &(specular_color.x));
-	glUniform1f(shininess_UL, shininess);
-	glUniform4fv(eye_pos_UL, 1, &(camera.getPosition()->x));
-	glUniform1i(texture_UL, 0);
-
-	glm::vec3 cam_view = *camera.getViewDirection();
-	glm::vec3 cam_right_side = glm::cross(cam_view, *camera.getUpDirection());
-	glm::vec3 cam_up = glm::normalize(glm::cross(cam_right_side, cam_view));
-
-	glm::mat4 id;
-	for (TensorSplat* splat : splats)
-	{	
-		splat->recalculate(*camera.getPosition(), cam_up);
-	
-		/* Bind the appropriate Vertex Array. */
-		glBindVertexArray(splat->vertexArrayID);
-	
-		/* Bind the appropriate Index Array. */
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, splat->bufferIDs[1]);
-
-		glm::vec3 eye_position = *(camera.getPosition());
-		glUniformMatrix4fv(model_to_world_UL_b, 1, GL_FALSE,
-			&(id[0][0]));
-		glUniformMatrix4fv(model_to_projection_UL_b, 1, GL_FALSE,
-			&modelToProjectionMatrix[0][0]);
-		glUniform3fv(c_0_UL, 1, &(eye_position.x));
-		glUniform4fv(color_UL, 1, &(splat->color.x));
-	
-		glDrawElements(splat->drawMode, 4, GL_UNSIGNED_INT, 0);
-	}
-
-	/* Swap the double buffer. */
-	SDL_GL_SwapWindow(window);
-
-}
-
-/******************************************************************************
-*                                                                             *
-*                             Display::setShader                              *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  @param shader                                                              *
-*        The shader object to be used for rendering the geometry.             *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Tells OpenGL to use the indicated shader for rendering, and gets the       *
-*  location IDs of the uniform variables inside the shader program.           *
-*                                                                             *
-*******************************************************************************/
-void Display::setShader(Shader* shader)
-{
-	/* Tell OpenGL to use this shader. */
-	shader->use();
-
-	/* Bind the indicated data attributes to the variables. */
-	glBindAttribLocation(shader->getProgram(), A_0_ATTRIB, "A_0");
-	glBindAttribLocation(shader->getProgram(), A_1_ATTRIB, "A_1");
-	glBindAttribLocation(shader->getProgram(), A_2_ATTRIB, "A_2");
-	glBindAttribLocation(shader->getProgram(), A_3_ATTRIB, "A_3");
-}
-
-void Display::getCenterPos(GLuint* x, GLuint* y, GLuint width, GLuint height)
-{
-	*x = (getScreenDimension(Dimension::WIDTH) - width) / 2;
-	*y = (getScreenDimension(Dimension::HEIGHT) - width) / 2;
-}
-
-/******************************************************************************
-*                                                                             *
-*                           Display::~Display (Destructor)                    *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* RETURNS                                                                     *
-*  void                                                                       *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Constructor for the Display class. This constructor creates the window and *
-*  the GL context using SDL (Simple Directmedia Layer) and initializes GLEW.  *
-*  GLEW (GL Extension Wrangler Library) "binds" all of OpenGL's functions     *
-*  to the hardware-specific implementation (OpenGL acts as an Adapter Class)  *
-*                                                                             *
-*******************************************************************************/
-Display::~Display()
-{
-	/* Delete shaders. */
-	delete mesh_shader;
-	delete splat_shader;
-
-	/* Delete the GL context. */
-	SDL_GL_DeleteContext(context);
-
-	/* Destroy the window. */
-	SDL_DestroyWindow(window);
-}
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <gl\glew.h>
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtx\transform.hpp>
+#include <SDL\SDL_video.h>
+#include <SDL\SDL_image.h>
+#include <cstddef>
+#include <iostream>
+#include <algorithm>
+#include "Display.h"
+#include "TensorSplat.h"
+
+/******************************************************************************
+*                                                                             *
+*                          Display::Display (Constructor)                     *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param title                                                               *
+*           The title of the window to be displayed in the toolbar.           *
+*  @param width                                                               *
+*           The width of the window in pixels.                                *
+*  @param height                                                              *
+*           The height of the window in pixels.                               *
+*  @param hidden                                                              *
+*           Whether to keep the window off the screen, for frames that are    *
+*           only read back.                                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the Display class. This constructor creates the window and *
+*  the GL context using SDL (Simple Directmedia Layer) and initializes GLEW.  *
+*  GLEW (GL Extension Wrangler Library) "binds" all of OpenGL's functions     *
+*  to the hardware-specific implementation (OpenGL acts as an Adapter Class)  *
+*                                                                             *
+*******************************************************************************/
+Display::Display(std::string title, GLushort width, GLushort height, bool hidden) :
+mesh_shader(nullptr), splat_shader(nullptr), splat_buffer(0), splat_array(0),
+geometry(geometry_pool),
+instancing_supported(false), instancing(false), instance_buffer(0), instance_array(0), drawn_store(0), drawn_revision(0),
+invalid(true), drawn_screen(DRAWN_NOTHING), drawn_width(0), drawn_height(0), drawn_camera(0),
+loading_texture(0), loading_width(0), loading_height(0)
+{
+	GLuint x, y;
+	getCenterPos(&x, &y, width, height);
+
+	/* Create the SDL window. */
+	window = SDL_CreateWindow(title.c_str(), x, y, width, height, 
+		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | (hidden ? SDL_WINDOW_HIDDEN : 0));
+
+	/* Create the SDL GL context. */
+	context = SDL_GL_CreateContext(window);
+
+	/* Set the clear color to default. */
+	glClearColor(DEFAULT_CLEAR_COLOR);
+
+	// Enable alpha blending.
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	/* Initialize GLEW (binds all of OpenGL's functions to the hardware). */
+	GLenum status = glewInit();
+
+	/* Validate GLEW initialized correctly. */
+	if (status != GLEW_OK)
+	{
+		/* If the functions were not bound, output error. */
+		std::cerr << "Glew failed to initialize!" << std::endl;
+		std::cerr << "Status: " << glewGetErrorString(status) << std::endl;
+	}
+
+	/* Show the version of GLEW currently being used. */
+	fprintf(stdout, "Stats: Using GLEW %s\n", glewGetString(GLEW_VERSION));
+	
+	/* Update the viewport. */
+	updateViewport();
+
+	createShaders();
+	createSplatBuffers();
+
+	t = 0;
+	ambient_color  = glm::vec4{ 0.05, 0.05, 0.05, 1.0 };
+	diffuse_color  = glm::vec4{ 1.0, 1.0, 1.0, 1.0 };
+	specular_color = glm::vec4{ 1.0, 1.0, 1.0, 1.0 };
+	shininess = 10;
+
+}
+
+
+void Display::createShaders()
+{
+
+	splat_shader = new Shader(SPLAT_VERTEX_SHADER, SPLAT_FRAGMENT_SHADER);
+	splat_shader->use();
+
+	model_to_projection_UL_b = glGetUniformLocation(
+		splat_shader->getProgram(), "model_to_projection");
+	model_to_world_UL_b = glGetUniformLocation(
+		splat_shader->getProgram(), "model_to_world");
+	light_position_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "light_position");
+	ambient_color_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "ambient_color");
+	diffuse_color_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "diffuse_color");
+	specular_color_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "specular_color");
+	shininess_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "shininess");
+	c_0_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "C_0");
+	eye_pos_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "eye_position");
+	texture_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "texture");
+	instanced_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "instanced");
+	up_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "up");
+	origin_UL = glGetUniformLocation(
+		splat_shader->getProgram(), "origin");
+
+	/* Look up where the linker put each vertex attribute. */
+	const char* attrib_names[SPLAT_NUM_ATTRIBS] = { "A_0", "A_1", "A_2", "A_3", "color" };
+	for (GLuint a = 0; a < SPLAT_NUM_ATTRIBS; a++)
+		splat_attribs[a] = glGetAttribLocation(splat_shader->getProgram(), attrib_names[a]);
+	const char* instance_names[SPLAT_NUM_INSTANCE_ATTRIBS] =
+		{ "center", "tensor", "tensor_inv", "tensor_inv_sq", "color" };
+	for (GLuint a = 0; a < SPLAT_NUM_INSTANCE_ATTRIBS; a++)
+		instance_attribs[a] = glGetAttribLocation(splat_shader->getProgram(), instance_names[a]);
+}
+
+/******************************************************************************
+*                                                                             *
+*                        Display::createSplatBuffers                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Creates the only graphics objects splats are drawn with: one vertex buffer *
+*  refilled with every splat's bounding quad each frame, and the vertex array *
+*  describing its TensorSplat_Vertex layout. Where GL 3.3 instancing is       *
+*  available, also one buffer of TensorSplat_Instance records, one per splat, *
+*  and a vertex array reading one record per instance of a four-vertex quad,  *
+*  for the shader to expand the splats instead once setInstancing asks it to. *
+*  Their number does not depend on the size of the field.                     *
+*                                                                             *
+*******************************************************************************/
+void Display::createSplatBuffers()
+{
+	const GLuint sizes[SPLAT_NUM_ATTRIBS] = { 3, 3, 3, 3, 4 };
+	const size_t offsets[SPLAT_NUM_ATTRIBS] =
+		{ A_0_OFFSET, A_1_OFFSET, A_2_OFFSET, A_3_OFFSET, COLOR_OFFSET };
+
+	glGenBuffers(1, &splat_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, splat_buffer);
+
+	glGenVertexArrays(1, &splat_array);
+	glBindVertexArray(splat_array);
+	for (GLuint a = 0; a < SPLAT_NUM_ATTRIBS; a++)
+	{
+		if (splat_attribs[a] < 0)
+			continue;
+		glEnableVertexAttribArray(splat_attribs[a]);
+		glVertexAttribPointer(splat_attribs[a], sizes[a], GL_FLOAT, GL_FALSE,
+			sizeof(TensorSplat_Vertex), (void*)offsets[a]);
+	}
+	glBindVertexArray(0);
+
+	instancing_supported = GLEW_VERSION_3_3 && instance_attribs[0] >= 0;
+	instancing = SPLAT_INSTANCING_ENABLED && instancing_supported;
+	if (!instancing_supported)
+		return;
+
+	/* A mat3 takes three attribute locations, one per column. */
+	const GLuint columns[SPLAT_NUM_INSTANCE_ATTRIBS] = { 1, 3, 3, 3, 1 };
+	const GLuint instance_sizes[SPLAT_NUM_INSTANCE_ATTRIBS] = { 3, 3, 3, 3, 4 };
+	const size_t instance_offsets[SPLAT_NUM_INSTANCE_ATTRIBS] =
+	{
+		offsetof(TensorSplat_Instance, center), offsetof(TensorSplat_Instance, tensor),
+		offsetof(TensorSplat_Instance, tensor_inv), offsetof(TensorSplat_Instance, tensor_inv_sq),
+		offsetof(TensorSplat_Instance, color)
+	};
+
+	glGenBuffers(1, &instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+
+	glGenVertexArrays(1, &instance_array);
+	glBindVertexArray(instance_array);
+	for (GLuint a = 0; a < SPLAT_NUM_INSTANCE_ATTRIBS; a++)
+	{
+		if (instance_attribs[a] < 0)
+			continue;
+		for (GLuint c = 0; c < columns[a]; c++)
+		{
+			GLuint location = instance_attribs[a] + c;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, instance_sizes[a], GL_FLOAT, GL_FALSE,
+				sizeof(TensorSplat_Instance),
+				(void*)(instance_offsets[a] + (c * sizeof(glm::vec3))));
+			glVertexAttribDivisor(location, 1);
+		}
+	}
+	glBindVertexArray(0);
+}
+
+/******************************************************************************
+*                                                                             *
+*                        Display::getScreenDimension                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param d                                                                   *
+*        Dimension to get (height or width).                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The value of the number of pixels wide the specified dimension is for the  *
+*  specified display.                                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Function which returns the width or height of the display.                 *
+*                                                                             *
+*******************************************************************************/
+GLushort Display::getScreenDimension(Dimension d) 
+{
+	/* Place the dimensions of the screen in an SDL_Rect struct. */
+	SDL_Rect display;
+	SDL_GetDisplayBounds(0, &display);
+	
+	/* Return the indicated Dimension. */
+	if(d == Dimension::HEIGHT)
+		return display.h;
+	else if(d == Dimension::WIDTH)
+		return display.w;
+	else
+		return -1;
+}
+
+/******************************************************************************
+*                                                                             *
+*                        Display::getWindownDimension                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param d                                                                   *
+*        Dimension to get (height or width).                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The value of the number of pixels wide the specified dimension is for the  *
+*  specified window.                                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Function which returns the width or height of the window.                  *
+*                                                                             *
+*******************************************************************************/
+GLushort Display::getWindowDimension(Dimension d)
+{
+	/* Place the dimensions of the screen in an SDL_Rect struct. */
+	GLint h, w;
+	SDL_GL_GetDrawableSize(window, &w, &h);
+
+	/* Return the indicated Dimension. */
+	if (d == Dimension::HEIGHT)
+		return (GLushort) h;
+	else if (d == Dimension::WIDTH)
+		return (GLushort) w;
+	else
+		return -1;
+}
+
+
+/******************************************************************************
+*                                                                             *
+*                              Display::maximize                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Maximizes the SDL Window to the current screen.                            *
+*                                                                             *
+*******************************************************************************/
+void Display::maximize()
+{
+	/* Maximize the window. */
+	SDL_MaximizeWindow(window);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Display::updateViweport                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Function which gets the width and height of the window and updates the     *
+*  aspect ratio, the glViewwport, and the viewToPorojectionMatrix for the     *
+*  display.                                                                   *
+*                                                                             *
+*******************************************************************************/
+void Display::updateViewport()
+{
+	/* Get the width and height of the window and calculate aspect ratio. */
+	GLint width, height;
+	SDL_GetWindowSize(window, &width, &height);
+	aspectRatio = (GLfloat)width / height;
+
+	/* Update the GLviewport. */
+	glViewport(0, 0, width, height);
+
+	/* Calculate the View-To-Projection matrix. */
+	viewToProjectionMatrix = glm::perspectiveFov((GLfloat) DEFAULT_FOV, 
+		(GLfloat) width,  (GLfloat) height, DEFAULT_NEAR_PLANE,
+		DEFAULT_FAR_PLANE);
+
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Display::repaint                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param store                                                               *
+*           Store holding the splats.                                         *
+*  @param splats                                                              *
+*           Slots of the splats to be displayed to the screen.                *
+*  @param pixels                                                              *
+*           If given, receives the frame drawn, as bottom-up rows of RGBA     *
+*           bytes, read back before the buffers are swapped.                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Function which clears the window by changing all of the pixels to the      *
+*  specified color and opacity, and draws the splats. The splats are brought *
+*  up to date first, on the geometry pool, by geometry; only then does the GL *
+*  thread touch GL, and it uploads the whole frame at once if anything        *
+*  changed. When instancing, the shader expands them instead, and their       *
+*  instances are copied and uploaded only when the store or the slots drawn   *
+*  have changed since the last frame, so a still field costs nothing per      *
+*  frame but the draw call. A frame that would draw exactly what the window   *
+*  shows, with no quad left beyond the view tolerance, is not drawn at all.   *
+*  The light's orbit only advances on frames drawn for some other reason.     *
+*                                                                             *
+*******************************************************************************/
+void Display::repaint(const SplatStore& store, const Slice& splats,
+	std::vector<GLubyte>* pixels)
+{
+	glm::vec3 cam_view = *camera.getViewDirection();
+	glm::vec3 cam_right_side = glm::cross(cam_view, *camera.getUpDirection());
+	glm::vec3 cam_up = glm::normalize(glm::cross(cam_right_side, cam_view));
+	glm::vec3 eye_position = *(camera.getPosition());
+
+	/* The splats are those last drawn if neither the store nor the slots
+	   have changed since. */
+	bool same_splats = (store.identity() == drawn_store) &&
+		(store.revision() == drawn_revision) &&
+		(drawn_slots.size() == splats.count) &&
+		std::equal(splats.slots, splats.slots + splats.count, drawn_slots.begin());
+
+	/* Skip the frame if it would draw what the window already shows, with
+	   no quad left beyond the view tolerance. */
+	if (!needsRepaint(DRAWN_SPLATS) && same_splats && geometry.stale_count() == 0)
+		return;
+	if (!same_splats)
+	{
+		drawn_store = store.identity();
+		drawn_revision = store.revision();
+		drawn_slots.assign(splats.slots, splats.slots + splats.count);
+	}
+
+	/* Expand the splats across the geometry pool, or copy their instances,
+	   if they have changed. */
+	size_t num_vertices = splats.count * SPLAT_NUM_VERTICES;
+	size_t num_tasks = (splats.count + SPLAT_TASK_SIZE - 1) / SPLAT_TASK_SIZE;
+	bool upload = false;
+	if (instancing)
+	{
+		upload = !same_splats;
+		if (upload)
+		{
+			if (splat_instances.size() < splats.count)
+				splat_instances.resize(splats.count);
+			geometry_pool.parallel_for(num_tasks, [&](size_t task)
+			{
+				size_t first = task * SPLAT_TASK_SIZE;
+				size_t count = std::min(splats.count - first, (size_t)SPLAT_TASK_SIZE);
+				store.get_instances(&splats.slots[first], count, &splat_instances[first]);
+			});
+		}
+	}
+	else
+	{
+		upload = geometry.update(store, splats, !same_splats, eye_position, cam_up);
+	}
+
+	/* Tell OpenGL to clear the color buffer and depth buffer. */
+	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);	
+
+	/* Get the window dimensions and update the viewport. */
+	updateViewport();
+
+	modelToProjectionMatrix = viewToProjectionMatrix * camera.getWorldToViewMatrix();
+
+	t += 0.001f;
+
+	GLfloat x_radius = 40.0f, y_radius = 40.0f;
+	light_position = glm::vec4{ cosf(t)  * x_radius, 5.0f, sinf(t) * y_radius, 1.0f };
+	
+	splat_shader->use();
+	
+	glUniform4fv(light_position_UL, 1, &(light_position.x));
+	glUniform4fv(ambient_color_UL, 1, &(ambient_color.x));
+	glUniform4fv(diffuse_color_UL, 1, &(diffuse_color.x));
+	glUniform4fv(specular_color_UL, 1, &(specular_color.x));
+	glUniform1f(shininess_UL, shininess);
+	glUniform4fv(eye_pos_UL, 1, &(camera.getPosition()->x));
+	glUniform1i(texture_UL, 0);
+
+	glm::mat4 id;
+	glUniformMatrix4fv(model_to_world_UL_b, 1, GL_FALSE,
+		&(id[0][0]));
+	glUniformMatrix4fv(model_to_projection_UL_b, 1, GL_FALSE,
+		&modelToProjectionMatrix[0][0]);
+	glUniform3fv(c_0_UL, 1, &(eye_position.x));
+	glUniform3fv(up_UL, 1, &(cam_up.x));
+	glUniform3fv(origin_UL, 1, &(geometry.get_origin().x));
+	glUniform1i(instanced_UL, instancing ? 1 : 0);
+
+	/* Draw a quad per instance, uploading the instances first if they
+	   changed. */
+	if (instancing)
+	{
+		glBindVertexArray(instance_array);
+		glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+		if (upload && splats.count > 0)
+			glBufferData(GL_ARRAY_BUFFER, splats.count * sizeof(TensorSplat_Instance),
+				&splat_instances[0], GL_STATIC_DRAW);
+		if (splats.count > 0)
+			glDrawArraysInstanced(GL_QUADS, 0, SPLAT_NUM_VERTICES, (GLsizei)splats.count);
+	}
+
+	/* Or upload the frame's splats in one go if they were expanded again,
+	   orphaning the last frame's storage rather than waiting for it, and
+	   draw them. */
+	else
+	{
+		glBindVertexArray(splat_array);
+		glBindBuffer(GL_ARRAY_BUFFER, splat_buffer);
+		if (num_vertices > 0)
+		{
+			if (upload)
+				glBufferData(GL_ARRAY_BUFFER, num_vertices * sizeof(TensorSplat_Vertex),
+					geometry.get_vertices(), GL_STREAM_DRAW);
+			glDrawArrays(GL_QUADS, 0, (GLsizei)num_vertices);
+		}
+	}
+	glBindVertexArray(0);
+
+	/* Read the frame back while it is still in the back buffer. */
+	if (pixels != NULL)
+	{
+		GLint width = getWindowDimension(Dimension::WIDTH);
+		GLint height = getWindowDimension(Dimension::HEIGHT);
+		pixels->resize((size_t)width * height * 4);
+		glReadBuffer(GL_BACK);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+	}
+
+	/* Swap the double buffer. */
+	SDL_GL_SwapWindow(window);
+
+}
+
+/******************************************************************************
+*                                                                             *
+*                       Display::repaintLoadingScreen                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Clears the window and draws the loading screen image, scaled to fit the    *
+*  window without stretching. Used until the first splats have been loaded.   *
+*  Nothing is drawn if the window already shows it.                           *
+*                                                                             *
+*******************************************************************************/
+void Display::repaintLoadingScreen()
+{
+	if (!needsRepaint(DRAWN_LOADING_SCREEN))
+		return;
+
+	/* Tell OpenGL to clear the color buffer and depth buffer. */
+	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+	/* Get the window dimensions and update the viewport. */
+	updateViewport();
+
+	if (loading_texture != 0)
+	{
+		/* Shrink whichever axis the image is narrower on. */
+		GLfloat image_aspect = (GLfloat)loading_width / loading_height;
+		GLfloat x_extent = 1.0f, y_extent = 1.0f;
+		if (image_aspect > aspectRatio)
+			y_extent = aspectRatio / image_aspect;
+		else
+			x_extent = image_aspect / aspectRatio;
+
+		/* Draw a textured quad with the fixed pipeline, in device coordinates. */
+		glUseProgram(0);
+		glBindVertexArray(0);
+		glBindTexture(GL_TEXTURE_2D, loading_texture);
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 1.0f); glVertex2f(-x_extent, -y_extent);
+		glTexCoord2f(1.0f, 1.0f); glVertex2f( x_extent, -y_extent);
+		glTexCoord2f(1.0f, 0.0f); glVertex2f( x_extent,  y_extent);
+		glTexCoord2f(0.0f, 0.0f); glVertex2f(-x_extent,  y_extent);
+		glEnd();
+
+		/* Put back the texture the splats are drawn with. */
+		glBindTexture(GL_TEXTURE_2D, TensorSplat::textureID);
+	}
+
+	/* Swap the double buffer. */
+	SDL_GL_SwapWindow(window);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            Display::needsRepaint                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param screen                                                              *
+*           DRAWN_LOADING_SCREEN or DRAWN_SPLATS, about to be drawn.          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  false if the window already shows that screen, drawn for the same window   *
+*  size and camera revision, and nothing has invalidated it since.            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Records the screen, window size and camera revision as those drawn, so the *
+*  caller must draw whenever this returns true.                               *
+*                                                                             *
+*******************************************************************************/
+bool Display::needsRepaint(GLuint screen)
+{
+	GLint width, height;
+	SDL_GetWindowSize(window, &width, &height);
+	Uint32 camera_revision = camera.getRevision();
+
+	bool current = !invalid && (drawn_screen == screen) && (drawn_width == width) &&
+		(drawn_height == height) && (drawn_camera == camera_revision);
+	invalid = false;
+	drawn_screen = screen;
+	drawn_width = width;
+	drawn_height = height;
+	drawn_camera = camera_revision;
+	return !current;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Display::setInstancing                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param enabled                                                             *
+*        Whether the vertex shader is to expand the splats.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Switches between the two ways of drawing splats. Without GL 3.3 the CPU    *
+*  keeps expanding them. Neither path's buffer holds what the other last      *
+*  drew, so the next frame is drawn and uploaded afresh.                      *
+*                                                                             *
+*******************************************************************************/
+void Display::setInstancing(bool enabled)
+{
+	instancing = enabled && instancing_supported;
+	drawn_store = 0;
+	drawn_slots.clear();
+	invalidate();
+}
+
+/******************************************************************************
+*                                                                             *
+*                          Display::setLoadingScreen                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param filename                                                            *
+*        Image to show while the tensor field loads.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Loads the image into a texture. If it cannot be loaded the loading screen  *
+*  is just the clear color.                                                   *
+*                                                                             *
+*******************************************************************************/
+void Display::setLoadingScreen(const char* filename)
+{
+	SDL_Surface* image = IMG_Load(filename);
+	if (image == NULL)
+	{
+		std::cerr << "Could not load " << filename << ": " << IMG_GetError() << std::endl;
+		return;
+	}
+
+	/* Convert to bytes in R, G, B, A order whatever the file held. */
+	SDL_Surface* rgba = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ABGR8888, 0);
+	SDL_FreeSurface(image);
+	if (rgba == NULL)
+		return;
+
+	glEnable(GL_TEXTURE_2D);
+	glGenTextures(1, &loading_texture);
+	glBindTexture(GL_TEXTURE_2D, loading_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, rgba->w, rgba->h, 0, GL_RGBA,
+		GL_UNSIGNED_BYTE, rgba->pixels);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, TensorSplat::textureID);
+
+	loading_width = rgba->w;
+	loading_height = rgba->h;
+	SDL_FreeSurface(rgba);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Display::setShader                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param shader                                                              *
+*        The shader object to be used for rendering the geometry.             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Tells OpenGL to use the indicated shader for rendering, and gets the       *
+*  location IDs of the uniform variables inside the shader program.           *
+*                                                                             *
+*******************************************************************************/
+void Display::setShader(Shader* shader)
+{
+	/* Tell OpenGL to use this shader. */
+	shader->use();
+
+	/* Bind the indicated data attributes to the variables. */
+	glBindAttribLocation(shader->getProgram(), A_0_ATTRIB, "A_0");
+	glBindAttribLocation(shader->getProgram(), A_1_ATTRIB, "A_1");
+	glBindAttribLocation(shader->getProgram(), A_2_ATTRIB, "A_2");
+	glBindAttribLocation(shader->getProgram(), A_3_ATTRIB, "A_3");
+}
+
+void Display::getCenterPos(GLuint* x, GLuint* y, GLuint width, GLuint height)
+{
+	*x = (getScreenDimension(Dimension::WIDTH) - width) / 2;
+	*y = (getScreenDimension(Dimension::HEIGHT) - width) / 2;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              Display::release                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Deletes every GL object the display made or draws with, the splat texture  *
+*  included, with the call for its kind, but keeps the context, so that what  *
+*  is left in it can still be looked for. Nothing may be drawn afterwards.    *
+*                                                                             *
+*******************************************************************************/
+void Display::release()
+{
+	/* Delete shaders, once none is in use; deleting the current program
+	   only flags it for deletion. */
+	glUseProgram(0);
+	delete mesh_shader;
+	delete splat_shader;
+	mesh_shader = splat_shader = nullptr;
+
+	/* Delete the splat buffers. */
+	glDeleteVertexArrays(1, &splat_array);
+	glDeleteBuffers(1, &splat_buffer);
+	glDeleteVertexArrays(1, &instance_array);
+	glDeleteBuffers(1, &instance_buffer);
+	splat_array = splat_buffer = instance_array = instance_buffer = 0;
+
+	/* Delete the loading screen and the splat texture. */
+	glDeleteTextures(1, &loading_texture);
+	loading_texture = 0;
+	TensorSplat::delete_texture();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Display::~Display (Destructor)                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Destructor for the Display class. Deletes every GL object the display made *
+*  or draws with, and then the context and the window. Must run before        *
+*  SDL_Quit.                                                                  *
+*                                                                             *
+*******************************************************************************/
+Display::~Display()
+{
+	/* Delete the GL objects while their context is still current. */
+	release();
+
+	/* Delete the GL context. */
+	SDL_GL_DeleteContext(context);
+
+	/* Destroy the window. */
+	SDL_DestroyWindow(window);
+}
@@ -1,177 +1,264 @@
-#pragma once
-
-/******************************************************************************
- *                                                                            *
- *                              Included Header Files                         *
- *                                                                            *
- ******************************************************************************/
-#include <SDL\SDL.h>
-#include <GL\GL.h>
-#include <glm\glm.hpp>
-#include <string>
-#include <vector>
-#include "Camera.h"
-#include "TensorSplat.h"
-#include "Shader.h"
-
-/******************************************************************************
- *                                                                            *
- *                        Defined Constants and Macros                        *
- *                                                                            *
- ******************************************************************************/
-
-/* Field of View parameter. */
-#define  DEFAULT_FOV              (60.0f * M_PI / 180.0)
-/* Near clipping plane parameter. */
-#define  DEFAULT_NEAR_PLANE       1.0f
-/* Far clipping plane parameter. */
-#define  DEFAULT_FAR_PLANE        1000.0f
-#define  DEFAULT_CLEAR_COLOR      0.1f, 0.1f, 0.1f, 1.0f
-/* Default vertex and fragment shader source files. */
-#define  SPLAT_VERTEX_SHADER      "res/shaders/splat.vs"
-#define  SPLAT_FRAGMENT_SHADER    "res/shaders/splat.fs"
-
-/******************************************************************************
- *																			  *
- *	                           Dimension Enum                                 *
- *																			  *
- ******************************************************************************
- *  WIDTH                                                                     *
- *       Represents the width of an object.                                   *
- *  HEIGHT                                                                    *
- *       Represents the height of an object.                                  *
- *  DEPTH                                                                     *
- *       Represents the depht of an object.                                   *
- *                                                                            *
- ******************************************************************************
- * DESCRIPTION                                                                *
- *  Enumeration specifying valid dimensions for function calls.               *
- *                                                                            *
- ******************************************************************************/
-enum class Dimension
-{
-	WIDTH,
-	HEIGHT,
-	DEPTH,
-};
-
-/******************************************************************************
- *																			  *
- *	                             Display Class                                *
- *																			  *
- ******************************************************************************
- *  aspectRatio                                                               *
- *          Ratio describing the width/height for the viewport.               *
- *  window                                                                    *
- *          Pointer to the SDL_Window instance for this display.              *
- *  context                                                                   *
- *          Pointer to the OpenGL context created for this window.            *
- *          drawn.                                                            *
- *  camera                                                                    *
- *          Camera instance whose perspective this display shows.             *
- *  modelToProjectionMatrix                                                   *
- *          4-D matrix representing the total transformation to the display.  *
- *  viewToProjectionMatrix                                                    *
- *          4-D matrix representing the transformation from the view to the   *
- *          projection (camera view).                                         *
- *  modelToProjectionUniformLocation                                          *
- *          ID  of the location for the modelToProjectionMatrix in the shader *
- *          program.                                                          *
- *  textureUniformLocation                                                    *
- *          ID  of the location for the texture sampler in the shader program *
- *                                                                            *
- ******************************************************************************
- * DESCRIPTION                                                                *
- *  Class representing the window in which the OpenGL context may render.     *
- *                                                                            *
- ******************************************************************************/
-class Display
-{
-/* Public Members. */
-public:
-
-	/* Constructor. */
-	         Display(std::string title, 
-	                 GLushort    width, 
-	                 GLushort    height);
-
-	/* Calculate the width and height of the screen dimensions. */
-	GLushort getScreenDimension(Dimension d);
-	GLushort getWindowDimension(Dimension d);
-
-	/* Update the size of the viewport on window resize. */
-	void     updateViewport();
-
-	/* Maximnize the display on the current screen. */
-	void     maximize();
-
-	/* Repaint the graphics. */
-	void     repaint(std::vector<TensorSplat*>& splats);
-	void     getCenterPos(GLuint* x, GLuint* y, GLuint width, GLuint height);
-
-	/* Getters. */
-	Camera*  getCamera()               {  return &camera;            }
-
-	/* Setters. */     
-	void    setShader(Shader* shader);
-	void    createShaders();
-	void    setClearColor(GLclampf r, 
-                          GLclampf b,
-                          GLclampf g, 
-                          GLclampf a) {  glClearColor(r, b, g, a);  } 
-
-	/* Destructor. */
-	               ~Display();
-
-/* Private Members.*/
-private:
-
-	/* Current aspect ratio of the window. */
-	GLfloat        aspectRatio;
-	/* Pointer to the SDL Window. */
-	SDL_Window*    window;
-	/* Pointer to the GL Context. */
-	SDL_GLContext  context;
-	/* Camera for looking at the world. */
-	Camera         camera;
-	/* Model to Projection (complete) matrix. */
-	glm::mat4      modelToProjectionMatrix;
-	/* View to Projection matrix. */
-	glm::mat4      viewToProjectionMatrix;
-	/* Uniform location for the full transformation. */
-	GLuint         model_to_projection_UL_a;
-	/* Uniform location for the model to world transformation.*/
-	GLuint         model_to_world_UL_a;
-	/* Uniform location for the full transformation. */
-	GLuint         model_to_projection_UL_b;
-	/* Uniform location for the model to world transformation.*/
-	GLuint         model_to_world_UL_b;
-	/* Uniform location for the light source. */
-	GLuint         light_position_UL;
-	/* Uniform location for the ambient light. */
-	GLuint         ambient_color_UL;
-	/* Uniform location for the diffuse light. */
-	GLuint         diffuse_color_UL;
-	/* Uniform location for the specular light. */
-	GLuint         specular_color_UL;
-	/* Uniform location for the phong shininess parameter. */
-	GLuint         shininess_UL;
-	GLuint         eye_pos_UL;
-	GLuint         color_UL;
-	GLuint         texture_UL;
-
-	glm::vec4 ambient_color;
-	glm::vec4 diffuse_color;
-	glm::vec4 specular_color;
-	glm::vec4 light_position;
-	GLfloat   shininess;
-	GLfloat   t;
-
-	GLuint         a_2_UL;
-	GLuint         c_0_UL;
-	GLuint         u_UL;
-
-	Shader*        mesh_shader;
-	Shader*        splat_shader;
-	bool           once;
-};
+#pragma once
+
+/******************************************************************************
+ *                                                                            *
+ *                              Included Header Files                         *
+ *                                                                            *
+ ******************************************************************************/
+#include <SDL\SDL.h>
+#include <GL\GL.h>
+#include <glm\glm.hpp>
+#include <string>
+#include <vector>
+#include "Camera.h"
+#include "TensorSplat.h"
+#include "Shader.h"
+#include "ThreadPool.h"
+#include "SplatGeometry.h"
+
+/******************************************************************************
+ *                                                                            *
+ *                        Defined Constants and Macros                        *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Field of View parameter. */
+#define  DEFAULT_FOV              (60.0f * M_PI / 180.0)
+/* Near clipping plane parameter. */
+#define  DEFAULT_NEAR_PLANE       1.0f
+/* Far clipping plane parameter. */
+#define  DEFAULT_FAR_PLANE        1000.0f
+#define  DEFAULT_CLEAR_COLOR      0.1f, 0.1f, 0.1f, 1.0f
+/* Default vertex and fragment shader source files. */
+#define  SPLAT_VERTEX_SHADER      "res/shaders/splat.vs"
+#define  SPLAT_FRAGMENT_SHADER    "res/shaders/splat.fs"
+/* Image shown while the tensor field loads. */
+#define  LOADING_SCREEN_FILE      "res/img/loadingScreen.jpg"
+/* Texture every splat is drawn with. */
+#define  SPLAT_TEXTURE_FILE       "res/textures/gaussian_mask.png"
+/* Have the vertex shader expand splats where GL 3.3 instancing is there.
+   Off unless asked for: its quads match the CPU's only up to rounding, so
+   its frames are not identical to the CPU path's; GLCheck::instancing
+   measures how far apart they are. */
+#define  SPLAT_INSTANCING_ENABLED false
+/* Instance attributes: center, tensor, its inverses and color. */
+#define  SPLAT_NUM_INSTANCE_ATTRIBS 5
+/* What the window last had drawn in it. */
+#define  DRAWN_NOTHING            0
+#define  DRAWN_LOADING_SCREEN     1
+#define  DRAWN_SPLATS             2
+
+/******************************************************************************
+ *																			  *
+ *	                           Dimension Enum                                 *
+ *																			  *
+ ******************************************************************************
+ *  WIDTH                                                                     *
+ *       Represents the width of an object.                                   *
+ *  HEIGHT                                                                    *
+ *       Represents the height of an object.                                  *
+ *  DEPTH                                                                     *
+ *       Represents the depht of an object.                                   *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Enumeration specifying valid dimensions for function calls.               *
+ *                                                                            *
+ ******************************************************************************/
+enum class Dimension
+{
+	WIDTH,
+	HEIGHT,
+	DEPTH,
+};
+
+/******************************************************************************
+ *																			  *
+ *	                             Display Class                                *
+ *																			  *
+ ******************************************************************************
+ *  aspectRatio                                                               *
+ *          Ratio describing the width/height for the viewport.               *
+ *  window                                                                    *
+ *          Pointer to the SDL_Window instance for this display.              *
+ *  context                                                                   *
+ *          Pointer to the OpenGL context created for this window.            *
+ *          drawn.                                                            *
+ *  camera                                                                    *
+ *          Camera instance whose perspective this display shows.             *
+ *  modelToProjectionMatrix                                                   *
+ *          4-D matrix representing the total transformation to the display.  *
+ *  viewToProjectionMatrix                                                    *
+ *          4-D matrix representing the transformation from the view to the   *
+ *          projection (camera view).                                         *
+ *  modelToProjectionUniformLocation                                          *
+ *          ID  of the location for the modelToProjectionMatrix in the shader *
+ *          program.                                                          *
+ *  textureUniformLocation                                                    *
+ *          ID  of the location for the texture sampler in the shader program *
+ *  loading_texture                                                           *
+ *          Texture of the image shown until the first splats arrive.         *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Class representing the window in which the OpenGL context may render.     *
+ *                                                                            *
+ ******************************************************************************/
+class Display
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	         Display(std::string title, 
+	                 GLushort    width, 
+	                 GLushort    height,
+	                 bool        hidden = false);
+
+	/* Calculate the width and height of the screen dimensions. */
+	GLushort getScreenDimension(Dimension d);
+	GLushort getWindowDimension(Dimension d);
+
+	/* Update the size of the viewport on window resize. */
+	void     updateViewport();
+
+	/* Maximnize the display on the current screen. */
+	void     maximize();
+
+	/* Repaint the graphics. */
+	void     repaint(const SplatStore& store, const Slice& splats,
+	                 std::vector<GLubyte>* pixels = NULL);
+	void     repaintLoadingScreen();
+	void     getCenterPos(GLuint* x, GLuint* y, GLuint width, GLuint height);
+
+	/* Getters. */
+	Camera*  getCamera()               {  return &camera;            }
+
+	/* Have the next repaint draw even if nothing it draws has changed, as
+	   when the window has been uncovered or resized. */
+	void     invalidate()              {  invalid = true;            }
+
+	/* Keep each splat's quad until the eye has turned more than this many
+	   radians about it; 0 expands every quad whenever the camera moves. */
+	void     setViewTolerance(GLfloat radians)  {  geometry.set_tolerance(radians);  }
+
+	/* Have the vertex shader expand splats, where it can, or the CPU. */
+	void     setInstancing(bool enabled);
+	bool     isInstancing() const      {  return instancing;         }
+
+	/* Setters. */     
+	void    setShader(Shader* shader);
+	void    setLoadingScreen(const char* filename);
+	void    createShaders();
+	void    createSplatBuffers();
+	void    setClearColor(GLclampf r, 
+                          GLclampf b,
+                          GLclampf g, 
+                          GLclampf a) {  glClearColor(r, b, g, a);  } 
+
+	/* Delete every GL object, leaving only the context. */
+	void           release();
+
+	/* Destructor. */
+	               ~Display();
+
+/* Private Members.*/
+private:
+
+	/* Current aspect ratio of the window. */
+	GLfloat        aspectRatio;
+	/* Pointer to the SDL Window. */
+	SDL_Window*    window;
+	/* Pointer to the GL Context. */
+	SDL_GLContext  context;
+	/* Camera for looking at the world. */
+	Camera         camera;
+	/* Model to Projection (complete) matrix. */
+	glm::mat4      modelToProjectionMatrix;
+	/* View to Projection matrix. */
+	glm::mat4      viewToProjectionMatrix;
+	/* Uniform location for the full transformation. */
+	GLuint         model_to_projection_UL_a;
+	/* Uniform location for the model to world transformation.*/
+	GLuint         model_to_world_UL_a;
+	/* Uniform location for the full transformation. */
+	GLuint         model_to_projection_UL_b;
+	/* Uniform location for the model to world transformation.*/
+	GLuint         model_to_world_UL_b;
+	/* Uniform location for the light source. */
+	GLuint         light_position_UL;
+	/* Uniform location for the ambient light. */
+	GLuint         ambient_color_UL;
+	/* Uniform location for the diffuse light. */
+	GLuint         diffuse_color_UL;
+	/* Uniform location for the specular light. */
+	GLuint         specular_color_UL;
+	/* Uniform location for the phong shininess parameter. */
+	GLuint         shininess_UL;
+	GLuint         eye_pos_UL;
+	GLuint         texture_UL;
+
+	glm::vec4 ambient_color;
+	glm::vec4 diffuse_color;
+	glm::vec4 specular_color;
+	glm::vec4 light_position;
+	GLfloat   shininess;
+	GLfloat   t;
+
+	GLuint         a_2_UL;
+	GLuint         c_0_UL;
+	GLuint         u_UL;
+
+	Shader*        mesh_shader;
+	Shader*        splat_shader;
+
+	/* Locations of the splat vertex attributes in the splat shader. */
+	GLint          splat_attribs[SPLAT_NUM_ATTRIBS];
+	/* Vertex buffer each frame's splats are streamed through. */
+	GLuint         splat_buffer;
+	/* Vertex array describing the layout of the splat buffer. */
+	GLuint         splat_array;
+	/* Threads the splats are expanded on; the display's own, so that a load
+	   running on the shared pool never holds up a frame. */
+	ThreadPool     geometry_pool;
+	/* Vertices of every splat of the frame, kept from frame to frame. */
+	SplatGeometry  geometry;
+	/* Uniform location of the point their A_0 is relative to. */
+	GLuint         origin_UL;
+
+	/* Whether splats can be, and are, expanded by the vertex shader instead. */
+	bool           instancing_supported;
+	bool           instancing;
+	/* Uniform locations telling the splat shader which, and the camera's up. */
+	GLuint         instanced_UL;
+	GLuint         up_UL;
+	/* Locations of the instance attributes in the splat shader. */
+	GLint          instance_attribs[SPLAT_NUM_INSTANCE_ATTRIBS];
+	/* Buffer holding one instance per splat drawn, and its layout. */
+	GLuint         instance_buffer;
+	GLuint         instance_array;
+	/* Instances of the splats drawn, uploaded again only when they change. */
+	std::vector<TensorSplat_Instance> splat_instances;
+
+	/* Store, its revision and the slots of the splats last drawn; while
+	   none changes, neither do their instances. */
+	uint64_t       drawn_store;
+	uint64_t       drawn_revision;
+	std::vector<GLuint> drawn_slots;
+	/* What the window shows, and the window size and camera revision it was
+	   drawn for; a frame that would draw the same again is skipped. */
+	bool           invalid;
+	GLuint         drawn_screen;
+	GLint          drawn_width;
+	GLint          drawn_height;
+	Uint32         drawn_camera;
+	bool           once;
+
+	/* Loading screen texture and its size in pixels. */
+	GLuint         loading_texture;
+	GLint          loading_width;
+	GLint          loading_height;
+
+	/* Whether the window no longer shows the given screen as last drawn. */
+	bool           needsRepaint(GLuint screen);
+};
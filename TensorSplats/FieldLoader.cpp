@@ -0,0 +1,204 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "FieldLoader.h"
+#include <SDL\SDL.h>
+
+/******************************************************************************
+*                                                                             *
+*                          FieldLoader::FieldLoader                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the FieldLoader object. Nothing is loaded until     *
+*  start() is called.                                                         *
+*                                                                             *
+*******************************************************************************/
+FieldLoader::FieldLoader() :
+finished(false), cancelled(false), result(NULL), field(NULL), complete(false),
+publishing(false), done(false)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                          FieldLoader::~FieldLoader                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Stops the loader. The field itself belongs to the caller.                  *
+*                                                                             *
+*******************************************************************************/
+FieldLoader::~FieldLoader()
+{
+	stop();
+}
+
+/******************************************************************************
+*                                                                             *
+*                              FieldLoader::stop                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Stops forwarding slabs, waits for the loader to return and drops whatever  *
+*  it left in the queue. The loader stops reading at its next slab, so this   *
+*  waits for one slab rather than the rest of the file; a field already being *
+*  published is waited for. Must be called before the caller frees a field    *
+*  that may still be loading, since the worker refers to it until it returns. *
+*                                                                             *
+*******************************************************************************/
+void FieldLoader::stop()
+{
+	cancelled = true;
+	if (worker.joinable())
+		worker.join();
+
+	Slab* slab;
+	while (slabs.pop(slab))
+		delete slab;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             FieldLoader::start                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  load                                                                       *
+*           Loader to run, which must route its output through the sink it    *
+*           is passed (TensorField::read_eig_file and read_nifti_file do).    *
+*                                                                             *
+*******************************************************************************/
+void FieldLoader::start(const std::function<TensorField*(const SampleSink&)>& load)
+{
+	worker = std::thread([this, load]()
+	{
+		// Runs on the worker: invert each slab and queue it for the GL thread,
+		// until the loader is told at its next slab that the rest is not wanted.
+		result = load([this](TensorField* tf, SampleList& samples) -> bool
+		{
+			if (cancelled)
+				return false;
+			Slab* slab = new Slab();
+			slab->field = tf;
+			slab->samples.swap(samples);
+			if (!slab->samples.empty() && !tf->store.is_compact())
+			{
+				slab->inverses.resize(slab->samples.size());
+				SplatStore::invert(&slab->samples[0], slab->samples.size(),
+					&slab->inverses[0]);
+			}
+			slabs.push(slab);
+			return true;
+		});
+		if (result != NULL)
+			result->sink = SampleSink();
+		finished.store(true, std::memory_order_release);
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                              FieldLoader::poll                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  budget_ms                                                                  *
+*           Time after which no further slab is started this call.            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The number of splats created.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Called once a frame on the GL thread. Creates the splats of queued slabs   *
+*  until the queue is empty or the budget is spent, so a large backlog is     *
+*  spread over several frames instead of stalling one. While the field is     *
+*  being published it only checks whether that has finished.                  *
+*                                                                             *
+*******************************************************************************/
+size_t FieldLoader::poll(GLuint budget_ms)
+{
+	if (done)
+		return 0;
+
+	if (publishing)
+	{
+		if (finished.load(std::memory_order_acquire))
+		{
+			worker.join();
+			done = true;
+		}
+		return 0;
+	}
+
+	// Read before draining, so no slab queued before the loader returned is missed.
+	bool loaded = finished.load(std::memory_order_acquire);
+
+	size_t added = 0;
+	bool drained = false;
+	GLuint start_ms = SDL_GetTicks();
+	while (true)
+	{
+		Slab* slab;
+		if (!slabs.pop(slab))
+		{
+			drained = true;
+			break;
+		}
+
+		field = slab->field;
+		if (!slab->samples.empty())
+			field->add_samples(&slab->samples[0], slab->samples.size(),
+				slab->inverses.empty() ? NULL : &slab->inverses[0]);
+		added += slab->samples.size();
+		delete slab;
+
+		if (SDL_GetTicks() - start_ms >= budget_ms)
+			break;
+	}
+
+	if (loaded && drained && !complete)
+	{
+		if (field == NULL)
+			field = result;
+		complete = (result != NULL);
+		done = !complete;
+	}
+	return added;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             FieldLoader::publish                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  keep_store                                                                 *
+*           Whether the field's store is being drawn, so must not be moved.   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sorting and preparing a whole field takes longer than a frame, so the      *
+*  worker that loaded it does both and publishes the result. Until then the   *
+*  GL thread adds nothing to the store, and only draws it if it is kept.      *
+*                                                                             *
+*******************************************************************************/
+void FieldLoader::publish(bool keep_store)
+{
+	if (!complete || publishing)
+		return;
+
+	publishing = true;
+	worker.join();
+	finished.store(false, std::memory_order_relaxed);
+	TensorField* tf = result;
+	worker = std::thread([this, tf, keep_store]()
+	{
+		tf->publish(keep_store);
+		finished.store(true, std::memory_order_release);
+	});
+}
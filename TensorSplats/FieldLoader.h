@@ -0,0 +1,113 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "TensorSplat.h"
+#include "LockFreeQueue.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define LOADER_FRAME_BUDGET_MS  8
+
+/******************************************************************************
+*                                                                             *
+*                                  FieldLoader      (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  worker                                                                     *
+*           Thread running the loader, and then publishing its field.         *
+*  slabs                                                                      *
+*           Slabs the loader has finished and the GL thread has not yet       *
+*           turned into splats.                                               *
+*  finished                                                                   *
+*           Set by the worker once the loader, and later the publishing,      *
+*           has returned.                                                     *
+*  cancelled                                                                  *
+*           Set when the loader's remaining output is no longer wanted.       *
+*  result                                                                     *
+*           What the loader returned; valid once finished is set.             *
+*  field                                                                      *
+*           The field being filled, once the loader has announced it.         *
+*  complete                                                                   *
+*           Whether every slab of a successful load has been added.           *
+*  publishing                                                                 *
+*           Whether the worker has been started publishing the field.         *
+*  done                                                                       *
+*           Whether the load is over: published, or failed.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Runs a tensor field loader on a background thread so the window stays      *
+*  live while the volume is parsed. The loader's slabs come back to the GL    *
+*  thread through a lock-free queue, and poll() creates their splats there a  *
+*  few at a time each frame, so the field can be drawn while it fills. The    *
+*  worker inverts each slab's tensors before queueing it, leaving the GL      *
+*  thread only the copying, and once every slab is in it sorts and prepares   *
+*  the field's first version (see TensorField::publish) as well.              *
+*                                                                             *
+*******************************************************************************/
+class FieldLoader
+{
+
+public:
+
+	// Constructors. Destroying a loader waits for its thread.
+	FieldLoader();
+	~FieldLoader();
+
+	// Run a loader on the worker thread, passing it the sink to load into.
+	void start(const std::function<TensorField*(const SampleSink&)>& load);
+
+	// Discard the rest of the load and wait for the worker to return.
+	void stop();
+
+	// Create the splats of arrived slabs for up to budget_ms (GL thread only).
+	// Returns the number of splats added.
+	size_t poll(GLuint budget_ms = LOADER_FRAME_BUDGET_MS);
+
+	// Once the load is complete, publish the field on the worker, keeping
+	// its store if that is still being drawn (GL thread only). The load is
+	// done when a later poll finds this has returned.
+	void publish(bool keep_store);
+
+	// Getters.
+	TensorField*  get_field() const         {  return field;                  }
+	bool          is_complete() const       {  return complete;               }
+	bool          is_done() const           {  return done;                   }
+	bool          has_failed() const        {  return done && result == NULL; }
+
+private:
+
+	// A finished slab on its way to the GL thread, with its inverses.
+	struct Slab
+	{
+		TensorField*               field;
+		SampleList                 samples;
+		std::vector<SplatInverse>  inverses;
+	};
+
+	std::thread               worker;
+	LockFreeQueue<Slab*>      slabs;
+	std::atomic<bool>         finished;
+	std::atomic<bool>         cancelled;
+	TensorField*              result;
+	TensorField*              field;
+	bool                      complete;
+	bool                      publishing;
+	bool                      done;
+
+	// Loaders are not copyable.
+	FieldLoader(const FieldLoader& other);
+	FieldLoader& operator=(const FieldLoader& other);
+
+};
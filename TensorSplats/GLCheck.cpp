@@ -0,0 +1,266 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "GLCheck.h"
+#include "Display.h"
+#include "TensorSplat.h"
+#include <SDL\SDL.h>
+#include <vector>
+#include <cstdlib>
+
+/******************************************************************************
+*                                                                             *
+*                                load_field                                   *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to the header, or to a tensor volume if eig_file_path is     *
+*           empty.                                                            *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The loaded field, or NULL if it could not be loaded or holds no splats, in *
+*  which case there is nothing to check and that has been reported.           *
+*                                                                             *
+*******************************************************************************/
+static TensorField* load_field(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	TensorField* tf = eig_file_path.empty() ?
+		TensorField::read_nifti_file(nifti_file_path, index) :
+		TensorField::read_eig_file(nifti_file_path, eig_file_path, EIG_LOAD_ASYNC, index);
+	if (tf == NULL || tf->store.empty())
+	{
+		fprintf(stderr, "\nNothing to check in %s\n", nifti_file_path.c_str());
+		if (tf != NULL)
+		{
+			tf->cleanUp();
+			delete tf;
+		}
+		return NULL;
+	}
+	return tf;
+}
+
+// Point the camera at the center of a store's splats from a direction, from
+// far enough away to see all of them.
+static void look_at_field(Camera* camera, const SplatStore& store,
+	const glm::vec3& direction)
+{
+	glm::vec3 lo = store.position(0), hi = store.position(0);
+	for (GLuint s = 1; s < store.size(); s++)
+	{
+		lo = glm::min(lo, store.position(s));
+		hi = glm::max(hi, store.position(s));
+	}
+	glm::vec3 view = glm::normalize(direction);
+	camera->setPosition(((lo + hi) * 0.5f) - (view * (glm::length(hi - lo) + 1.0f)));
+	camera->setViewDirection(view);
+}
+
+/******************************************************************************
+*                                                                             *
+*                               live_objects                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The number of GL objects alive in the current context, each reported.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Asks the context about every name up to GL_CHECK_NAMES of each kind of     *
+*  object the display makes, rather than about the names it remembers having  *
+*  made, so an object it lost track of is found too. A shader deleted while   *
+*  still attached to a program is alive until the program goes.               *
+*                                                                             *
+*******************************************************************************/
+static GLuint live_objects()
+{
+	static const char* kinds[] = { "buffer", "vertex array", "texture", "shader", "program" };
+
+	GLuint live = 0;
+	for (GLuint name = 1; name <= GL_CHECK_NAMES; name++)
+	{
+		const bool alive[] = { glIsBuffer(name) == GL_TRUE, glIsVertexArray(name) == GL_TRUE,
+			glIsTexture(name) == GL_TRUE, glIsShader(name) == GL_TRUE,
+			glIsProgram(name) == GL_TRUE };
+		for (GLuint k = 0; k < ARRAY_SIZE(kinds); k++)
+		{
+			if (!alive[k])
+				continue;
+			fprintf(stderr, "  %s %u is still alive\n", kinds[k], name);
+			live++;
+		}
+	}
+	return live;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            GLCheck::instancing                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to file containing the relevant header information.          *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  0 if every pair of frames matched to within the tolerance, 1 if any did    *
+*  not, or if there was no field or no instancing to check.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Shows whether the vertex shader draws what the CPU draws. Every splat of   *
+*  the volume is drawn from each eye twice, once per path, and the frames are *
+*  read back and compared channel by channel. How many values differ, and by  *
+*  how much at most, is printed for every eye.                                *
+*                                                                             *
+*******************************************************************************/
+int GLCheck::instancing(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	static const glm::vec3 directions[] =
+	{
+		glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, -0.2f), glm::vec3(-1.0f, -1.0f, -1.0f)
+	};
+
+	SDL_Init(SDL_INIT_VIDEO);
+	Display* display = new Display(GL_CHECK_TITLE, GL_CHECK_WIDTH, GL_CHECK_HEIGHT, true);
+	TensorSplat::init_texture(SPLAT_TEXTURE_FILE);
+	TensorField* field = load_field(nifti_file_path, eig_file_path, index);
+
+	bool passed = (field != NULL);
+	display->setInstancing(true);
+	if (passed && !display->isInstancing())
+	{
+		fprintf(stderr, "\nNo GL 3.3 instancing to check\n");
+		passed = false;
+	}
+
+	if (passed)
+	{
+		SliceList slices;
+		field->get_slices(slices, ALL, 0.0f);
+		fprintf(stderr, "\nInstancing check of %s, volume %u (%u splats, %ux%u):\n",
+			nifti_file_path.c_str(), index, (GLuint)slices[0].count,
+			GL_CHECK_WIDTH, GL_CHECK_HEIGHT);
+
+		for (GLuint eye = 0; eye < ARRAY_SIZE(directions); eye++)
+		{
+			look_at_field(display->getCamera(), field->get_store(), directions[eye]);
+
+			// The same frame with each path.
+			std::vector<GLubyte> frames[2];
+			for (GLuint path = 0; path < 2; path++)
+			{
+				display->setInstancing(path == 1);
+				display->repaint(field->get_store(), slices[0], &frames[path]);
+			}
+
+			size_t differing = 0;
+			GLint largest = 0;
+			for (size_t c = 0; c < frames[0].size(); c++)
+			{
+				GLint difference = abs((GLint)frames[0][c] - (GLint)frames[1][c]);
+				differing += (difference != 0) ? 1 : 0;
+				largest = (difference > largest) ? difference : largest;
+			}
+			bool matched = (largest <= INSTANCING_TOLERANCE) &&
+				(differing * 1000000 <= frames[0].size() * INSTANCING_PER_MILLION);
+			passed = passed && matched;
+
+			fprintf(stderr, "  eye %u: %10lu of %lu values differ, by at most %d/255%s\n",
+				eye, (unsigned long)differing, (unsigned long)frames[0].size(), largest,
+				matched ? "" : "  FAILED");
+		}
+	}
+
+	if (field != NULL)
+	{
+		field->cleanUp();
+		delete field;
+	}
+	delete display;
+	SDL_Quit();
+
+	fprintf(stderr, "%s\n", passed ? "Instancing check passed" : "Instancing check failed");
+	return passed ? 0 : 1;
+}
+
+/******************************************************************************
+*                                                                             *
+*                               GLCheck::leaks                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to file containing the relevant header information.          *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  index                                                                      *
+*           Which volume of a series to load.                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  0 if no GL object outlived the display, 1 if any did or if there was no    *
+*  field to draw.                                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Shows whether the viewer gives back everything it takes from GL. The       *
+*  display is made as the viewer makes it, with the splat texture and the     *
+*  loading screen, and draws the loading screen and then the field with each  *
+*  path, so that every object has been created and bound. The field and the   *
+*  display's objects are then deleted as the viewer deletes them on exit, and *
+*  the context, which the display still holds, is searched for survivors.     *
+*                                                                             *
+*******************************************************************************/
+int GLCheck::leaks(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index)
+{
+	SDL_Init(SDL_INIT_VIDEO);
+	Display* display = new Display(GL_CHECK_TITLE, GL_CHECK_WIDTH, GL_CHECK_HEIGHT, true);
+	TensorSplat::init_texture(SPLAT_TEXTURE_FILE);
+	display->setLoadingScreen(LOADING_SCREEN_FILE);
+	display->repaintLoadingScreen();
+
+	TensorField* field = load_field(nifti_file_path, eig_file_path, index);
+	bool drawn = (field != NULL);
+	if (drawn)
+	{
+		SliceList slices;
+		field->get_slices(slices, ALL, 0.0f);
+		look_at_field(display->getCamera(), field->get_store(), glm::vec3(0.0f, 0.0f, -1.0f));
+		for (GLuint path = 0; path < 2; path++)
+		{
+			display->setInstancing(path == 1);
+			display->repaint(field->get_store(), slices[0]);
+		}
+		field->cleanUp();
+		delete field;
+	}
+
+	fprintf(stderr, "\nGL leak check of %s, volume %u:\n", nifti_file_path.c_str(), index);
+	display->release();
+	GLuint live = live_objects();
+	delete display;
+	SDL_Quit();
+
+	bool passed = drawn && (live == 0);
+	fprintf(stderr, "%u GL objects outlived the display\n%s\n", live,
+		passed ? "GL leak check passed" : "GL leak check failed");
+	return passed ? 0 : 1;
+}
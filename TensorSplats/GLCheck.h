@@ -0,0 +1,60 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <GL\glew.h>
+#include <string>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define GL_CHECK_TITLE          "Tensor Splatting GL Check"
+#define GL_CHECK_WIDTH          512
+#define GL_CHECK_HEIGHT         512
+/* How far an instanced frame may stray from the CPU's: each channel value
+   by this many steps of 1/255, and no more than this many values in every
+   million. Either path rounds a splat's alpha its own way, and blending
+   carries the step through the splats behind it; a wrong quad does far
+   worse. */
+#define INSTANCING_TOLERANCE    2
+#define INSTANCING_PER_MILLION  1000
+/* Names of each kind of GL object looked at for leaks. Contexts hand them
+   out from 1 up, so far fewer are ever in use at once. */
+#define GL_CHECK_NAMES          4096
+
+/******************************************************************************
+*                                                                             *
+*                                 GLCheck     (class)                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The command-line checks of what the display draws. Each opens a hidden     *
+*  display, loads one volume of a field into it, given as a header and eigen  *
+*  file or, with no eigen file, as a tensor volume, and returns the process   *
+*  exit code: 0 if the check passed, 1 if it failed or could not run. Under   *
+*  llvmpipe, Mesa's software rasterizer, they need no GPU.                    *
+*                                                                             *
+*******************************************************************************/
+class GLCheck
+{
+
+public:
+
+	// Draw the field from several eyes with the CPU expanding the splats and
+	// with the vertex shader expanding them, and fail if any pair of frames
+	// differs by more than the instancing tolerance.
+	static int instancing(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+	// Load and draw the field with each path and the loading screen, delete
+	// the field and every GL object of the display, and fail if any buffer,
+	// vertex array, texture, shader or program is left in the context.
+	static int leaks(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index = 0);
+
+};
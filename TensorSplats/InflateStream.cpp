@@ -0,0 +1,314 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "InflateStream.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                         InflateStream::InflateStream                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the InflateStream object. Nothing is read until     *
+*  open() is called.                                                          *
+*                                                                             *
+*******************************************************************************/
+InflateStream::InflateStream() :
+file(NULL), skip(0), chunks(STREAM_QUEUE_DEPTH), chunk_bytes(STREAM_CHUNK_BYTES),
+stopping(false), filled(STREAM_QUEUE_DEPTH), empty(STREAM_QUEUE_DEPTH),
+current(NULL), current_pos(0)
+{
+	for (size_t c = 0; c < chunks.size(); c++)
+		chunks[c].length = 0;
+}
+InflateStream::~InflateStream()
+{
+	close();
+}
+
+/******************************************************************************
+*                                                                             *
+*                        InflateStream::is_compressed                         *
+*                                                                             *
+*******************************************************************************/
+bool InflateStream::is_compressed(const std::string& file_path)
+{
+	return file_path.size() > 3 &&
+		file_path.compare(file_path.size() - 3, 3, ".gz") == 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            InflateStream::open                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file_path                                                                  *
+*           Path to the file to stream.                                       *
+*  skip_bytes                                                                 *
+*           Number of (uncompressed) bytes to discard before the first read.  *
+*  chunk_size                                                                 *
+*           Bytes inflated at a time. Several streams read in step may use    *
+*           STREAM_PLANE_BYTES, to keep their buffers small.                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the file was opened and the producer started, false otherwise.     *
+*                                                                             *
+*******************************************************************************/
+bool InflateStream::open(const std::string& file_path, size_t skip_bytes,
+	size_t chunk_size)
+{
+	close();
+
+#ifdef HAVE_ZLIB
+	// gzread passes uncompressed files through unchanged.
+	file = gzopen(file_path.c_str(), "rb");
+	if (file != NULL)
+		gzbuffer((gzFile)file, 1 << 17);
+#else
+	if (is_compressed(file_path))
+	{
+		fprintf(stderr, "\nCannot read %s: built without zlib\n", file_path.c_str());
+		return false;
+	}
+	file = fopen(file_path.c_str(), "rb");
+#endif
+	if (file == NULL)
+	{
+		fprintf(stderr, "\nError opening file %s\n", file_path.c_str());
+		return false;
+	}
+
+	// Every chunk starts out free.
+	chunk_bytes = chunk_size;
+	filled.reset();
+	empty.reset();
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		chunks[c].bytes.resize(chunk_bytes);
+		empty.push(&chunks[c]);
+	}
+
+	skip = skip_bytes;
+	stopping = false;
+	producer = std::thread(&InflateStream::produce, this);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            InflateStream::close                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Stops the producer, closes the file and frees the chunk buffers.           *
+*                                                                             *
+*******************************************************************************/
+void InflateStream::close()
+{
+	stopping = true;
+	filled.close();
+	empty.close();
+	if (producer.joinable())
+		producer.join();
+
+	if (file != NULL)
+	{
+#ifdef HAVE_ZLIB
+		gzclose((gzFile)file);
+#else
+		fclose((FILE*)file);
+#endif
+		file = NULL;
+	}
+
+	for (size_t c = 0; c < chunks.size(); c++)
+		std::vector<unsigned char>().swap(chunks[c].bytes);
+	current = NULL;
+	current_pos = 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            InflateStream::read                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  dst                                                                        *
+*           Buffer receiving the bytes.                                       *
+*  bytes                                                                      *
+*           Number of bytes wanted.                                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Number of bytes copied, which is less than requested only at the end of    *
+*  the file or after a read error.                                            *
+*                                                                             *
+*******************************************************************************/
+size_t InflateStream::read(void* dst, size_t bytes)
+{
+	unsigned char* out = (unsigned char*)dst;
+	size_t done = 0;
+
+	while (done < bytes)
+	{
+		// Wait for the producer if the current chunk is used up.
+		if (current == NULL)
+		{
+			if (!filled.pop(current))
+				break;
+			current_pos = 0;
+		}
+
+		size_t n = current->length - current_pos;
+		if (n > bytes - done)
+			n = bytes - done;
+		memcpy(out + done, &current->bytes[current_pos], n);
+		done += n;
+		current_pos += n;
+
+		// Hand the chunk back to be refilled.
+		if (current_pos == current->length)
+		{
+			empty.push(current);
+			current = NULL;
+		}
+	}
+	return done;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           InflateStream::discard                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  bytes                                                                      *
+*           Number of bytes to pass over.                                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Number of bytes passed over, which is less than requested only at the end  *
+*  of the file or after a read error.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  As read, but the bytes are not copied anywhere. They must still be         *
+*  inflated, so this saves only the copy.                                     *
+*                                                                             *
+*******************************************************************************/
+size_t InflateStream::discard(size_t bytes)
+{
+	size_t done = 0;
+
+	while (done < bytes)
+	{
+		if (current == NULL)
+		{
+			if (!filled.pop(current))
+				break;
+			current_pos = 0;
+		}
+
+		size_t n = current->length - current_pos;
+		if (n > bytes - done)
+			n = bytes - done;
+		done += n;
+		current_pos += n;
+
+		if (current_pos == current->length)
+		{
+			empty.push(current);
+			current = NULL;
+		}
+	}
+	return done;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            InflateStream::fill                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  chunk                                                                      *
+*           Chunk receiving the bytes.                                        *
+*  want                                                                       *
+*           Number of bytes to read (at most chunk_bytes).                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Number of bytes read, which is less than requested only at the end of the  *
+*  file or after a read error.                                                *
+*                                                                             *
+*******************************************************************************/
+size_t InflateStream::fill(Chunk* chunk, size_t want)
+{
+	size_t got = 0;
+	while (got < want)
+	{
+#ifdef HAVE_ZLIB
+		int n = gzread((gzFile)file, &chunk->bytes[got], (unsigned)(want - got));
+		if (n < 0)
+		{
+			int code;
+			fprintf(stderr, "\nDecompression error: %s\n", gzerror((gzFile)file, &code));
+			n = 0;
+		}
+#else
+		size_t n = fread(&chunk->bytes[got], 1, want - got, (FILE*)file);
+#endif
+		if (n == 0)
+			break;
+		got += n;
+	}
+	chunk->length = got;
+	return got;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           InflateStream::produce                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Producer thread body. Discards the skipped prefix, then fills free chunks  *
+*  and queues them for the reader until the file ends or the stream closes.   *
+*  A stream closed while still skipping stops there, so a load cancelled      *
+*  before it reaches its data does not wait for the prefix to inflate.        *
+*                                                                             *
+*******************************************************************************/
+void InflateStream::produce()
+{
+	Chunk* chunk;
+
+	// Throw the prefix away through the first free chunk.
+	if (skip > 0 && empty.pop(chunk))
+	{
+		while (skip > 0 && !stopping)
+		{
+			size_t got = fill(chunk, (skip < chunk_bytes) ? skip : chunk_bytes);
+			if (got == 0)
+				break;
+			skip -= got;
+		}
+		empty.push(chunk);
+	}
+
+	while (empty.pop(chunk))
+	{
+		size_t got = fill(chunk, chunk_bytes);
+		if (got == 0 || !filled.push(chunk) || got < chunk_bytes)
+			break;
+	}
+	filled.close();
+}
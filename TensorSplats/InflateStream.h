@@ -0,0 +1,106 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "BoundedQueue.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define STREAM_CHUNK_BYTES      (4 << 20)
+#define STREAM_QUEUE_DEPTH      4
+#define STREAM_PLANE_BYTES      (1 << 20)
+
+/******************************************************************************
+*                                                                             *
+*                                 InflateStream     (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  file                                                                       *
+*           gzFile (or FILE* when built without zlib) being read.             *
+*  producer                                                                   *
+*           Thread decompressing the file into chunks.                        *
+*  chunks                                                                     *
+*           Fixed pool of STREAM_QUEUE_DEPTH buffers of chunk_bytes each.     *
+*  chunk_bytes                                                                *
+*           Size of a chunk; smaller for streams read side by side.           *
+*  stopping                                                                   *
+*           Set by close() so the producer gives up skipping the prefix.      *
+*  filled                                                                     *
+*           Chunks holding data the consumer has not read yet.                *
+*  empty                                                                      *
+*           Chunks free for the producer to fill.                             *
+*  current                                                                    *
+*           Chunk the consumer is reading from, and its read position.        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Forward-only reader of a (possibly gzip-compressed) file. A producer       *
+*  thread inflates the file into a small pool of chunks which it passes to    *
+*  the reader through a bounded queue, so decompression of the next part of   *
+*  the file overlaps with whatever the reader does with the current part, and *
+*  memory use is fixed regardless of the file size. Uncompressed files are    *
+*  read through the same path. The project defines HAVE_ZLIB and links zlib   *
+*  for decompression; a build without them can only read uncompressed files.  *
+*                                                                             *
+*******************************************************************************/
+class InflateStream
+{
+
+public:
+
+	// Constructors.
+	InflateStream();
+	~InflateStream();
+
+	// Start streaming the file, discarding its first skip_bytes bytes.
+	bool open(const std::string& file_path, size_t skip_bytes = 0,
+		size_t chunk_size = STREAM_CHUNK_BYTES);
+	void close();
+
+	// Copy the next bytes of the file, or throw them away; returns fewer only
+	// at EOF or on error.
+	size_t read(void* dst, size_t bytes);
+	size_t discard(size_t bytes);
+
+	// Whether a path names a gzip-compressed file.
+	static bool is_compressed(const std::string& file_path);
+
+private:
+
+	struct Chunk
+	{
+		std::vector<unsigned char> bytes;
+		size_t                     length;
+	};
+
+	void*                       file;
+	size_t                      skip;
+	std::thread                 producer;
+	std::vector<Chunk>          chunks;
+	size_t                      chunk_bytes;
+	std::atomic<bool>           stopping;
+	BoundedQueue<Chunk*>        filled;
+	BoundedQueue<Chunk*>        empty;
+	Chunk*                      current;
+	size_t                      current_pos;
+
+	// Producer thread body, and its blocking read into a chunk.
+	void   produce();
+	size_t fill(Chunk* chunk, size_t want);
+
+	// Streams are not copyable.
+	InflateStream(const InflateStream& other);
+	InflateStream& operator=(const InflateStream& other);
+
+};
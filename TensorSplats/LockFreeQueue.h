@@ -0,0 +1,90 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <atomic>
+#include <utility>
+
+/******************************************************************************
+*                                                                             *
+*                                 LockFreeQueue     (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  head                                                                       *
+*           Node before the oldest item. Owned by the consumer.               *
+*  tail                                                                       *
+*           Newest node. Owned by the producer.                               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Unbounded first-in first-out queue for exactly one producer thread and one *
+*  consumer thread. Neither side ever takes a lock or waits for the other: a  *
+*  push links a new node after the tail, and a pop advances the head past a   *
+*  node once its link is visible. Items are moved in and out, so handing a    *
+*  large container across costs no copy.                                      *
+*                                                                             *
+*******************************************************************************/
+template <typename T>
+class LockFreeQueue
+{
+
+public:
+
+	// Constructors.
+	LockFreeQueue() :
+	head(new Node()), tail(head)
+	{
+	}
+	~LockFreeQueue()
+	{
+		while (head != NULL)
+		{
+			Node* next = head->next.load(std::memory_order_relaxed);
+			delete head;
+			head = next;
+		}
+	}
+
+	// Add an item, leaving it in a moved-from state. Producer only.
+	void push(T& item)
+	{
+		Node* node = new Node();
+		node->value = std::move(item);
+		tail->next.store(node, std::memory_order_release);
+		tail = node;
+	}
+
+	// Remove the oldest item; false if the queue is empty. Consumer only.
+	bool pop(T& item)
+	{
+		Node* next = head->next.load(std::memory_order_acquire);
+		if (next == NULL)
+			return false;
+		item = std::move(next->value);
+		delete head;
+		head = next;
+		return true;
+	}
+
+private:
+
+	struct Node
+	{
+		std::atomic<Node*>     next;
+		T                      value;
+
+		Node() : next(NULL) {}
+	};
+
+	Node*                      head;
+	Node*                      tail;
+
+	// Queues are not copyable.
+	LockFreeQueue(const LockFreeQueue& other);
+	LockFreeQueue& operator=(const LockFreeQueue& other);
+
+};
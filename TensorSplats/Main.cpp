@@ -1,161 +1,324 @@
-/*******************************************************************************
- *                                                                             *
- *                              Included Header Files                          *
- *                                                                             *
- ******************************************************************************/
-#include <gl\glew.h>
-#include <SDL\SDL.h>
-#include <glm\glm.hpp>
-#include <glm\gtc\matrix_transform.hpp>
-#include <glm\gtx\transform.hpp>
-#include <iostream>
-#include <string>
-#include <ctime>
-#include <vector>
-#include "Display.h"
-#include "Shader.h"
-#include "TensorSplat.h"
-#include "Camera.h"
-#include "EventManager.h"
-
-/*******************************************************************************
- *                                                                             *
- *                        Defined Constants and Macros                         *
- *                                                                             *
- ******************************************************************************/
-#define  FULLSCREEN_ENABLED   true
-#define  DEFAULT_HEIGHT		  800
-#define  DEFAULT_WIDTH        1000
-#define  FORWARD              0
-#define  BACKWARD             1
-#define  MILLIS_PER_SECOND    1000
-#define  FRAMES_PER_SECOND    40
-#define  MAX_ROT              2 * M_PI
-#define  PROJECT_TITLE        "Tensor Splatting Technique"
-#define  SPLAT_FILE           "res/textures/gaussian_mask.png"
-#define  TENSOR_FIELD_FILE    "res/data/mri_data.Lfloat"
-#define  PRINT(a)             std::cout << a << std::endl;
-
-/*******************************************************************************
- *                                                                             *
- *                                     main                                    *
- *                                                                             *
- *******************************************************************************
- * PARAMETERS                                                                  *
- *  argc                                                                       *
- *        The number of command line strings.                                  *
- *  argv                                                                       *
- *        The array of command line stirngs.                                   *
- *                                                                             *
- *******************************************************************************
- * RETURNS                                                                     *
- *  0 on success, any non-zero value on failure.                               *
- *                                                                             *
- *******************************************************************************
- * DESCRIPTION                                                                 *
- *  Beginning point of the program.                                            *
- *                                                                             *
- *******************************************************************************/
-int main(int argc, char* argv[])
-{
-	// Initialize SDL with all subsystems.
-	SDL_Init(SDL_INIT_EVERYTHING);
-
-	// Initialize local parameters.
-	GLfloat speed = 5;
-	GLint slice = 0;
-	bool play = true;
-	GLfloat threshold = DEFAULT_THRESHOLD;
-	GLuint direction = FORWARD;
-	GLuint mode = ALL_PLANAR;
-	SliceList slice_list;
-
-	// Create the display, shader, camera, and event manager.
-	Display      display(PROJECT_TITLE, DEFAULT_WIDTH, DEFAULT_HEIGHT);
-	Camera*      camera = display.getCamera();
-	EventManager eventManager;
-
-	// Apply the shaders and maximize the display.
-	//display.maximize();
-
-	// Construct the tensor field.
-	TensorSplat::init_texture(SPLAT_FILE);
-	TensorField* field = TensorField::read_eig_file("res/data/nifti_dt.nii", 
-		TENSOR_FIELD_FILE);
-
-	// Set the controls of the event manager.
-	eventManager.setDisplay(&display);
-	eventManager.setCamera(camera);
-	eventManager.setSpeed(&speed);
-	eventManager.setSlice(&slice);
-	eventManager.setThreshold(&threshold);
-	eventManager.setPlay(&play);
-	eventManager.setMode(&mode);
-	eventManager.setField(field);
-	eventManager.setSliceList(&slice_list);
-
-	// Get the slices from the field.
-	field->get_slices(slice_list, mode, threshold);
-
-
-	// Instantiate the event reference.
-	SDL_Event event;
-	SDL_PollEvent(&event);
-
-	// Begin the milliseconds counter.
-	GLuint startMillis = 0, tempMillis = 0, currentMillis = 0,
-		millisPerFrame = (GLuint)((1.0 / FRAMES_PER_SECOND) * MILLIS_PER_SECOND);
-	startMillis = currentMillis = SDL_GetTicks();
-
-	// Main loop.
-	while (event.type != SDL_QUIT)
-	{
-		// Handle the new event.
-		eventManager.handleSDLEvent(&event);
-
-		// Get the new number of milliseconds.
-		currentMillis = SDL_GetTicks();
-		
-		// If a new frame is to be drawn, update the display.
-		if ((currentMillis - startMillis) >= millisPerFrame)
-		{
-
-			if (mode != ALL && mode != ALL_PLANAR && mode != ALL_LINEAR)
-			{
-				if (play && mode != ALL)
-					slice = (direction == FORWARD) ? slice + 1 : slice - 1;
-
-				if (slice < 0)
-				{
-					slice = 0;
-					direction = FORWARD;
-				}
-				else if (slice >= (GLint)slice_list.size())
-				{
-					slice = slice_list.size() - 1;
-					direction = BACKWARD;
-				}
-			}
-			else
-			{
-				slice = 0;
-			}
-			display.repaint(slice_list[slice]);
-
-			startMillis = currentMillis;
-
-		}
-		
-		// Get the next event.
-		SDL_PollEvent(&event);
-	}
-
-	field->cleanUp();
-	TensorSplat::delete_texture();
-
-	// Quit using SDL.
-	SDL_Quit();
-
-	// Exit Success.
-	return 0;
-}
+/*******************************************************************************
+ *                                                                             *
+ *                              Included Header Files                          *
+ *                                                                             *
+ ******************************************************************************/
+#include <gl\glew.h>
+#include <SDL\SDL.h>
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtx\transform.hpp>
+#include <iostream>
+#include <string>
+#include <ctime>
+#include <vector>
+#include "Display.h"
+#include "Shader.h"
+#include "TensorSplat.h"
+#include "Camera.h"
+#include "EventManager.h"
+#include "NiftiVolume.h"
+#include "VolumeSequence.h"
+#include "BrickCache.h"
+#include "Benchmarks.h"
+#include "GLCheck.h"
+
+/*******************************************************************************
+ *                                                                             *
+ *                        Defined Constants and Macros                         *
+ *                                                                             *
+ ******************************************************************************/
+#define  FULLSCREEN_ENABLED   true
+#define  DEFAULT_HEIGHT		  800
+#define  DEFAULT_WIDTH        1000
+#define  FORWARD              0
+#define  BACKWARD             1
+#define  MILLIS_PER_SECOND    1000
+#define  FRAMES_PER_SECOND    40
+#define  MAX_ROT              2 * M_PI
+#define  PROJECT_TITLE        "Tensor Splatting Technique"
+#define  TENSOR_FIELD_FILE    "res/data/mri_data.Lfloat"
+#define  TENSOR_HEADER_FILE   "res/data/nifti_dt.nii"
+#define  RESIDENT_VOLUMES     DEFAULT_RESIDENT_VOLUMES
+#define  BENCHMARK_FLAG       "--bench-io"
+#define  LAYOUT_FLAG          "--bench-layout"
+#define  COMPACT_BENCH_FLAG   "--bench-compact"
+#define  SNAPSHOT_BENCH_FLAG  "--bench-snapshot"
+#define  KERNEL_BENCH_FLAG    "--bench-kernel"
+#define  INSTANCE_CHECK_FLAG  "--check-instancing"
+#define  GL_CHECK_FLAG        "--check-gl"
+#define  COMPACT_FLAG         "--compact"
+#define  INSTANCED_FLAG       "--instanced"
+#define  VIEW_TOLERANCE_FLAG  "--view-tolerance"
+#define  PRINT(a)             std::cout << a << std::endl;
+
+/*******************************************************************************
+ *                                                                             *
+ *                                     main                                    *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  argc                                                                       *
+ *        The number of command line strings.                                  *
+ *  argv                                                                       *
+ *        The array of command line stirngs.                                   *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Beginning point of the program.                                            *
+ *                                                                             *
+ *******************************************************************************/
+int main(int argc, char* argv[])
+{
+	// Measure load bandwidth instead of opening the viewer:
+	//   TensorSplats --bench-io [header file] [eigen file]
+	if (argc > 1 && std::string(argv[1]) == BENCHMARK_FLAG)
+	{
+		Benchmarks::eig_load(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+		return 0;
+	}
+	if (argc > 1 && std::string(argv[1]) == LAYOUT_FLAG)
+	{
+		Benchmarks::layout(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+		return 0;
+	}
+	if (argc > 1 && std::string(argv[1]) == COMPACT_BENCH_FLAG)
+	{
+		Benchmarks::compact(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+		return 0;
+	}
+	if (argc > 1 && std::string(argv[1]) == SNAPSHOT_BENCH_FLAG)
+	{
+		Benchmarks::snapshot(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+		return 0;
+	}
+	if (argc > 1 && std::string(argv[1]) == KERNEL_BENCH_FLAG)
+	{
+		Benchmarks::kernel(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+		return 0;
+	}
+
+	// Compare the instanced frames with the CPU's in a hidden window, exiting
+	// non-zero if they differ by more than the tolerance:
+	//   TensorSplats --check-instancing [header file] [eigen file]
+	if (argc > 1 && std::string(argv[1]) == INSTANCE_CHECK_FLAG)
+		return GLCheck::instancing(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+
+	// Make and draw a field in a hidden window, tear everything down and exit
+	// non-zero if any GL object is left in the context:
+	//   TensorSplats --check-gl [header file] [eigen file]
+	if (argc > 1 && std::string(argv[1]) == GL_CHECK_FLAG)
+		return GLCheck::leaks(argc > 2 ? argv[2] : TENSOR_HEADER_FILE,
+			argc > 3 ? argv[3] : TENSOR_FIELD_FILE);
+
+	// Keep splats in compact form, for fields too large to hold in full:
+	//   TensorSplats --compact [tensor volume or dtifit basename]
+	if (argc > 1 && std::string(argv[1]) == COMPACT_FLAG)
+	{
+		TensorField::compact_splats = true;
+		argv[1] = argv[0];
+		argc--;
+		argv++;
+	}
+
+	// Have the vertex shader expand the splats, where GL 3.3 allows it:
+	//   TensorSplats --instanced [tensor volume or dtifit basename]
+	bool instanced = SPLAT_INSTANCING_ENABLED;
+	if (argc > 1 && std::string(argv[1]) == INSTANCED_FLAG)
+	{
+		instanced = true;
+		argv[1] = argv[0];
+		argc--;
+		argv++;
+	}
+
+	// Keep splat quads until the eye turns more than this many degrees about
+	// them, for smoother navigation of large fields:
+	//   TensorSplats --view-tolerance degrees [tensor volume or dtifit basename]
+	GLfloat view_tolerance = SPLAT_VIEW_TOLERANCE;
+	if (argc > 2 && std::string(argv[1]) == VIEW_TOLERANCE_FLAG)
+	{
+		view_tolerance = (GLfloat)(atof(argv[2]) * M_PI / 180.0);
+		argv[2] = argv[0];
+		argc -= 2;
+		argv += 2;
+	}
+
+	// Initialize SDL with all subsystems.
+	SDL_Init(SDL_INIT_EVERYTHING);
+
+	// Initialize local parameters.
+	GLfloat speed = 5;
+	GLint slice = 0;
+	GLint volume = 0;
+	bool play = true;
+	GLfloat threshold = DEFAULT_THRESHOLD;
+	GLuint direction = FORWARD;
+	GLuint mode = ALL_PLANAR;
+	SliceList slice_list;
+
+	// Create the display, shader, camera, and event manager.
+	Display*     display = new Display(PROJECT_TITLE, DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	Camera*      camera = display->getCamera();
+	EventManager eventManager;
+	display->setViewTolerance(view_tolerance);
+	display->setInstancing(instanced);
+
+	// Apply the shaders and maximize the display.
+	//display->maximize();
+
+	// A tensor volume, or the output basename of an FSL dtifit run, given on
+	// the command line replaces the eigen file.
+	std::vector<std::string> dtifit_files;
+	bool dtifit = (argc > 1) && TensorField::find_dtifit_files(argv[1], dtifit_files);
+	std::string header_file = dtifit ? dtifit_files[0] :
+		std::string((argc > 1) ? argv[1] : TENSOR_HEADER_FILE);
+	NiftiVolume header;
+	GLuint num_volumes = header.read_header(header_file) ? header.num_volumes() : 1;
+
+	// Volumes too large to hold in memory are paged in from bricks instead.
+	bool bricked = header.volume_values() > BRICKED_FIELD_VOXELS;
+
+	// Construct the tensor field in the background; its splats are created
+	// here, on the GL thread, as its slabs arrive. The volumes of a series
+	// are loaded the same way, ahead of the one being viewed.
+	TensorSplat::init_texture(SPLAT_TEXTURE_FILE);
+	display->setLoadingScreen(LOADING_SCREEN_FILE);
+	TensorField* field = NULL;
+	VolumeSequence* sequence = new VolumeSequence([argc, argv, bricked, dtifit](GLuint index,
+		const SampleSink& sink)
+	{
+		if (bricked)
+			return TensorField::read_bricked(argc > 1 ? argv[1] : TENSOR_HEADER_FILE,
+				argc > 1 ? "" : TENSOR_FIELD_FILE, index, BRICK_CACHE_BYTES);
+		if (dtifit)
+			return TensorField::read_dtifit_files(argv[1], sink);
+		return (argc > 1) ?
+			TensorField::read_nifti_file(argv[1], index, sink) :
+			TensorField::read_eig_file(TENSOR_HEADER_FILE, TENSOR_FIELD_FILE,
+				EIG_LOAD_ASYNC, index, sink);
+	}, num_volumes, RESIDENT_VOLUMES);
+
+	// Set the controls of the event manager.
+	eventManager.setDisplay(display);
+	eventManager.setCamera(camera);
+	eventManager.setSpeed(&speed);
+	eventManager.setSlice(&slice);
+	eventManager.setThreshold(&threshold);
+	eventManager.setPlay(&play);
+	eventManager.setMode(&mode);
+	eventManager.setSliceList(&slice_list);
+	eventManager.setVolume(&volume);
+
+
+	// Instantiate the event reference, and take the first event if there is
+	// one.
+	SDL_Event event;
+	event.type = SDL_FIRSTEVENT;
+	bool have_event = SDL_PollEvent(&event) != 0;
+
+	// Begin the milliseconds counter.
+	GLuint startMillis = 0, tempMillis = 0, currentMillis = 0,
+		millisPerFrame = (GLuint)((1.0 / FRAMES_PER_SECOND) * MILLIS_PER_SECOND);
+	startMillis = currentMillis = SDL_GetTicks();
+
+	// Main loop.
+	while (event.type != SDL_QUIT)
+	{
+		// Handle the new event, if one arrived.
+		if (have_event)
+			eventManager.handleSDLEvent(&event);
+
+		// Get the new number of milliseconds.
+		currentMillis = SDL_GetTicks();
+		
+		// If a new frame is to be drawn, update the display.
+		if ((currentMillis - startMillis) >= millisPerFrame)
+		{
+			// Step through the series, wrapping at either end.
+			if (volume < 0)
+				volume = num_volumes - 1;
+			else if (volume >= (GLint)num_volumes)
+				volume = 0;
+			sequence->request(volume);
+			sequence->set_view(mode);
+
+			// Add whatever the loader has finished since the last frame, and
+			// switch volumes once the requested one is ready.
+			if (sequence->update())
+			{
+				field = sequence->get_field();
+				eventManager.setField(field);
+				if (field != NULL)
+					field->get_slices(slice_list, mode, threshold);
+				else
+					slice_list.clear();
+			}
+			if (field == NULL && sequence->has_failed(volume))
+				break;
+
+			if (mode != ALL && mode != ALL_PLANAR && mode != ALL_LINEAR)
+			{
+				if (play && mode != ALL)
+					slice = (direction == FORWARD) ? slice + 1 : slice - 1;
+
+				if (slice < 0)
+				{
+					slice = 0;
+					direction = FORWARD;
+				}
+				else if (slice >= (GLint)slice_list.size())
+				{
+					slice = slice_list.size() - 1;
+					direction = BACKWARD;
+				}
+			}
+			else
+			{
+				slice = 0;
+			}
+
+			// A bricked field reads the bricks of the slice about to be drawn.
+			if (field != NULL && slice >= 0)
+				field->get_slice(slice_list, mode, threshold, slice);
+
+			if (slice_list.empty())
+				display->repaintLoadingScreen();
+			else
+				display->repaint(field->get_store(), slice_list[slice]);
+
+			startMillis = currentMillis;
+
+		}
+		
+		// Sleep until the next event, or until the next frame is due. The
+		// display skips any frame that would draw what it already shows, so
+		// an idle viewer only wakes to find nothing has changed.
+		GLuint elapsed = SDL_GetTicks() - startMillis;
+		have_event = SDL_WaitEventTimeout(&event,
+			(elapsed < millisPerFrame) ? (int)(millisPerFrame - elapsed) : 0) != 0;
+	}
+
+	bool failed = (field == NULL && sequence->has_failed(volume));
+	delete sequence;
+
+	// The display deletes its GL objects and the splat texture before its
+	// context goes; --check-gl checks that none are left.
+	delete display;
+
+	// Quit using SDL.
+	SDL_Quit();
+
+	// Exit Success.
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "MappedFile.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Size of the pages a view is made of.
+static size_t page_size()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (size_t)info.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+#ifdef _WIN32
+// PrefetchVirtualMemory, which Windows 8 added, looked up at run time so the
+// program still starts on Windows 7, where mapped views go without prefetch.
+struct MemoryRange
+{
+	PVOID          address;
+	SIZE_T         bytes;
+};
+typedef BOOL (WINAPI *PrefetchVirtualMemoryFn)(HANDLE, ULONG_PTR, MemoryRange*, ULONG);
+
+static PrefetchVirtualMemoryFn prefetch_function()
+{
+	static PrefetchVirtualMemoryFn function = (PrefetchVirtualMemoryFn)GetProcAddress(
+		GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+	return function;
+}
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                          MappedFile::MappedFile                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the MappedFile object. No file is mapped until      *
+*  open() is called.                                                          *
+*                                                                             *
+*******************************************************************************/
+MappedFile::MappedFile() :
+address(NULL), length(0), file(NULL), mapping(NULL)
+{
+}
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/******************************************************************************
+*                                                                             *
+*                              MappedFile::open                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file_path                                                                  *
+*           Path to the file to map into memory.                              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the whole file was mapped, false otherwise.                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Opens the file and creates a read-only view of its entire contents.        *
+*                                                                             *
+*******************************************************************************/
+bool MappedFile::open(const std::string& file_path)
+{
+	close();
+
+#ifdef _WIN32
+	// Open the file, telling the cache manager it will be scanned in order.
+	HANDLE handle = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		fprintf(stderr, "\nError opening file %s\n", file_path.c_str());
+		return false;
+	}
+	file = handle;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0)
+	{
+		fprintf(stderr, "\nError sizing file %s\n", file_path.c_str());
+		close();
+		return false;
+	}
+	length = (size_t)file_size.QuadPart;
+
+	// Create the mapping and a view of the whole file.
+	mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		fprintf(stderr, "\nError mapping file %s\n", file_path.c_str());
+		close();
+		return false;
+	}
+	address = MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = ::open(file_path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "\nError opening file %s\n", file_path.c_str());
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		fprintf(stderr, "\nError sizing file %s\n", file_path.c_str());
+		::close(fd);
+		return false;
+	}
+	length = (size_t)file_stat.st_size;
+
+	// The view stays valid after the descriptor is closed.
+	address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED)
+		address = NULL;
+#endif
+
+	if (address == NULL)
+	{
+		fprintf(stderr, "\nError creating view of file %s\n", file_path.c_str());
+		close();
+		return false;
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              MappedFile::close                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Unmaps the view and releases the operating system handles.                 *
+*                                                                             *
+*******************************************************************************/
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (address != NULL)
+		UnmapViewOfFile(address);
+	if (mapping != NULL)
+		CloseHandle((HANDLE)mapping);
+	if (file != NULL)
+		CloseHandle((HANDLE)file);
+#else
+	if (address != NULL)
+		munmap(address, length);
+#endif
+	address = NULL;
+	mapping = NULL;
+	file = NULL;
+	length = 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                        MappedFile::advise_sequential                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Tells the kernel the view will be read front to back, so it can read ahead *
+*  aggressively and drop pages behind the reader, and prefetches the first    *
+*  window. On Windows the sequential hint is given when the file is opened.   *
+*                                                                             *
+*******************************************************************************/
+void MappedFile::advise_sequential()
+{
+#ifndef _WIN32
+	if (address != NULL)
+		madvise(address, length, MADV_SEQUENTIAL);
+#endif
+	prefetch(0);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             MappedFile::prefetch                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  offset                                                                     *
+*           Byte offset the reader will get to next.                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Starts reading the window of MAPPED_PREFETCH_BYTES at offset in, without   *
+*  waiting for it. Only a window is asked for, rather than the whole view, so *
+*  that prefetching never pulls in more than discard() lets go of behind the  *
+*  reader. Nothing is done on Windows before Windows 8.                       *
+*                                                                             *
+*******************************************************************************/
+void MappedFile::prefetch(size_t offset)
+{
+	if (address == NULL || offset >= length)
+		return;
+
+	size_t page  = page_size();
+	size_t begin = (offset / page) * page;
+	size_t end   = (length - offset > MAPPED_PREFETCH_BYTES) ? offset + MAPPED_PREFETCH_BYTES :
+		length;
+#ifdef _WIN32
+	PrefetchVirtualMemoryFn prefetch_virtual_memory = prefetch_function();
+	if (prefetch_virtual_memory != NULL)
+	{
+		MemoryRange range = { (char*)address + begin, end - begin };
+		prefetch_virtual_memory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	madvise((char*)address + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                              MappedFile::discard                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  offset                                                                     *
+*           Byte offset of the start of the consumed range.                   *
+*  bytes                                                                      *
+*           Number of bytes in the consumed range.                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Drops the pages fully contained in the range from the resident set, so a   *
+*  front-to-back parse never holds more than its current window, and moves    *
+*  the prefetch window on to just past the range. The range is shrunk to page *
+*  boundaries; the view itself remains valid. On Windows the pages leave the  *
+*  working set through VirtualUnlock, which unlocked pages also answer to;    *
+*  the call reports that they were not locked, but they are trimmed anyway.   *
+*                                                                             *
+*******************************************************************************/
+void MappedFile::discard(size_t offset, size_t bytes)
+{
+	if (address == NULL || offset >= length)
+		return;
+	if (bytes > length - offset)
+		bytes = length - offset;
+
+	size_t page  = page_size();
+	size_t begin = ((offset + page - 1) / page) * page;
+	size_t end   = ((offset + bytes) / page) * page;
+	if (end > begin)
+	{
+#ifdef _WIN32
+		VirtualUnlock((char*)address + begin, end - begin);
+#else
+		madvise((char*)address + begin, end - begin, MADV_DONTNEED);
+#endif
+	}
+	prefetch(offset + bytes);
+}
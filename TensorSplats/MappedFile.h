@@ -0,0 +1,81 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <string>
+#include <cstddef>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define MAPPED_PREFETCH_BYTES   ((size_t)32 << 20)
+
+/******************************************************************************
+*                                                                             *
+*                                  MappedFile       (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  address                                                                    *
+*           Base address of the read-only view of the file.                   *
+*  length                                                                     *
+*           Number of bytes in the view (the size of the file).               *
+*  file                                                                       *
+*           Operating system handle of the open file.                         *
+*  mapping                                                                    *
+*           Operating system handle of the file mapping (Windows only).       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Class representing a read-only memory mapping of an entire file. The       *
+*  contents are paged in by the operating system as they are touched, so no   *
+*  intermediate copy of the file is ever made. A front-to-back reader asks    *
+*  for MAPPED_PREFETCH_BYTES ahead of where it is and discards what it has    *
+*  read, so only a window of the file around it is ever resident.             *
+*                                                                             *
+*******************************************************************************/
+class MappedFile
+{
+
+public:
+
+	// Constructors.
+	MappedFile();
+	~MappedFile();
+
+	// Map / unmap the file.
+	bool open(const std::string& file_path);
+	void close();
+
+	// Hint that the view will be read front to back, from its start.
+	void advise_sequential();
+
+	// Ask for the MAPPED_PREFETCH_BYTES from offset to be read in.
+	void prefetch(size_t offset);
+
+	// Release the pages of an already-consumed range of the view, and
+	// prefetch the window that follows it.
+	void discard(size_t offset, size_t bytes);
+
+	// Getters.
+	const void*   data() const              {  return address;               }
+	size_t        size() const              {  return length;                }
+	bool          is_open() const           {  return address != NULL;       }
+
+private:
+
+	void*          address;
+	size_t         length;
+	void*          file;
+	void*          mapping;
+
+	// Mappings are not copyable.
+	MappedFile(const MappedFile& other);
+	MappedFile& operator=(const MappedFile& other);
+
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <stdint.h>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define MORTON_AXIS_BITS        21
+
+/******************************************************************************
+*                                                                             *
+*                                morton_spread                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Moves bit n of the low MORTON_AXIS_BITS bits of v to bit 3n, in five       *
+*  shift-and-mask steps rather than a loop over the bits.                     *
+*                                                                             *
+*******************************************************************************/
+inline uint64_t morton_spread(uint32_t v)
+{
+	uint64_t x = v & 0x1FFFFF;
+	x = (x | (x << 32)) & 0x001F00000000FFFFull;
+	x = (x | (x << 16)) & 0x001F0000FF0000FFull;
+	x = (x | (x << 8))  & 0x100F00F00F00F00Full;
+	x = (x | (x << 4))  & 0x10C30C30C30C30C3ull;
+	x = (x | (x << 2))  & 0x1249249249249249ull;
+	return x;
+}
+
+/******************************************************************************
+*                                                                             *
+*                               morton_compact                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The inverse of morton_spread: gathers every third bit of x, starting with  *
+*  bit 0, into the low bits of the result.                                    *
+*                                                                             *
+*******************************************************************************/
+inline uint32_t morton_compact(uint64_t x)
+{
+	x &= 0x1249249249249249ull;
+	x = (x | (x >> 2))  & 0x10C30C30C30C30C3ull;
+	x = (x | (x >> 4))  & 0x100F00F00F00F00Full;
+	x = (x | (x >> 8))  & 0x001F0000FF0000FFull;
+	x = (x | (x >> 16)) & 0x001F00000000FFFFull;
+	x = (x | (x >> 32)) & 0x1FFFFF;
+	return (uint32_t)x;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          morton_encode / decode                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Z-order code of voxel (i, j, k), interleaving the bits of the three        *
+*  indices with i lowest. Voxels close in space have close codes, whatever    *
+*  the axis, so sorting by code keeps neighbours near each other in memory.   *
+*  Each index may use up to MORTON_AXIS_BITS bits.                            *
+*                                                                             *
+*******************************************************************************/
+inline uint64_t morton_encode(uint32_t i, uint32_t j, uint32_t k)
+{
+	return morton_spread(i) | (morton_spread(j) << 1) | (morton_spread(k) << 2);
+}
+inline void morton_decode(uint64_t code, uint32_t& i, uint32_t& j, uint32_t& k)
+{
+	i = morton_compact(code);
+	j = morton_compact(code >> 1);
+	k = morton_compact(code >> 2);
+}
@@ -0,0 +1,319 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "NiftiVolume.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Reverse the bytes of every value in an array in place.
+static void swap_bytes(void* values, size_t value_bytes, size_t count)
+{
+	unsigned char* bytes = (unsigned char*)values;
+	for (size_t v = 0; v < count; v++, bytes += value_bytes)
+	for (size_t b = 0; b < value_bytes / 2; b++)
+	{
+		unsigned char tmp = bytes[b];
+		bytes[b] = bytes[value_bytes - 1 - b];
+		bytes[value_bytes - 1 - b] = tmp;
+	}
+}
+
+// Convert count values of type T, swapping each one first if needed.
+template <typename T>
+static void convert_values(const void* src, size_t count, bool swapped,
+	GLfloat slope, GLfloat inter, GLfloat* dst)
+{
+	const unsigned char* bytes = (const unsigned char*)src;
+	for (size_t v = 0; v < count; v++, bytes += sizeof(T))
+	{
+		// Copy out first; the source may not be aligned for T.
+		T value;
+		memcpy(&value, bytes, sizeof(T));
+		if (swapped)
+			swap_bytes(&value, sizeof(T), 1);
+		dst[v] = ((GLfloat)value * slope) + inter;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::NiftiVolume                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the NiftiVolume object. The header is zeroed until  *
+*  read_header() or parse_header() succeeds.                                  *
+*                                                                             *
+*******************************************************************************/
+NiftiVolume::NiftiVolume() :
+swapped(false)
+{
+	memset(&hdr, 0, sizeof(hdr));
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::read_header                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  file_path                                                                  *
+*           Path to the .nii or .hdr file.                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if a valid NIfTI-1 header was read, false otherwise.                  *
+*                                                                             *
+*******************************************************************************/
+bool NiftiVolume::read_header(const std::string& file_path)
+{
+	unsigned char bytes[NIFTI_HEADER_BYTES];
+
+#ifdef HAVE_ZLIB
+	// gzread passes uncompressed files through unchanged.
+	gzFile fp = gzopen(file_path.c_str(), "rb");
+	if (fp == NULL) {
+		fprintf(stderr, "\nError opening header file %s\n", file_path.c_str());
+		return false;
+	}
+	size_t ret = (gzread(fp, bytes, NIFTI_HEADER_BYTES) == NIFTI_HEADER_BYTES) ? 1 : 0;
+	gzclose(fp);
+#else
+	FILE* fp = fopen(file_path.c_str(), "rb");
+	if (fp == NULL) {
+		fprintf(stderr, "\nError opening header file %s\n", file_path.c_str());
+		return false;
+	}
+	size_t ret = fread(bytes, NIFTI_HEADER_BYTES, 1, fp);
+	fclose(fp);
+#endif
+	if (ret != 1) {
+		fprintf(stderr, "\nError reading header file %s\n", file_path.c_str());
+		return false;
+	}
+
+	header_path = file_path;
+	if (!parse_header(bytes, NIFTI_HEADER_BYTES)) {
+		fprintf(stderr, "\n%s is not a NIfTI-1 header\n", file_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::parse_header                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  bytes                                                                      *
+*           The first bytes of a NIfTI-1 file.                                *
+*  length                                                                     *
+*           Number of bytes available (at least NIFTI_HEADER_BYTES).          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the bytes hold a valid NIfTI-1 header, false otherwise.            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Copies the header out of the bytes and, if it was written in the opposite  *
+*  byte order, swaps every numeric field the loaders use. Volumes of more     *
+*  than NIFTI_MAX_VOXELS voxels are refused.                                  *
+*                                                                             *
+*******************************************************************************/
+bool NiftiVolume::parse_header(const void* bytes, size_t length)
+{
+	if (length < NIFTI_HEADER_BYTES)
+		return false;
+	memcpy(&hdr, bytes, NIFTI_HEADER_BYTES);
+
+	swapped = NIFTI_NEEDS_SWAP(hdr) != 0;
+	if (swapped)
+	{
+		swap_bytes(&hdr.sizeof_hdr, sizeof(hdr.sizeof_hdr), 1);
+		swap_bytes(hdr.dim, sizeof(hdr.dim[0]), 8);
+		swap_bytes(&hdr.intent_code, sizeof(hdr.intent_code), 1);
+		swap_bytes(&hdr.datatype, sizeof(hdr.datatype), 1);
+		swap_bytes(&hdr.bitpix, sizeof(hdr.bitpix), 1);
+		swap_bytes(hdr.pixdim, sizeof(hdr.pixdim[0]), 8);
+		swap_bytes(&hdr.vox_offset, sizeof(hdr.vox_offset), 1);
+		swap_bytes(&hdr.scl_slope, sizeof(hdr.scl_slope), 1);
+		swap_bytes(&hdr.scl_inter, sizeof(hdr.scl_inter), 1);
+		swap_bytes(&hdr.sform_code, sizeof(hdr.sform_code), 1);
+		swap_bytes(hdr.srow_x, sizeof(hdr.srow_x[0]), 4);
+		swap_bytes(hdr.srow_y, sizeof(hdr.srow_y[0]), 4);
+		swap_bytes(hdr.srow_z, sizeof(hdr.srow_z[0]), 4);
+	}
+
+	return hdr.sizeof_hdr == NIFTI_HEADER_BYTES && NIFTI_VERSION(hdr) == 1 &&
+		hdr.dim[0] >= 3 && hdr.dim[0] <= 7 && volume_values() <= NIFTI_MAX_VOXELS;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::print_header                          *
+*                                                                             *
+*******************************************************************************/
+void NiftiVolume::print_header() const
+{
+	fprintf(stderr, "\n%s header information:", header_path.c_str());
+	fprintf(stderr, "\nNumber of dimensions: %d", hdr.dim[0]);
+	fprintf(stderr, "\nXYZT dimensions: %d %d %d %d %d", hdr.dim[1], hdr.dim[2], hdr.dim[3], hdr.dim[4], hdr.dim[5]);
+	fprintf(stderr, "\nDatatype code and bits/pixel: %d %d", hdr.datatype, hdr.bitpix);
+	fprintf(stderr, "\nScaling slope and intercept: %.6f %.6f", hdr.scl_slope, hdr.scl_inter);
+	fprintf(stderr, "\nByte offset to data in datafile: %ld", (long)(hdr.vox_offset));
+	fprintf(stderr, "\n");
+}
+
+/******************************************************************************
+*                                                                             *
+*                           NiftiVolume::data_path                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The header path itself for a single-file (n+1) volume, or the matching     *
+*  .img file for a header/image (ni1) pair (.img.gz for a .hdr.gz).           *
+*                                                                             *
+*******************************************************************************/
+std::string NiftiVolume::data_path() const
+{
+	if (NIFTI_ONEFILE(hdr))
+		return header_path;
+
+	std::string path = header_path;
+	std::string suffix = ".img";
+	if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0)
+	{
+		path = path.substr(0, path.size() - 3);
+		suffix += ".gz";
+	}
+	size_t dot = path.rfind('.');
+	if (dot != std::string::npos)
+		path = path.substr(0, dot);
+	return path + suffix;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::data_offset                           *
+*                                                                             *
+*******************************************************************************/
+size_t NiftiVolume::data_offset() const
+{
+	return NIFTI_ONEFILE(hdr) ? (size_t)hdr.vox_offset : 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::value_bytes                           *
+*                                                                             *
+*******************************************************************************/
+size_t NiftiVolume::value_bytes() const
+{
+	switch (hdr.datatype)
+	{
+	case DT_INT8:
+	case DT_UINT8:     return 1;
+	case DT_INT16:
+	case DT_UINT16:    return 2;
+	case DT_INT32:
+	case DT_UINT32:
+	case DT_FLOAT32:   return 4;
+	case DT_INT64:
+	case DT_UINT64:
+	case DT_FLOAT64:   return 8;
+	default:           return 0;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                         NiftiVolume::volume_values                          *
+*                                                                             *
+*******************************************************************************/
+size_t NiftiVolume::volume_values() const
+{
+	return (size_t)hdr.dim[1] * hdr.dim[2] * hdr.dim[3];
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NiftiVolume::num_volumes                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The length of the fourth (time) dimension, or 1 for a single volume.       *
+*                                                                             *
+*******************************************************************************/
+GLuint NiftiVolume::num_volumes() const
+{
+	return (hdr.dim[0] >= 4 && hdr.dim[4] > 1) ? (GLuint)hdr.dim[4] : 1;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             NiftiVolume::convert                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  src                                                                        *
+*           Raw values, in file byte order. Need not be aligned.              *
+*  count                                                                      *
+*           Number of values to convert.                                      *
+*  scale                                                                      *
+*           Extra factor applied after scl_slope / scl_inter.                 *
+*  dst                                                                        *
+*           Array receiving the converted values.                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Converts raw voxel values to floats. A scl_slope of zero means the values  *
+*  are stored unscaled, as the NIfTI-1 standard requires.                     *
+*                                                                             *
+*******************************************************************************/
+void NiftiVolume::convert(const void* src, size_t count, GLfloat scale,
+	GLfloat* dst) const
+{
+	GLfloat slope = (hdr.scl_slope != 0) ? hdr.scl_slope : 1.0f;
+	GLfloat inter = (hdr.scl_slope != 0) ? hdr.scl_inter : 0.0f;
+	slope *= scale;
+	inter *= scale;
+
+	switch (hdr.datatype)
+	{
+	case DT_INT8:    convert_values<signed char>       (src, count, swapped, slope, inter, dst); break;
+	case DT_UINT8:   convert_values<unsigned char>     (src, count, swapped, slope, inter, dst); break;
+	case DT_INT16:   convert_values<short>             (src, count, swapped, slope, inter, dst); break;
+	case DT_UINT16:  convert_values<unsigned short>    (src, count, swapped, slope, inter, dst); break;
+	case DT_INT32:   convert_values<int>               (src, count, swapped, slope, inter, dst); break;
+	case DT_UINT32:  convert_values<unsigned int>      (src, count, swapped, slope, inter, dst); break;
+	case DT_INT64:   convert_values<long long>         (src, count, swapped, slope, inter, dst); break;
+	case DT_UINT64:  convert_values<unsigned long long>(src, count, swapped, slope, inter, dst); break;
+	case DT_FLOAT32: convert_values<float>             (src, count, swapped, slope, inter, dst); break;
+	case DT_FLOAT64: convert_values<double>            (src, count, swapped, slope, inter, dst); break;
+	default:         memset(dst, 0, sizeof(GLfloat) * count);                                      break;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                            NiftiVolume::is_tensor                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true for a NIFTI_INTENT_SYMMATRIX volume with six values per voxel (the    *
+*  lower triangle of a 3 x 3 matrix) stored along the fifth dimension.        *
+*                                                                             *
+*******************************************************************************/
+bool NiftiVolume::is_tensor() const
+{
+	return hdr.intent_code == NIFTI_INTENT_SYMMATRIX && hdr.dim[0] == 5 &&
+		hdr.dim[5] == NIFTI_TENSOR_COMPONENTS;
+}
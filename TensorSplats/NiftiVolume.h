@@ -0,0 +1,82 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <GL\glew.h>
+#include <nifticlib\nifti1.h>
+#include <string>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define NIFTI_HEADER_BYTES      348
+#define NIFTI_TENSOR_COMPONENTS 6
+
+// Most voxels a volume may have, so that every voxel has a 32-bit index.
+#define NIFTI_MAX_VOXELS        ((size_t)0xFFFFFFFEu)
+
+/******************************************************************************
+*                                                                             *
+*                                  NiftiVolume      (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  hdr                                                                        *
+*           The NIfTI-1 header, converted to native byte order.               *
+*  swapped                                                                    *
+*           Whether the file was written in the opposite byte order, in which *
+*           case the voxel values must be swapped as well.                    *
+*  header_path                                                                *
+*           Path the header was read from.                                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Class describing the layout of a NIfTI-1 volume: its header, where its     *
+*  voxel data lives, and how to turn raw voxel values of any of the integer   *
+*  or floating point datatypes into scaled floats. Parsing the voxels is left *
+*  to the caller, so the data can come from a mapping, a buffer or a stream.  *
+*                                                                             *
+*******************************************************************************/
+class NiftiVolume
+{
+
+public:
+
+	nifti_1_header hdr;
+	bool           swapped;
+	std::string    header_path;
+
+	// Constructor.
+	NiftiVolume();
+
+	// Read the header from a .nii / .hdr file (gzipped if built with zlib), or
+	// from bytes already in memory.
+	bool read_header(const std::string& file_path);
+	bool parse_header(const void* bytes, size_t length);
+
+	// Print the header information to stderr.
+	void print_header() const;
+
+	// Path of the file holding the voxel data, and the offset of the data in it.
+	std::string data_path() const;
+	size_t      data_offset() const;
+
+	// Size of a single value, or 0 if the datatype is not supported.
+	size_t value_bytes() const;
+
+	// Number of values in one 3-D volume, and number of volumes in the series.
+	size_t volume_values() const;
+	GLuint num_volumes() const;
+
+	// Convert raw values to floats, applying byte order, scl_slope/scl_inter and scale.
+	void convert(const void* src, size_t count, GLfloat scale, GLfloat* dst) const;
+
+	// Whether the volume is a 6-component symmetric tensor field.
+	bool is_tensor() const;
+
+};
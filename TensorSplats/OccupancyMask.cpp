@@ -0,0 +1,87 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "OccupancyMask.h"
+#include <algorithm>
+
+/******************************************************************************
+*                                                                             *
+*                         OccupancyMask::OccupancyMask                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the OccupancyMask object. It covers no voxels until *
+*  assign() is called.                                                        *
+*                                                                             *
+*******************************************************************************/
+OccupancyMask::OccupancyMask() :
+voxel_count(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                            OccupancyMask::assign                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  voxels                                                                     *
+*           Number of voxels in the field.                                    *
+*                                                                             *
+*******************************************************************************/
+void OccupancyMask::assign(size_t voxels)
+{
+	size_t words = (voxels + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS;
+	bits.assign(words, 0);
+	summary.assign((words + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS, 0);
+	voxel_count = voxels;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         OccupancyMask::clear / swap                         *
+*                                                                             *
+*******************************************************************************/
+void OccupancyMask::clear()
+{
+	std::vector<uint64_t>().swap(bits);
+	std::vector<uint64_t>().swap(summary);
+	voxel_count = 0;
+}
+void OccupancyMask::swap(OccupancyMask& other)
+{
+	bits.swap(other.bits);
+	summary.swap(other.summary);
+	std::swap(voxel_count, other.voxel_count);
+}
+
+/******************************************************************************
+*                                                                             *
+*                         OccupancyMask::set / reset                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  voxel                                                                      *
+*           Linear index of the voxel.                                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Update the voxel's bit, and its word's summary bit when the word becomes   *
+*  non-zero or zero.                                                          *
+*                                                                             *
+*******************************************************************************/
+void OccupancyMask::set(size_t voxel)
+{
+	size_t word = voxel / OCCUPANCY_WORD_BITS;
+	bits[word] |= 1ull << (voxel % OCCUPANCY_WORD_BITS);
+	summary[word / OCCUPANCY_WORD_BITS] |= 1ull << (word % OCCUPANCY_WORD_BITS);
+}
+void OccupancyMask::reset(size_t voxel)
+{
+	size_t word = voxel / OCCUPANCY_WORD_BITS;
+	bits[word] &= ~(1ull << (voxel % OCCUPANCY_WORD_BITS));
+	if (bits[word] == 0)
+		summary[word / OCCUPANCY_WORD_BITS] &= ~(1ull << (word % OCCUPANCY_WORD_BITS));
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define NO_VOXEL                ((size_t)-1)
+#define OCCUPANCY_WORD_BITS     64
+
+// Bits at and above bit of a word.
+#define BITS_FROM(bit)          (~0ull << (bit))
+
+// Position of the lowest set bit of a non-zero word.
+#ifdef _MSC_VER
+inline size_t lowest_bit64(uint64_t x)
+{
+	unsigned long bit;
+	_BitScanForward64(&bit, x);
+	return bit;
+}
+#else
+#define lowest_bit64(x)         ((size_t)__builtin_ctzll(x))
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                                OccupancyMask      (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  bits                                                                       *
+*           One bit per voxel, in linear voxel order, set if it is occupied.  *
+*  summary                                                                    *
+*           One bit per word of bits, set if that word is not zero, so one    *
+*           summary word covers OCCUPANCY_WORD_BITS^2 voxels.                 *
+*  voxel_count                                                                *
+*           Number of voxels covered.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Records which voxels of a field hold a splat, as a two-level bit pyramid.  *
+*  Most of a DTI volume is background, so a walk over the occupied voxels     *
+*  tests whole words of bits at a time and jumps over empty runs with a bit   *
+*  scan, first through the summary and then through the voxel bits. Its cost  *
+*  grows with the occupied voxels rather than with the bounding box.          *
+*                                                                             *
+*******************************************************************************/
+class OccupancyMask
+{
+
+public:
+
+	// Constructors.
+	OccupancyMask();
+
+	// Cover voxels voxels, all empty.
+	void assign(size_t voxels);
+
+	// Free the bits, or exchange them with another mask's.
+	void clear();
+	void swap(OccupancyMask& other);
+
+	// Mark a voxel occupied or empty.
+	void set(size_t voxel);
+	void reset(size_t voxel);
+
+	// Whether a voxel is occupied.
+	bool test(size_t voxel) const
+	{
+		return (bits[voxel / OCCUPANCY_WORD_BITS] >> (voxel % OCCUPANCY_WORD_BITS)) & 1;
+	}
+
+	// First occupied voxel in [first, last), or NO_VOXEL.
+	size_t next(size_t first, size_t last) const;
+
+	// Occupancy of the OCCUPANCY_WORD_BITS voxels from first on, first in
+	// the lowest bit; voxels past the end read as empty.
+	uint64_t word(size_t first) const
+	{
+		size_t w = first / OCCUPANCY_WORD_BITS, bit = first % OCCUPANCY_WORD_BITS;
+		uint64_t word = bits[w] >> bit;
+		if (bit != 0 && w + 1 < bits.size())
+			word |= bits[w + 1] << (OCCUPANCY_WORD_BITS - bit);
+		return word;
+	}
+
+	// Getters.
+	size_t        size() const              {  return voxel_count;           }
+	bool          empty() const             {  return bits.empty();          }
+
+private:
+
+	std::vector<uint64_t>  bits;
+	std::vector<uint64_t>  summary;
+	size_t                 voxel_count;
+
+	// First non-zero word of bits at or after word, or NO_VOXEL.
+	size_t next_word(size_t word) const;
+
+	// Masks are not copyable.
+	OccupancyMask(const OccupancyMask& other);
+	OccupancyMask& operator=(const OccupancyMask& other);
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                             OccupancyMask::next                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  first                                                                      *
+*           First voxel to consider.                                          *
+*  last                                                                       *
+*           Voxel at which to stop, not itself considered.                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The first occupied voxel in the range, or NO_VOXEL if there is none.       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Scans the word holding first from that bit up; if it is empty, finds the   *
+*  next non-empty word through the summary, so each empty word costs at most  *
+*  one summary bit and each empty summary word skips 4096 voxels.             *
+*                                                                             *
+*******************************************************************************/
+inline size_t OccupancyMask::next(size_t first, size_t last) const
+{
+	if (last > voxel_count)
+		last = voxel_count;
+	if (first >= last)
+		return NO_VOXEL;
+
+	size_t word = first / OCCUPANCY_WORD_BITS;
+	uint64_t w = bits[word] & BITS_FROM(first % OCCUPANCY_WORD_BITS);
+	if (w == 0)
+	{
+		word = next_word(word + 1);
+		if (word == NO_VOXEL || word * OCCUPANCY_WORD_BITS >= last)
+			return NO_VOXEL;
+		w = bits[word];
+	}
+
+	size_t voxel = (word * OCCUPANCY_WORD_BITS) + lowest_bit64(w);
+	return (voxel < last) ? voxel : NO_VOXEL;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           OccupancyMask::next_word                          *
+*                                                                             *
+*******************************************************************************/
+inline size_t OccupancyMask::next_word(size_t word) const
+{
+	size_t s = word / OCCUPANCY_WORD_BITS;
+	if (s >= summary.size())
+		return NO_VOXEL;
+
+	uint64_t w = summary[s] & BITS_FROM(word % OCCUPANCY_WORD_BITS);
+	while (w == 0)
+	{
+		if (++s == summary.size())
+			return NO_VOXEL;
+		w = summary[s];
+	}
+	return (s * OCCUPANCY_WORD_BITS) + lowest_bit64(w);
+}
@@ -0,0 +1,488 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "SplatCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+// The records are written straight from memory, so their layout is the format.
+static_assert(sizeof(TensorSample) == 92, "TensorSample layout changed; bump SPLAT_CACHE_VERSION");
+static_assert(sizeof(SplatCacheHeader) == 112, "SplatCacheHeader must be 112 bytes");
+
+// Size and modification time of a file, at the finest resolution the system
+// keeps; false if it does not exist.
+static bool file_stamp(const std::string& file_path, uint64_t& size, uint64_t& mtime)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(file_path.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+	size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	mtime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) |
+		attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat file_stat;
+	if (stat(file_path.c_str(), &file_stat) != 0)
+		return false;
+	size = (uint64_t)file_stat.st_size;
+	mtime = (uint64_t)file_stat.st_mtime * 1000000000ULL;
+#ifdef __linux__
+	mtime += (uint64_t)file_stat.st_mtim.tv_nsec;
+#endif
+#endif
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatCache::SplatCache                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the SplatCache object. Nothing is written until     *
+*  create() is called.                                                        *
+*                                                                             *
+*******************************************************************************/
+SplatCache::SplatCache() :
+file(NULL), ok(false)
+{
+	memset(&header, 0, sizeof(header));
+}
+SplatCache::~SplatCache()
+{
+	abort();
+}
+
+/******************************************************************************
+*                                                                             *
+*                            SplatCache::checksum                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  bytes                                                                      *
+*           Bytes to hash. Need not be aligned.                               *
+*  length                                                                     *
+*           Number of bytes.                                                  *
+*  hash                                                                       *
+*           Hash of the preceding bytes, or FNV_OFFSET to start.              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  FNV-1a taken a 64-bit word at a time rather than a byte at a time, so      *
+*  verifying a cache costs far less than the load it replaces.                *
+*                                                                             *
+*******************************************************************************/
+uint64_t SplatCache::checksum(const void* bytes, size_t length, uint64_t hash)
+{
+	const unsigned char* data = (const unsigned char*)bytes;
+	size_t words = length / sizeof(uint64_t);
+
+	for (size_t w = 0; w < words; w++, data += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		hash = (hash ^ word) * FNV_PRIME;
+	}
+	for (size_t b = words * sizeof(uint64_t); b < length; b++, data++)
+		hash = (hash ^ *data) * FNV_PRIME;
+	return hash;
+}
+
+// Checksum of a run of records, hashed one record at a time so the result
+// does not depend on how the records were split into slabs.
+static uint64_t record_checksum(const TensorSample* samples, size_t count, uint64_t hash)
+{
+	for (size_t s = 0; s < count; s++)
+		hash = SplatCache::checksum(&samples[s], sizeof(TensorSample), hash);
+	return hash;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          SplatCache::volume_path                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The source path with the extension (SPLAT_CACHE_EXTENSION by default)      *
+*  added, preceded by the volume index for any volume of a series after the   *
+*  first.                                                                     *
+*                                                                             *
+*******************************************************************************/
+std::string SplatCache::volume_path(const std::string& source_path, GLuint index,
+	const char* extension)
+{
+	if (index == 0)
+		return source_path + extension;
+	return source_path + "." + std::to_string((unsigned long long)index) + extension;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatCache::source_key                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  loader                                                                     *
+*           Name of the loader that builds the field from the sources.        *
+*  sources                                                                    *
+*           Every file the loader reads.                                      *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Hash of the cache version, the loader and its parameters, and the path,    *
+*  size and modification time of each source; 0 if a source is missing.       *
+*                                                                             *
+*******************************************************************************/
+uint64_t SplatCache::source_key(const std::string& loader,
+	const std::vector<std::string>& sources)
+{
+	uint64_t hash = FNV_OFFSET;
+
+	// Anything that changes which splats survive, or their values.
+	const double params[] = { SPLAT_CACHE_VERSION, EIG_SCALE, NIFTI_TENSOR_SCALE,
+		SIGNIFICANT_DETERMINANT, SIGNIFICANT_SPHERICAL };
+	hash = checksum(params, sizeof(params), hash);
+	hash = checksum(loader.c_str(), loader.size() + 1, hash);
+
+	for (size_t s = 0; s < sources.size(); s++)
+	{
+		uint64_t stamp[2];
+		if (!file_stamp(sources[s], stamp[0], stamp[1]))
+			return 0;
+		hash = checksum(sources[s].c_str(), sources[s].size() + 1, hash);
+		hash = checksum(stamp, sizeof(stamp), hash);
+	}
+
+	// Zero is reserved for "no key".
+	return (hash == 0) ? 1 : hash;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatCache::load                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  cache_path                                                                 *
+*           Path to the .tsplat file.                                         *
+*  key                                                                        *
+*           Source key the cache must have been written with.                 *
+*  sink                                                                       *
+*           Receives the field and its slabs, as for the loaders, or empty to *
+*           create the splats here.                                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A new tensor field, or NULL if the file is missing, was written for other  *
+*  sources or another version, or fails its checksum.                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Maps the file and hands its records straight to the field; nothing is      *
+*  recomputed. With a sink the records are passed on a slab of z-slices at a  *
+*  time, just as a loader would, until the sink declines the rest.            *
+*                                                                             *
+*******************************************************************************/
+TensorField* SplatCache::load(const std::string& cache_path, uint64_t key,
+	const SampleSink& sink)
+{
+	uint64_t size, mtime;
+	if (key == 0 || !file_stamp(cache_path, size, mtime))
+		return NULL;
+
+	MappedFile file;
+	if (!file.open(cache_path) || file.size() < sizeof(SplatCacheHeader))
+		return NULL;
+
+	SplatCacheHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+
+	if (memcmp(header.magic, SPLAT_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != SPLAT_CACHE_VERSION ||
+		header.header_bytes != sizeof(SplatCacheHeader) ||
+		header.record_bytes != sizeof(TensorSample))
+	{
+		fprintf(stderr, "\nIgnoring %s: written by another version\n", cache_path.c_str());
+		return NULL;
+	}
+	if (header.source_key != key)
+	{
+		fprintf(stderr, "\nIgnoring %s: source files or settings changed\n", cache_path.c_str());
+		return NULL;
+	}
+
+	size_t records = (size_t)header.record_count;
+	if (file.size() != header.header_bytes + (records * header.record_bytes))
+	{
+		fprintf(stderr, "\nIgnoring %s: truncated\n", cache_path.c_str());
+		return NULL;
+	}
+
+	file.advise_sequential();
+	const TensorSample* samples = (const TensorSample*)
+		((const unsigned char*)file.data() + header.header_bytes);
+	if (record_checksum(samples, records, FNV_OFFSET) != header.checksum)
+	{
+		fprintf(stderr, "\nIgnoring %s: checksum mismatch\n", cache_path.c_str());
+		return NULL;
+	}
+	for (size_t s = 0; s < records; s++)
+	{
+		if (samples[s].i >= header.x_size || samples[s].j >= header.y_size ||
+			samples[s].k >= header.z_size)
+		{
+			fprintf(stderr, "\nIgnoring %s: voxel index out of range\n", cache_path.c_str());
+			return NULL;
+		}
+	}
+
+	glm::mat4 voxel_to_world(1.0f);
+	for (GLuint c = 0; c < 4; c++)
+		voxel_to_world[c] = glm::vec4(header.sform[0][c], header.sform[1][c],
+			header.sform[2][c], (c == 3) ? 1.0f : 0.0f);
+	TensorField* tf = TensorField::create(header.x_size, header.y_size, header.z_size,
+		voxel_to_world, sink);
+	if (!sink)
+		tf->add_samples(samples, records);
+	else
+	{
+		// Records are in k/j/i order, so each slab is a contiguous run.
+		for (size_t s = 0; s < records;)
+		{
+			GLuint k_end = ((samples[s].k / EIG_SLAB_DEPTH) + 1) * EIG_SLAB_DEPTH;
+			size_t end = s;
+			while (end < records && samples[end].k < k_end)
+				end++;
+
+			SampleList slab(samples + s, samples + end);
+			if (!tf->submit_samples(slab))
+				break;
+			s = end;
+		}
+		tf->sink = SampleSink();
+	}
+
+	fprintf(stderr, "\nLoaded %lu splats from %s\n", (unsigned long)records, cache_path.c_str());
+	return tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SplatCache::create                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  cache_path                                                                 *
+*           Path to the .tsplat file to (re)write.                            *
+*  key                                                                        *
+*           Source key of the files the field is being loaded from.           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the temporary file was created, false otherwise.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Everything is written to a temporary file which replaces the cache only    *
+*  once finish() succeeds, so an interrupted load never leaves a half-written *
+*  cache behind.                                                              *
+*                                                                             *
+*******************************************************************************/
+bool SplatCache::create(const std::string& cache_path, uint64_t key)
+{
+	abort();
+	if (key == 0)
+		return false;
+
+	this->cache_path = cache_path;
+	temp_path = cache_path + ".tmp";
+	file = fopen(temp_path.c_str(), "wb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "\nCannot write splat cache %s\n", temp_path.c_str());
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SPLAT_CACHE_MAGIC, sizeof(header.magic));
+	header.version = SPLAT_CACHE_VERSION;
+	header.header_bytes = sizeof(SplatCacheHeader);
+	header.record_bytes = sizeof(TensorSample);
+	header.source_key = key;
+	header.checksum = FNV_OFFSET;
+
+	// Reserve the header; it is rewritten once the count and checksum are known.
+	ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	return ok;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SplatCache::append                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  samples                                                                    *
+*           The next slab of samples, in the order the loader produced them.  *
+*                                                                             *
+*******************************************************************************/
+void SplatCache::append(const SampleList& samples)
+{
+	if (file == NULL || !ok || samples.empty())
+		return;
+
+	header.checksum = record_checksum(&samples[0], samples.size(), header.checksum);
+	header.record_count += samples.size();
+	ok = fwrite(&samples[0], sizeof(TensorSample), samples.size(), file) == samples.size();
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SplatCache::finish                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  tf                                                                         *
+*           The field the appended samples were loaded into.                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the cache was written, false otherwise.                            *
+*                                                                             *
+*******************************************************************************/
+bool SplatCache::finish(const TensorField* tf)
+{
+	if (file == NULL)
+		return false;
+
+	header.x_size = tf->x_size;
+	header.y_size = tf->y_size;
+	header.z_size = tf->z_size;
+	for (GLuint r = 0; r < 3; r++)
+	for (GLuint c = 0; c < 4; c++)
+		header.sform[r][c] = tf->voxel_to_world[c][r];
+	ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+	file = NULL;
+
+	// rename() will not replace an existing file on Windows.
+	if (ok)
+	{
+		remove(cache_path.c_str());
+		ok = rename(temp_path.c_str(), cache_path.c_str()) == 0;
+	}
+	if (!ok)
+	{
+		fprintf(stderr, "\nCannot write splat cache %s\n", cache_path.c_str());
+		remove(temp_path.c_str());
+	}
+	return ok;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatCache::abort                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Closes and deletes an unfinished temporary file.                           *
+*                                                                             *
+*******************************************************************************/
+void SplatCache::abort()
+{
+	if (file != NULL)
+	{
+		fclose(file);
+		file = NULL;
+		remove(temp_path.c_str());
+	}
+	ok = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          SplatCache::load_or_build                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  cache_path                                                                 *
+*           Path to the .tsplat file.                                         *
+*  loader                                                                     *
+*           Name of the loader, part of the source key.                       *
+*  sources                                                                    *
+*           Every file the loader reads.                                      *
+*  sink                                                                       *
+*           Receives the field and its slabs, or empty to create splats here. *
+*  build                                                                      *
+*           Runs the loader with the sink it is given; called only when the   *
+*           cache cannot be used.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  On a miss the loader's slabs pass through a writer on their way to the     *
+*  sink, so the cache is built from the same samples the field receives and   *
+*  never has to be read back out of the field. A load the sink cancelled is   *
+*  incomplete, and leaves no cache behind.                                    *
+*                                                                             *
+*******************************************************************************/
+TensorField* SplatCache::load_or_build(const std::string& cache_path,
+	const std::string& loader, const std::vector<std::string>& sources,
+	const SampleSink& sink, const std::function<TensorField*(const SampleSink&)>& build)
+{
+	if (!SPLAT_CACHE_ENABLED)
+		return build(sink);
+
+	uint64_t key = source_key(loader, sources);
+	TensorField* tf = load(cache_path, key, sink);
+	if (tf != NULL)
+		return tf;
+
+	SplatCache writer;
+	if (!writer.create(cache_path, key))
+		return build(sink);
+
+	TensorField* built = NULL;
+	tf = build([&](TensorField* field, SampleList& samples) -> bool
+	{
+		built = field;
+		writer.append(samples);
+		if (sink)
+			return sink(field, samples);
+		field->add_samples(samples);
+		return true;
+	});
+
+	if (tf == NULL)
+	{
+		// The field was kept for the writer; free it unless a sink owns it.
+		if (built != NULL && !sink)
+		{
+			built->cleanUp();
+			delete built;
+		}
+		return NULL;
+	}
+
+	// A load the sink cancelled is incomplete; never cache it.
+	if (tf->cancelled)
+	{
+		writer.abort();
+		return tf;
+	}
+
+	tf->sink = SampleSink();
+	writer.finish(tf);
+	return tf;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include "TensorSplat.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define SPLAT_CACHE_ENABLED     true
+#define SPLAT_CACHE_EXTENSION   ".tsplat"
+#define SPLAT_CACHE_MAGIC       "TSPLAT\r\n"
+#define SPLAT_CACHE_VERSION     2
+#define FNV_OFFSET              14695981039346656037ULL
+#define FNV_PRIME               1099511628211ULL
+
+/******************************************************************************
+*                                                                             *
+*                           SplatCacheHeader     (struct)                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  First 112 bytes of a .tsplat file. It is followed directly by              *
+*  record_count TensorSample records in k/j/i scan order, so a mapped file    *
+*  can be handed to TensorField::add_samples without any parsing. The magic   *
+*  ends in CR LF so a file mangled by a text-mode copy is rejected. sform     *
+*  holds the field's voxel-to-world rows, which a compact field needs.        *
+*                                                                             *
+*******************************************************************************/
+struct SplatCacheHeader
+{
+
+	char           magic[8];
+	uint32_t       version;
+	uint32_t       header_bytes;
+	uint32_t       record_bytes;
+	uint32_t       x_size;
+	uint32_t       y_size;
+	uint32_t       z_size;
+	uint64_t       record_count;
+	uint64_t       source_key;
+	uint64_t       checksum;
+	uint64_t       reserved;
+	float          sform[3][4];
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                  SplatCache       (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  file                                                                       *
+*           Temporary file being written, or NULL.                            *
+*  cache_path                                                                 *
+*           Path the temporary file replaces when it is finished.             *
+*  temp_path                                                                  *
+*           Path of the temporary file.                                       *
+*  header                                                                     *
+*           Header of the file being written; count and checksum so far.      *
+*  ok                                                                         *
+*           Whether every write so far has succeeded.                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads and writes .tsplat files: the significant splats of a tensor field   *
+*  after the loader has done all of its per-voxel work. A cache is tied to a  *
+*  source key covering the loader, its parameters and the size and            *
+*  modification time of every source file, and its records are checksummed;   *
+*  a cache that fails either check is ignored and rebuilt. A SplatCache       *
+*  object writes one file, a slab at a time as the loader produces them.      *
+*                                                                             *
+*******************************************************************************/
+class SplatCache
+{
+
+public:
+
+	// Constructors. An unfinished file is deleted.
+	SplatCache();
+	~SplatCache();
+
+	// Start writing a cache for the given source key.
+	bool create(const std::string& cache_path, uint64_t key);
+
+	// Append a slab of samples.
+	void append(const SampleList& samples);
+
+	// Complete the file for the field the samples belong to, or throw it away.
+	bool finish(const TensorField* tf);
+	void abort();
+
+	// Fingerprint of a loader, its parameters and its source files, or 0 if
+	// a source cannot be found.
+	static uint64_t source_key(const std::string& loader,
+		const std::vector<std::string>& sources);
+
+	// Build a field from a cache file; NULL if it is missing, stale or corrupt.
+	static TensorField* load(const std::string& cache_path, uint64_t key,
+		const SampleSink& sink);
+
+	// Load from the cache, or run the loader and cache what it produces.
+	static TensorField* load_or_build(const std::string& cache_path,
+		const std::string& loader, const std::vector<std::string>& sources,
+		const SampleSink& sink, const std::function<TensorField*(const SampleSink&)>& build);
+
+	// FNV-1a hash of a run of bytes, continuing from hash.
+	static uint64_t checksum(const void* bytes, size_t length, uint64_t hash);
+
+	// Cache file for one volume of a source.
+	static std::string volume_path(const std::string& source_path, GLuint index,
+		const char* extension = SPLAT_CACHE_EXTENSION);
+
+private:
+
+	FILE*              file;
+	std::string        cache_path;
+	std::string        temp_path;
+	SplatCacheHeader   header;
+	bool               ok;
+
+	// Writers are not copyable.
+	SplatCache(const SplatCache& other);
+	SplatCache& operator=(const SplatCache& other);
+
+};
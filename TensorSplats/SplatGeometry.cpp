@@ -0,0 +1,265 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "SplatGeometry.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+// The eye as seen from a splat in its parameter space.
+static void look_from(SplatView& view, const glm::vec3& eye)
+{
+	glm::vec3 e_tilda = view.inverse * (eye - view.center);
+	view.distance = glm::length(e_tilda);
+	view.direction = (view.distance > 0.0f) ? e_tilda / view.distance : glm::vec3(0.0f);
+}
+
+/******************************************************************************
+*                                                                             *
+*                       SplatGeometry::SplatGeometry                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  pool                                                                       *
+*           Threads to expand the splats on; it must outlive the geometry.    *
+*                                                                             *
+*******************************************************************************/
+SplatGeometry::SplatGeometry(ThreadPool& pool) :
+pool(pool), count(0), origin(0.0f), eye(0.0f), up(0.0f),
+tolerance(SPLAT_VIEW_TOLERANCE), expanded(false), full_distance(FLT_MAX), num_stale(0),
+num_expanded(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                         SplatGeometry::set_tolerance                        *
+*                                                                             *
+*******************************************************************************/
+void SplatGeometry::set_tolerance(GLfloat radians)
+{
+	tolerance = std::max(radians, 0.0f);
+	expanded = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            SplatGeometry::update                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  store                                                                      *
+*           Store holding the splats.                                         *
+*  splats                                                                     *
+*           Slots of the splats to be drawn.                                  *
+*  changed                                                                    *
+*           Whether the store or the slots have changed since the last        *
+*           update.                                                           *
+*  eye, up                                                                    *
+*           Position of the eye and up direction of the camera.               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if any vertex has changed, and so must be uploaded again.             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Without a tolerance every quad is expanded whenever the eye or up          *
+*  direction moves, as before. With one, a turn of the camera alone changes   *
+*  nothing, and a move of the eye only expands the quads it takes beyond      *
+*  tolerance, along with any the budget left stale last time. Once the eye is *
+*  as far from origin as it was when half of them were found due, all are     *
+*  expanded without testing any.                                              *
+*                                                                             *
+*******************************************************************************/
+bool SplatGeometry::update(const SplatStore& store, const Slice& splats, bool changed,
+	const glm::vec3& e, const glm::vec3& u)
+{
+	bool eye_moved = (e != eye), up_moved = (u != up);
+	eye = e;
+	up = u;
+	num_expanded = 0;
+
+	if (changed || !expanded || splats.count != count ||
+		(tolerance <= 0.0f && (eye_moved || up_moved)))
+	{
+		expand_all(store, splats, false);
+		return true;
+	}
+	if (tolerance <= 0.0f || (!eye_moved && num_stale == 0))
+		return false;
+
+	// Origin is where the eye was when every quad was last expanded.
+	GLfloat distance = glm::length(eye - origin);
+	if (distance >= full_distance)
+	{
+		expand_all(store, splats, true);
+		return true;
+	}
+
+	refresh(store, splats, distance);
+	return num_expanded > 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          SplatGeometry::expand_all                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  store, splats                                                              *
+*           As for update.                                                    *
+*  same_splats                                                                *
+*           Whether views already holds the center and inverse of every       *
+*           splat.                                                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  SPLAT_TASK_SIZE splats at a time on the pool, each task into its own range *
+*  of the vertices, noting the eye each was expanded for if a tolerance is    *
+*  set.                                                                       *
+*                                                                             *
+*******************************************************************************/
+void SplatGeometry::expand_all(const SplatStore& store, const Slice& splats,
+	bool same_splats)
+{
+	if (!same_splats)
+		full_distance = FLT_MAX;
+	count = splats.count;
+	origin = eye;
+	expanded = true;
+	num_stale = 0;
+	num_expanded = count;
+	if (vertices.size() < count * SPLAT_NUM_VERTICES)
+		vertices.resize(count * SPLAT_NUM_VERTICES);
+	bool keep_views = tolerance > 0.0f;
+	if (keep_views && views.size() < count)
+		views.resize(count);
+
+	size_t num_tasks = (count + SPLAT_TASK_SIZE - 1) / SPLAT_TASK_SIZE;
+	pool.parallel_for(num_tasks, [&](size_t task)
+	{
+		size_t first = task * SPLAT_TASK_SIZE;
+		size_t n = std::min(count - first, (size_t)SPLAT_TASK_SIZE);
+		store.recalculate(&splats.slots[first], n, eye, up,
+			&vertices[first * SPLAT_NUM_VERTICES]);
+		if (!keep_views)
+			return;
+		TensorSplat_Instance instance;
+		for (size_t s = first; s < first + n; s++)
+		{
+			if (!same_splats)
+			{
+				store.get_instances(&splats.slots[s], 1, &instance);
+				views[s].inverse = instance.tensor_inv;
+				views[s].center = instance.center;
+			}
+			look_from(views[s], eye);
+		}
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatGeometry::refresh                            *
+*                                                                             *
+* PARAMETERS                                                                  *
+*  store, splats                                                              *
+*           As for update.                                                    *
+*  distance                                                                   *
+*           How far the eye is from origin.                                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Each task tests its range of splats against the tolerance, in each         *
+*  splat's parameter space, where its quad is made: the angle between the eye *
+*  it was expanded for and the eye now, and the change in their distances     *
+*  relative to the distance now, which bounds the change in how large it      *
+*  looks. If half or more are due, all are expanded, as that costs no more,   *
+*  and distance is noted as far enough to expand all without testing.         *
+*  Otherwise, over budget, the nearest are chosen; those splats are expanded  *
+*  together, moved from the eye to the origin and put in place, each task its *
+*  own share.                                                                 *
+*                                                                             *
+*******************************************************************************/
+void SplatGeometry::refresh(const SplatStore& store, const Slice& splats,
+	GLfloat distance)
+{
+	const GLfloat cos_tolerance = std::cos(tolerance);
+	size_t num_tasks = (count + SPLAT_TASK_SIZE - 1) / SPLAT_TASK_SIZE;
+	if (found.size() < num_tasks)
+		found.resize(num_tasks);
+	pool.parallel_for(num_tasks, [&](size_t task)
+	{
+		size_t first = task * SPLAT_TASK_SIZE;
+		size_t last = std::min(count, first + SPLAT_TASK_SIZE);
+		std::vector<GLuint>& stale = found[task];
+		stale.clear();
+		for (size_t s = first; s < last; s++)
+		{
+			const SplatView& view = views[s];
+			glm::vec3 e_tilda = view.inverse * (eye - view.center);
+			GLfloat distance = glm::length(e_tilda);
+			if (glm::dot(view.direction, e_tilda) < cos_tolerance * distance ||
+				std::fabs(distance - view.distance) > tolerance * distance)
+				stale.push_back((GLuint)s);
+		}
+	});
+
+	chosen.clear();
+	for (size_t task = 0; task < num_tasks; task++)
+		chosen.insert(chosen.end(), found[task].begin(), found[task].end());
+	num_stale = chosen.size();
+	if (num_stale * 2 >= count)
+	{
+		full_distance = std::min(full_distance, distance);
+		expand_all(store, splats, true);
+		return;
+	}
+	if (chosen.size() > SPLAT_REFRESH_BUDGET)
+	{
+		const glm::vec3 at = eye;
+		const std::vector<SplatView>& v = views;
+		std::nth_element(chosen.begin(), chosen.begin() + SPLAT_REFRESH_BUDGET, chosen.end(),
+			[&at, &v](GLuint a, GLuint b)
+		{
+			glm::vec3 to_a = v[a].center - at, to_b = v[b].center - at;
+			return glm::dot(to_a, to_a) < glm::dot(to_b, to_b);
+		});
+		chosen.resize(SPLAT_REFRESH_BUDGET);
+	}
+	num_expanded = chosen.size();
+	num_stale -= num_expanded;
+	if (chosen.empty())
+		return;
+
+	chosen_slots.resize(num_expanded);
+	for (size_t c = 0; c < num_expanded; c++)
+		chosen_slots[c] = splats.slots[chosen[c]];
+	if (chosen_vertices.size() < num_expanded * SPLAT_NUM_VERTICES)
+		chosen_vertices.resize(num_expanded * SPLAT_NUM_VERTICES);
+
+	const glm::vec3 shift = eye - origin;
+	num_tasks = (num_expanded + SPLAT_TASK_SIZE - 1) / SPLAT_TASK_SIZE;
+	pool.parallel_for(num_tasks, [&](size_t task)
+	{
+		size_t first = task * SPLAT_TASK_SIZE;
+		size_t n = std::min(num_expanded - first, (size_t)SPLAT_TASK_SIZE);
+		store.recalculate(&chosen_slots[first], n, eye, up,
+			&chosen_vertices[first * SPLAT_NUM_VERTICES]);
+		for (size_t c = first; c < first + n; c++)
+		{
+			size_t s = chosen[c];
+			TensorSplat_Vertex* out = &vertices[s * SPLAT_NUM_VERTICES];
+			const TensorSplat_Vertex* in = &chosen_vertices[c * SPLAT_NUM_VERTICES];
+			for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+			{
+				out[v] = in[v];
+				out[v].A_0 += shift;
+			}
+			look_from(views[s], eye);
+		}
+	});
+}
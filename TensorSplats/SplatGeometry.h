@@ -0,0 +1,167 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <vector>
+#include "TensorSplat.h"
+#include "ThreadPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define SPLAT_TASK_SIZE         1024
+#define SPLAT_VIEW_TOLERANCE    0.0f
+#define SPLAT_REFRESH_BUDGET    65536
+
+/******************************************************************************
+*                                                                             *
+*                                SplatView     (struct)                       *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  inverse                                                                    *
+*           Inverse of the splat's tensor, taking world space to the          *
+*           parameter space the quad is made in, where the splat is a unit    *
+*           sphere.                                                           *
+*  center                                                                     *
+*           World position of the splat.                                      *
+*  distance                                                                   *
+*           Distance from it, in parameter space, of the eye its quad was     *
+*           expanded for.                                                     *
+*  direction                                                                  *
+*           Unit direction from it to that eye, in parameter space.           *
+*                                                                             *
+*******************************************************************************/
+struct SplatView
+{
+
+	glm::mat3      inverse;
+	glm::vec3      center;
+	GLfloat        distance;
+	glm::vec3      direction;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                SplatGeometry     (class)                    *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  pool                                                                       *
+*           Threads the splats are expanded on.                               *
+*  vertices                                                                   *
+*           SPLAT_NUM_VERTICES vertices per splat drawn, in draw order, grown *
+*           to the largest frame.                                             *
+*  count                                                                      *
+*           Number of splats the vertices are for.                            *
+*  origin                                                                     *
+*           Point every A_0 in vertices is relative to.                       *
+*  eye, up                                                                    *
+*           Eye and up direction of the last update.                          *
+*  tolerance                                                                  *
+*           Largest change, in radians, in the direction of the eye from a    *
+*           splat in its parameter space, or relative change in their         *
+*           distance, before the splat's quad is expanded again; 0 expands    *
+*           every quad whenever the eye or up direction moves.                *
+*  expanded                                                                   *
+*           Whether vertices hold every splat of the last update, expanded    *
+*           with the current tolerance.                                       *
+*  views                                                                      *
+*           The eye each splat's quad was expanded for, as seen from the      *
+*           splat, while tolerance is set.                                    *
+*  found                                                                      *
+*           Indices of the splats each task found beyond tolerance.           *
+*  chosen                                                                     *
+*           Indices of the splats to be expanded again this update.           *
+*  chosen_slots, chosen_vertices                                              *
+*           Their slots, and their new vertices before they are put in place. *
+*  full_distance                                                              *
+*           Shortest distance of the eye from origin at which half the quads  *
+*           have been found due; an eye as far expands them all without       *
+*           testing.                                                          *
+*  num_stale                                                                  *
+*           Splats still beyond tolerance after the last update.              *
+*  num_expanded                                                               *
+*           Splats expanded by the last update.                               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The vertices the CPU expands the splats of a frame into. Each quad depends *
+*  smoothly on where the eye is, and not at all on the up direction but for   *
+*  its turn about the line of sight, so during a slow orbit most quads are    *
+*  nearly what they were last frame. With a tolerance, a quad is kept until   *
+*  the eye has turned more than that about its splat, measured in the space   *
+*  the quad is made in, since it was made; then it is expanded again, nearest *
+*  to the eye first and at most SPLAT_REFRESH_BUDGET a frame, so the work of  *
+*  a frame follows how fast the view changes. Once at least half the quads    *
+*  are due, all are expanded, as that costs no more, and so are they, without *
+*  testing any, whenever the eye is again as far from where every quad was    *
+*  last expanded. Quads made for different eyes can only share a buffer if    *
+*  their A_0 is not relative to the eye, so they are relative to origin,      *
+*  which the shader is given, instead; origin moves to the eye whenever every *
+*  quad is expanded. A_1 to A_3 of a kept quad stay those of the eye it was   *
+*  made for, an error within the tolerance.                                   *
+*                                                                             *
+*******************************************************************************/
+class SplatGeometry
+{
+
+public:
+
+	// Constructors.
+	explicit SplatGeometry(ThreadPool& pool);
+
+	// Bring the vertices up to date for the splats, eye and up direction.
+	// Every quad is expanded if the splats have changed since the last
+	// update; returns whether any vertex was changed.
+	bool update(const SplatStore& store, const Slice& splats, bool changed,
+		const glm::vec3& eye, const glm::vec3& up);
+
+	// Set the tolerance, in radians; every quad is expanded on the next
+	// update.
+	void set_tolerance(GLfloat radians);
+
+	// Getters.
+	const TensorSplat_Vertex* get_vertices() const {  return vertices.empty() ? NULL : &vertices[0];  }
+	size_t        vertex_count() const      {  return count * SPLAT_NUM_VERTICES;  }
+	const glm::vec3& get_origin() const     {  return origin;                 }
+	GLfloat       get_tolerance() const     {  return tolerance;              }
+	size_t        stale_count() const       {  return num_stale;              }
+	size_t        expanded_count() const    {  return num_expanded;           }
+
+private:
+
+	ThreadPool&                      pool;
+	std::vector<TensorSplat_Vertex>  vertices;
+	size_t                           count;
+	glm::vec3                        origin;
+	glm::vec3                        eye;
+	glm::vec3                        up;
+	GLfloat                          tolerance;
+	bool                             expanded;
+	std::vector<SplatView>           views;
+	std::vector<std::vector<GLuint> > found;
+	std::vector<GLuint>              chosen;
+	std::vector<GLuint>              chosen_slots;
+	std::vector<TensorSplat_Vertex>  chosen_vertices;
+	GLfloat                          full_distance;
+	size_t                           num_stale;
+	size_t                           num_expanded;
+
+	// Expand every quad for the eye, and make it the origin.
+	void expand_all(const SplatStore& store, const Slice& splats, bool same_splats);
+
+	// Expand again the quads the eye has moved too far from, nearest first.
+	void refresh(const SplatStore& store, const Slice& splats, GLfloat distance);
+
+	// Geometry is not copyable.
+	SplatGeometry(const SplatGeometry& other);
+	SplatGeometry& operator=(const SplatGeometry& other);
+
+};
@@ -0,0 +1,173 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "SplatKernel.h"
+#include <cmath>
+
+#ifdef SPLAT_KERNEL_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                        ScalarVector / Sse2Vector     (structs)              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The vector types expand_lanes is compiled for here: one lane in a float,   *
+*  and four in an SSE2 register, which every x86-64 processor has.            *
+*                                                                             *
+*******************************************************************************/
+namespace
+{
+
+	struct ScalarVector
+	{
+
+		enum { WIDTH = 1 };
+		GLfloat        v;
+
+		static ScalarVector make(GLfloat f)             { ScalarVector r = { f }; return r;  }
+		static ScalarVector broadcast(GLfloat f)        { return make(f);                    }
+		static ScalarVector load(const GLfloat* p)      { return make(*p);                   }
+		void store(GLfloat* p) const                    { *p = v;                            }
+
+	};
+
+	inline ScalarVector operator+(ScalarVector a, ScalarVector b)  { return ScalarVector::make(a.v + b.v);  }
+	inline ScalarVector operator-(ScalarVector a, ScalarVector b)  { return ScalarVector::make(a.v - b.v);  }
+	inline ScalarVector operator*(ScalarVector a, ScalarVector b)  { return ScalarVector::make(a.v * b.v);  }
+	inline ScalarVector operator/(ScalarVector a, ScalarVector b)  { return ScalarVector::make(a.v / b.v);  }
+	inline ScalarVector fma(ScalarVector a, ScalarVector b, ScalarVector c)
+	{
+		return ScalarVector::make((a.v * b.v) + c.v);
+	}
+	inline ScalarVector sqrt(ScalarVector a)
+	{
+		return ScalarVector::make(std::sqrt(a.v));
+	}
+
+#ifdef SPLAT_KERNEL_X86
+	struct Sse2Vector
+	{
+
+		enum { WIDTH = 4 };
+		__m128         v;
+
+		static Sse2Vector make(__m128 m)                { Sse2Vector r; r.v = m; return r;   }
+		static Sse2Vector broadcast(GLfloat f)          { return make(_mm_set1_ps(f));       }
+		static Sse2Vector load(const GLfloat* p)        { return make(_mm_loadu_ps(p));      }
+		void store(GLfloat* p) const                    { _mm_storeu_ps(p, v);               }
+
+	};
+
+	inline Sse2Vector operator+(Sse2Vector a, Sse2Vector b)  { return Sse2Vector::make(_mm_add_ps(a.v, b.v));  }
+	inline Sse2Vector operator-(Sse2Vector a, Sse2Vector b)  { return Sse2Vector::make(_mm_sub_ps(a.v, b.v));  }
+	inline Sse2Vector operator*(Sse2Vector a, Sse2Vector b)  { return Sse2Vector::make(_mm_mul_ps(a.v, b.v));  }
+	inline Sse2Vector operator/(Sse2Vector a, Sse2Vector b)  { return Sse2Vector::make(_mm_div_ps(a.v, b.v));  }
+	inline Sse2Vector fma(Sse2Vector a, Sse2Vector b, Sse2Vector c)
+	{
+		return Sse2Vector::make(_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v));
+	}
+	inline Sse2Vector sqrt(Sse2Vector a)
+	{
+		return Sse2Vector::make(_mm_sqrt_ps(a.v));
+	}
+#endif
+
+}
+
+// Chosen before main runs, so before any thread can expand.
+SplatKernel::Expander SplatKernel::expander = SplatKernel::widest();
+
+/******************************************************************************
+*                                                                             *
+*                   SplatKernel::expand_scalar / expand_sse2                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  expand_sse2 falls back to plain floats where there is no SSE2.             *
+*                                                                             *
+*******************************************************************************/
+void SplatKernel::expand_scalar(SplatLanes& lanes)
+{
+	expand_lanes<ScalarVector>(lanes);
+}
+void SplatKernel::expand_sse2(SplatLanes& lanes)
+{
+#ifdef SPLAT_KERNEL_X86
+	expand_lanes<Sse2Vector>(lanes);
+#else
+	expand_lanes<ScalarVector>(lanes);
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                            SplatKernel::widest                              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  expand_avx2 if the processor has AVX2 and FMA and the OS saves the AVX     *
+*  registers, else expand_sse2 on x86, else expand_scalar.                    *
+*                                                                             *
+*******************************************************************************/
+SplatKernel::Expander SplatKernel::widest()
+{
+#if !defined(SPLAT_KERNEL_X86)
+	return expand_scalar;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return expand_sse2;
+
+	// FMA, OSXSAVE and AVX, then the XMM and YMM state enabled by the OS.
+	__cpuid(info, 1);
+	const int features = (1 << 12) | (1 << 27) | (1 << 28);
+	if ((info[2] & features) != features || (_xgetbv(0) & 6) != 6)
+		return expand_sse2;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) ? expand_avx2 : expand_sse2;
+#else
+	__builtin_cpu_init();
+	return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ?
+		expand_avx2 : expand_sse2;
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                 SplatKernel::instruction_set / name / use                   *
+*                                                                             *
+*******************************************************************************/
+GLuint SplatKernel::instruction_set()
+{
+	return (expander == expand_avx2) ? SPLAT_KERNEL_AVX2 :
+		(expander == expand_sse2) ? SPLAT_KERNEL_SSE2 : SPLAT_KERNEL_SCALAR;
+}
+const char* SplatKernel::name()
+{
+	static const char* names[] = { "scalar", "SSE2", "AVX2" };
+	return names[instruction_set()];
+}
+bool SplatKernel::use(GLuint instruction_set)
+{
+	static const Expander expanders[] = { expand_scalar, expand_sse2, expand_avx2 };
+	Expander current = expander;
+	expander = widest();
+	if (instruction_set > SplatKernel::instruction_set())
+	{
+		expander = current;
+		return false;
+	}
+
+	expander = expanders[instruction_set];
+	return true;
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <GL\glew.h>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define SPLAT_KERNEL_LANES      8
+#define SPLAT_KERNEL_SCALAR     0
+#define SPLAT_KERNEL_SSE2       1
+#define SPLAT_KERNEL_AVX2       2
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SPLAT_KERNEL_X86
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                                SplatLanes     (struct)                      *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  e, up                                                                      *
+*           Position of the eye and up direction of the camera, shared by     *
+*           every lane.                                                       *
+*  c, T, T_inv, T_inv_sq                                                      *
+*           Position, tensor, inverse and squared inverse of each lane's      *
+*           splat; a matrix element [col][row] is held at col * 3 + row.      *
+*  A_0, A_3                                                                   *
+*           The A_0 and A_3 attributes of each lane's four vertices.          *
+*  mu                                                                         *
+*           Inverse distance from the eye in parameter space, the third       *
+*           component of every A_1.                                           *
+*  A_2                                                                        *
+*           The A_2 attribute, the same for all four vertices.                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  SPLAT_KERNEL_LANES splats with every component of every attribute in its   *
+*  own row, so that one vector register holds that component of several       *
+*  splats. The store gathers splats into it and scatters the results out to   *
+*  their vertices; the kernel only does the arithmetic.                       *
+*                                                                             *
+*******************************************************************************/
+struct SplatLanes
+{
+
+	GLfloat        e[3];
+	GLfloat        up[3];
+	GLfloat        c[3][SPLAT_KERNEL_LANES];
+	GLfloat        T[9][SPLAT_KERNEL_LANES];
+	GLfloat        T_inv[9][SPLAT_KERNEL_LANES];
+	GLfloat        T_inv_sq[9][SPLAT_KERNEL_LANES];
+	GLfloat        A_0[4][3][SPLAT_KERNEL_LANES];
+	GLfloat        mu[SPLAT_KERNEL_LANES];
+	GLfloat        A_2[3][SPLAT_KERNEL_LANES];
+	GLfloat        A_3[4][3][SPLAT_KERNEL_LANES];
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                SplatKernel     (class)                      *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  expander                                                                   *
+*           The form of expand in use: the widest the processor supports,     *
+*           chosen once at startup, unless use has picked another.            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  TensorSplat::recalculate for a whole lane block at a time. The arithmetic  *
+*  is written once, in expand_lanes, over a vector type, and compiled for     *
+*  plain floats, SSE2 (4 lanes) and AVX2 with FMA (8 lanes); the AVX2 form    *
+*  lives in its own file, the only one built for that instruction set, so     *
+*  nothing it compiles can be picked in place of a baseline copy.             *
+*                                                                             *
+*******************************************************************************/
+class SplatKernel
+{
+
+public:
+
+	// Fill the vertex attributes of every lane from its splat.
+	static void expand(SplatLanes& lanes)
+	{
+		expander(lanes);
+	}
+
+	// SPLAT_KERNEL_SCALAR, SPLAT_KERNEL_SSE2 or SPLAT_KERNEL_AVX2, and its
+	// name; the instruction set expand uses.
+	static GLuint instruction_set();
+	static const char* name();
+
+	// Have expand use a narrower instruction set, or the widest again;
+	// false if the processor lacks it. Not while another thread expands.
+	static bool use(GLuint instruction_set);
+
+	// Each form of expand, whether or not the processor supports it.
+	static void expand_scalar(SplatLanes& lanes);
+	static void expand_sse2(SplatLanes& lanes);
+	static void expand_avx2(SplatLanes& lanes);
+
+private:
+
+	typedef void (*Expander)(SplatLanes& lanes);
+	static Expander expander;
+
+	// The widest form of expand this processor and its OS support.
+	static Expander widest();
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                expand_lanes                                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  lanes                                                                      *
+*           The splats to expand.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The steps of TensorSplat::recalculate, Vector::WIDTH lanes at a time.      *
+*  Vector supplies load, store, broadcast, the four operators, fma (a * b +   *
+*  c) and sqrt. Static, so that each file compiling it gets its own copy for  *
+*  its own instruction set.                                                   *
+*                                                                             *
+*******************************************************************************/
+template <class Vector>
+static void expand_lanes(SplatLanes& lanes)
+{
+	const Vector zero = Vector::broadcast(0.0f), one = Vector::broadcast(1.0f);
+	const Vector scale = Vector::broadcast(2.0f);
+	Vector e[3], up[3];
+	for (GLuint i = 0; i < 3; i++)
+	{
+		e[i] = Vector::broadcast(lanes.e[i]);
+		up[i] = Vector::broadcast(lanes.up[i]);
+	}
+
+	for (GLuint lane = 0; lane < SPLAT_KERNEL_LANES; lane += Vector::WIDTH)
+	{
+		Vector c[3], T[9], T_inv[9], T_inv_sq[9];
+		for (GLuint i = 0; i < 3; i++)
+			c[i] = Vector::load(&lanes.c[i][lane]);
+		for (GLuint i = 0; i < 9; i++)
+		{
+			T[i] = Vector::load(&lanes.T[i][lane]);
+			T_inv[i] = Vector::load(&lanes.T_inv[i][lane]);
+			T_inv_sq[i] = Vector::load(&lanes.T_inv_sq[i][lane]);
+		}
+
+		// Calculate parameter-space variables.
+		Vector d[3] = { e[0] - c[0], e[1] - c[1], e[2] - c[2] };
+		Vector e_tilda[3], up_tilda[3];
+		for (GLuint r = 0; r < 3; r++)
+		{
+			e_tilda[r] = fma(T_inv[6 + r], d[2], fma(T_inv[3 + r], d[1], T_inv[r] * d[0]));
+			up_tilda[r] = fma(T_inv[6 + r], up[2], fma(T_inv[3 + r], up[1], T_inv[r] * up[0]));
+		}
+		Vector e_length = sqrt(fma(e_tilda[2], e_tilda[2],
+			fma(e_tilda[1], e_tilda[1], e_tilda[0] * e_tilda[0])));
+		Vector up_length = sqrt(fma(up_tilda[2], up_tilda[2],
+			fma(up_tilda[1], up_tilda[1], up_tilda[0] * up_tilda[0])));
+		Vector mu = one / e_length;
+		Vector z_hat[3], y_hat[3];
+		for (GLuint i = 0; i < 3; i++)
+		{
+			z_hat[i] = zero - (e_tilda[i] * mu);
+			y_hat[i] = up_tilda[i] / up_length;
+		}
+		Vector x_hat[3] =
+		{
+			(z_hat[1] * y_hat[2]) - (z_hat[2] * y_hat[1]),
+			(z_hat[2] * y_hat[0]) - (z_hat[0] * y_hat[2]),
+			(z_hat[0] * y_hat[1]) - (z_hat[1] * y_hat[0]),
+		};
+		Vector x_length = sqrt(fma(x_hat[2], x_hat[2],
+			fma(x_hat[1], x_hat[1], x_hat[0] * x_hat[0])));
+		Vector mu_squared = mu * mu;
+		Vector r_scaled = sqrt(one - mu_squared) * scale;
+		Vector x_scale = r_scaled / x_length;
+
+		// Calculate world-space variables, relative to the eye.
+		Vector m_e[3], x[3], y[3];
+		for (GLuint r = 0; r < 3; r++)
+		{
+			Vector m = fma(T[6 + r], e_tilda[2], fma(T[3 + r], e_tilda[1], T[r] * e_tilda[0]));
+			m_e[r] = fma(m, mu_squared, c[r]) - e[r];
+			x[r] = fma(T[6 + r], x_hat[2], fma(T[3 + r], x_hat[1], T[r] * x_hat[0])) * x_scale;
+			y[r] = fma(T[6 + r], y_hat[2], fma(T[3 + r], y_hat[1], T[r] * y_hat[0])) * r_scaled;
+		}
+
+		// A_2 is the same for every vertex, and A_3 is linear in the offset
+		// from m, so each is found from its center and its axes.
+		Vector sq_m[3], sq_x[3], sq_y[3];
+		for (GLuint r = 0; r < 3; r++)
+		{
+			Vector a_2 = fma(T_inv_sq[6 + r], d[2],
+				fma(T_inv_sq[3 + r], d[1], T_inv_sq[r] * d[0]));
+			a_2.store(&lanes.A_2[r][lane]);
+			sq_m[r] = fma(T_inv_sq[6 + r], m_e[2], fma(T_inv_sq[3 + r], m_e[1], T_inv_sq[r] * m_e[0]));
+			sq_x[r] = fma(T_inv_sq[6 + r], x[2], fma(T_inv_sq[3 + r], x[1], T_inv_sq[r] * x[0]));
+			sq_y[r] = fma(T_inv_sq[6 + r], y[2], fma(T_inv_sq[3 + r], y[1], T_inv_sq[r] * y[0]));
+		}
+
+		mu.store(&lanes.mu[lane]);
+		for (GLuint r = 0; r < 3; r++)
+		{
+			Vector a_0_sum = x[r] + y[r], a_0_difference = x[r] - y[r];
+			(m_e[r] + a_0_sum).store(&lanes.A_0[0][r][lane]);
+			(m_e[r] + a_0_difference).store(&lanes.A_0[1][r][lane]);
+			(m_e[r] - a_0_sum).store(&lanes.A_0[2][r][lane]);
+			(m_e[r] - a_0_difference).store(&lanes.A_0[3][r][lane]);
+
+			Vector a_3_sum = sq_x[r] + sq_y[r], a_3_difference = sq_x[r] - sq_y[r];
+			(sq_m[r] + a_3_sum).store(&lanes.A_3[0][r][lane]);
+			(sq_m[r] + a_3_difference).store(&lanes.A_3[1][r][lane]);
+			(sq_m[r] - a_3_sum).store(&lanes.A_3[2][r][lane]);
+			(sq_m[r] - a_3_difference).store(&lanes.A_3[3][r][lane]);
+		}
+	}
+}
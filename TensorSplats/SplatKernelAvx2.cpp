@@ -0,0 +1,77 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+// Only this file is built for AVX2: by /arch:AVX2 in the project, or by this
+// pragma for GCC and Clang.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#pragma GCC target("avx2,fma")
+#endif
+
+#include "SplatKernel.h"
+
+#ifdef SPLAT_KERNEL_X86
+#include <immintrin.h>
+
+/******************************************************************************
+*                                                                             *
+*                               Avx2Vector     (struct)                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Eight lanes in an AVX register, with fused multiply-adds.                  *
+*                                                                             *
+*******************************************************************************/
+namespace
+{
+
+	struct Avx2Vector
+	{
+
+		enum { WIDTH = 8 };
+		__m256         v;
+
+		static Avx2Vector make(__m256 m)                { Avx2Vector r; r.v = m; return r;   }
+		static Avx2Vector broadcast(GLfloat f)          { return make(_mm256_set1_ps(f));    }
+		static Avx2Vector load(const GLfloat* p)        { return make(_mm256_loadu_ps(p));   }
+		void store(GLfloat* p) const                    { _mm256_storeu_ps(p, v);            }
+
+	};
+
+	inline Avx2Vector operator+(Avx2Vector a, Avx2Vector b)  { return Avx2Vector::make(_mm256_add_ps(a.v, b.v));  }
+	inline Avx2Vector operator-(Avx2Vector a, Avx2Vector b)  { return Avx2Vector::make(_mm256_sub_ps(a.v, b.v));  }
+	inline Avx2Vector operator*(Avx2Vector a, Avx2Vector b)  { return Avx2Vector::make(_mm256_mul_ps(a.v, b.v));  }
+	inline Avx2Vector operator/(Avx2Vector a, Avx2Vector b)  { return Avx2Vector::make(_mm256_div_ps(a.v, b.v));  }
+	inline Avx2Vector fma(Avx2Vector a, Avx2Vector b, Avx2Vector c)
+	{
+		return Avx2Vector::make(_mm256_fmadd_ps(a.v, b.v, c.v));
+	}
+	inline Avx2Vector sqrt(Avx2Vector a)
+	{
+		return Avx2Vector::make(_mm256_sqrt_ps(a.v));
+	}
+
+}
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                           SplatKernel::expand_avx2                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Runs only once SplatKernel::widest has found AVX2 and FMA. This file       *
+*  includes nothing with inline functions but the kernel, so no AVX2 copy of  *
+*  a function shared with the rest of the program can be linked in place of   *
+*  its baseline one. Falls back to expand_sse2 off x86.                       *
+*                                                                             *
+*******************************************************************************/
+void SplatKernel::expand_avx2(SplatLanes& lanes)
+{
+#ifdef SPLAT_KERNEL_X86
+	expand_lanes<Avx2Vector>(lanes);
+#else
+	expand_sse2(lanes);
+#endif
+}
@@ -0,0 +1,915 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "SplatStore.h"
+#include "TensorSplat.h"
+#include "Morton.h"
+#include "SplatKernel.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <utility>
+
+// Identities handed out so far, to every store.
+std::atomic<uint64_t> SplatStore::ids(0);
+
+// Empty a vector and give its memory back.
+template <typename T, typename A>
+static void release(std::vector<T, A>& v)
+{
+	std::vector<T, A>().swap(v);
+}
+
+// Fill a vector with another's elements at the slots of order, in turn, or
+// replace a vector's elements with its own.
+template <typename T, typename A>
+static void gather(const std::vector<T, A>& from,
+	const std::vector<std::pair<uint64_t, GLuint> >& order, std::vector<T, A>& to)
+{
+	to.clear();
+	if (from.empty())
+		return;
+
+	to.reserve(order.size());
+	for (size_t n = 0; n < order.size(); n++)
+		to.push_back(from[order[n].second]);
+}
+template <typename T, typename A>
+static void gather(std::vector<T, A>& v, const std::vector<std::pair<uint64_t, GLuint> >& order)
+{
+	std::vector<T, A> gathered;
+	gather(v, order, gathered);
+	v.swap(gathered);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::SplatStore                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  x, y, z                                                                    *
+*           Size of the field the splats belong to.                           *
+*  indexed                                                                    *
+*           Whether to keep the voxel-to-slot index.                          *
+*                                                                             *
+*******************************************************************************/
+SplatStore::SplatStore(GLuint x, GLuint y, GLuint z, bool indexed) :
+compacted(false), x_size(x), y_size(y), z_size(z), indexed(indexed),
+sliced(false), ranked(false), layout(NO_LAYOUT), id(++ids), revised(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::set_compact                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  voxel_to_world                                                             *
+*           Transform from voxel index (i, j, k, 1) to world position, the    *
+*           one the loader placed the samples with.                           *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::set_compact(const glm::mat4& voxel_to_world)
+{
+	revised++;
+	compacted = true;
+	this->voxel_to_world = voxel_to_world;
+}
+
+/******************************************************************************
+*                                                                             *
+*                               SplatStore::add                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  sample                                                                     *
+*           A significant voxel produced by a loader or read from disk.       *
+*  inverse                                                                    *
+*           The sample's inverses from invert, or NULL to compute them here.  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The slot now holding the sample's splat.                                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Copies the sample's attributes into a slot: the one its voxel already      *
+*  has, a free one, or a new one at the end of the arrays. A compact store    *
+*  encodes the tensor and coefficients instead, and keeps no position or      *
+*  color, since both follow from the voxel and the coefficients.              *
+*                                                                             *
+*******************************************************************************/
+GLuint SplatStore::add(const TensorSample& sample, const SplatInverse* inverse)
+{
+	GLuint voxel = (GLuint)(sample.i + ((size_t)x_size * (sample.j + ((size_t)y_size * sample.k))));
+	revised++;
+	layout = NO_LAYOUT;
+
+	if (indexed && index.empty())
+	{
+		index.assign((size_t)x_size * y_size * z_size, NO_SLOT);
+		occupied.assign(index.size());
+	}
+
+	GLuint slot = indexed ? index[voxel] : NO_SLOT;
+	if (slot == NO_SLOT && !free_slots.empty())
+	{
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	if (slot == NO_SLOT)
+	{
+		slot = (GLuint)voxels.size();
+		voxels.push_back(FREE_VOXEL);
+		if (compacted)
+			compact.push_back(CompactSplat());
+		else
+		{
+			positions.push_back(glm::vec3());
+			tensors.push_back(glm::mat3());
+			inverses.push_back(glm::mat3());
+			inverse_squares.push_back(SymMatrix3());
+			colors.push_back(glm::vec4());
+			c[SPHERICAL].push_back(0);
+			c[LINEAR].push_back(0);
+			c[PLANAR].push_back(0);
+		}
+	}
+
+	if (compacted)
+		compact[slot] = compact_encode(sample.matrix, sample.c);
+	else
+	{
+		positions[slot] = glm::vec3(sample.position);
+		tensors[slot] = sample.matrix;
+		SplatInverse computed;
+		if (inverse == NULL)
+		{
+			invert(&sample, 1, &computed);
+			inverse = &computed;
+		}
+		inverses[slot] = inverse->inverse;
+		inverse_squares[slot] = inverse->inverse_square;
+		colors[slot] = sample.color;
+		c[SPHERICAL][slot] = sample.c[SPHERICAL];
+		c[LINEAR][slot] = sample.c[LINEAR];
+		c[PLANAR][slot] = sample.c[PLANAR];
+	}
+	voxels[slot] = voxel;
+	if (indexed)
+	{
+		index[voxel] = slot;
+		occupied.set(voxel);
+	}
+	sliced = false;
+	ranked = false;
+	return slot;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatStore::invert                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  samples                                                                    *
+*           The samples about to be added.                                    *
+*  count                                                                      *
+*           Number of samples.                                                *
+*  inverses                                                                   *
+*           Receives the inverses of each sample, to pass to add.             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Inverts the tensors of a slab of samples, spreading batches of them over   *
+*  the shared pool. Loaders call this on their own thread before handing the  *
+*  slab over, so the thread adding the samples to a store does no inverting.  *
+*  A single sample is inverted in place, without going through the pool.      *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::invert(const TensorSample* samples, size_t count, SplatInverse* inverses)
+{
+	auto invert_batch = [=](size_t batch)
+	{
+		size_t first = batch * SPLAT_INVERT_BATCH;
+		size_t last = std::min(first + SPLAT_INVERT_BATCH, count);
+		for (size_t s = first; s < last; s++)
+		{
+			glm::mat3 inverse = glm::inverse(samples[s].matrix);
+			inverses[s].inverse = inverse;
+			inverses[s].inverse_square = SymMatrix3::pack(inverse * inverse);
+		}
+	};
+
+	size_t num_batches = (count + SPLAT_INVERT_BATCH - 1) / SPLAT_INVERT_BATCH;
+	if (num_batches == 1)
+		invert_batch(0);
+	else if (num_batches > 1)
+		ThreadPool::shared().parallel_for(num_batches, invert_batch);
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatStore::remove                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slot                                                                       *
+*           A slot returned by add, and not removed since.                    *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::remove(GLuint slot)
+{
+	revised++;
+	layout = NO_LAYOUT;
+	if (indexed)
+	{
+		index[voxels[slot]] = NO_SLOT;
+		occupied.reset(voxels[slot]);
+	}
+	voxels[slot] = FREE_VOXEL;
+	free_slots.push_back(slot);
+	sliced = false;
+	ranked = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatStore::clear                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Frees the arrays, the index and the occupancy mask.                        *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::clear()
+{
+	revised++;
+	layout = NO_LAYOUT;
+	release(positions);
+	release(tensors);
+	release(inverses);
+	release(inverse_squares);
+	release(colors);
+	release(c[SPHERICAL]);
+	release(c[LINEAR]);
+	release(c[PLANAR]);
+	release(compact);
+	release(voxels);
+	release(index);
+	occupied.clear();
+	release(free_slots);
+	for (GLuint axis = 0; axis < 3; axis++)
+	{
+		release(slice_order[axis]);
+		release(slice_start[axis]);
+		release(metric_order[axis]);
+	}
+	sliced = false;
+	ranked = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatStore::swap                               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Exchanges everything but the arrays' memory, which changes owner without   *
+*  being copied.                                                              *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::swap(SplatStore& other)
+{
+	positions.swap(other.positions);
+	tensors.swap(other.tensors);
+	inverses.swap(other.inverses);
+	inverse_squares.swap(other.inverse_squares);
+	colors.swap(other.colors);
+	for (GLuint m = 0; m < 3; m++)
+		c[m].swap(other.c[m]);
+	voxels.swap(other.voxels);
+	compact.swap(other.compact);
+	std::swap(compacted, other.compacted);
+	std::swap(voxel_to_world, other.voxel_to_world);
+	std::swap(x_size, other.x_size);
+	std::swap(y_size, other.y_size);
+	std::swap(z_size, other.z_size);
+	std::swap(indexed, other.indexed);
+	index.swap(other.index);
+	occupied.swap(other.occupied);
+	free_slots.swap(other.free_slots);
+	for (GLuint axis = 0; axis < 3; axis++)
+	{
+		slice_order[axis].swap(other.slice_order[axis]);
+		slice_start[axis].swap(other.slice_start[axis]);
+		metric_order[axis].swap(other.metric_order[axis]);
+	}
+	std::swap(sliced, other.sliced);
+	std::swap(ranked, other.ranked);
+	std::swap(layout, other.layout);
+	std::swap(id, other.id);
+	std::swap(revised, other.revised);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SplatStore::prepare                             *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::prepare()
+{
+	if (!sliced)
+		sort_slices();
+	if (!ranked)
+		sort_metrics();
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SplatStore::sample                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slot                                                                       *
+*           A slot in use.                                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A sample that add() would turn back into the same splat, so a new store    *
+*  can be derived from some or all of this one's.                             *
+*                                                                             *
+*******************************************************************************/
+TensorSample SplatStore::sample(GLuint slot) const
+{
+	size_t voxel = voxels[slot];
+	TensorSample sample;
+	sample.i = (GLuint)(voxel % x_size);
+	sample.j = (GLuint)((voxel / x_size) % y_size);
+	sample.k = (GLuint)(voxel / ((size_t)x_size * y_size));
+	sample.position = glm::vec4(position(slot), 0.0f);
+	sample.color = compacted ? compact_color(compact[slot]) : colors[slot];
+	sample.matrix = compacted ? compact_tensor(compact[slot]) : tensors[slot];
+	for (GLuint m = 0; m < 3; m++)
+		sample.c[m] = coefficient(m, slot);
+	return sample;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::sort_morton                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Loaders add splats in scan order, so neighbours along y and z end up a     *
+*  whole row or slice apart. This sorts the live slots by the Morton code of  *
+*  their voxels and gathers every attribute array into that order, so a       *
+*  neighbourhood along any axis sits in a few cache lines and pages. The      *
+*  index and the slice and metric orders are remapped to the new slots.       *
+*                                                                             *
+*  Morton order trades the view planes against each other. Scan order keeps   *
+*  an axial slice contiguous but touches a new line for every splat of a      *
+*  sagittal one, so the plane being viewed decides the frame time several     *
+*  times over; in Morton order the three cost about the same, at the price of *
+*  the axial view. --bench-layout times each plane both ways. A field viewed  *
+*  a plane at a time is laid out along that plane instead (see sort_layout).  *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::sort_morton()
+{
+	revised++;
+	layout = MORTON_LAYOUT;
+	std::vector<std::pair<uint64_t, GLuint> > order;
+	layout_order(order, MORTON_LAYOUT);
+
+	gather(positions, order);
+	gather(tensors, order);
+	gather(inverses, order);
+	gather(inverse_squares, order);
+	gather(colors, order);
+	gather(c[SPHERICAL], order);
+	gather(c[LINEAR], order);
+	gather(c[PLANAR], order);
+	gather(compact, order);
+	gather(voxels, order);
+	release(free_slots);
+
+	if (!index.empty())
+		for (GLuint slot = 0; slot < voxels.size(); slot++)
+			index[voxels[slot]] = slot;
+	sliced = false;
+	ranked = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::sort_layout                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  from                                                                       *
+*           The store to copy the splats of; it is only read.                 *
+*  layout                                                                     *
+*           AXIAL, SAGITTAL or CORONAL to put each slice along that axis in   *
+*           a run of consecutive slots, or MORTON_LAYOUT.                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Fills an empty store with another's splats in the given order. Since the   *
+*  other is not changed, it may go on being drawn meanwhile, which is how a   *
+*  published version is relaid out for the view while the old one is drawn.   *
+*  A slice layout makes that view's sweeps contiguous, and the other planes'  *
+*  strided, so it only pays while one plane is being viewed.                  *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::sort_layout(const SplatStore& from, GLuint layout)
+{
+	revised++;
+	this->layout = layout;
+	std::vector<std::pair<uint64_t, GLuint> > order;
+	from.layout_order(order, layout);
+
+	gather(from.positions, order, positions);
+	gather(from.tensors, order, tensors);
+	gather(from.inverses, order, inverses);
+	gather(from.inverse_squares, order, inverse_squares);
+	gather(from.colors, order, colors);
+	for (GLuint m = 0; m < 3; m++)
+		gather(from.c[m], order, c[m]);
+	gather(from.compact, order, compact);
+	gather(from.voxels, order, voxels);
+	release(free_slots);
+	compacted = from.compacted;
+	voxel_to_world = from.voxel_to_world;
+	x_size = from.x_size;
+	y_size = from.y_size;
+	z_size = from.z_size;
+	indexed = from.indexed;
+
+	index.clear();
+	occupied.clear();
+	if (!from.index.empty())
+	{
+		index.assign(from.index.size(), NO_SLOT);
+		occupied.assign(index.size());
+		for (GLuint slot = 0; slot < voxels.size(); slot++)
+		{
+			index[voxels[slot]] = slot;
+			occupied.set(voxels[slot]);
+		}
+	}
+	sliced = false;
+	ranked = false;
+}
+
+// The live slots, each with the key of its voxel in a layout, in that order.
+// Slice layouts key by the slice, then as get_slice orders the slice.
+void SplatStore::layout_order(std::vector<std::pair<uint64_t, GLuint> >& order,
+	GLuint layout) const
+{
+	order.reserve(count());
+	for (GLuint slot = 0; slot < voxels.size(); slot++)
+	{
+		GLuint voxel = voxels[slot];
+		if (voxel == FREE_VOXEL)
+			continue;
+		GLuint i = (GLuint)(voxel % x_size);
+		GLuint j = (GLuint)((voxel / x_size) % y_size);
+		GLuint k = (GLuint)(voxel / ((size_t)x_size * y_size));
+		uint64_t key = (layout == AXIAL) ? voxel :
+			(layout == SAGITTAL) ? ((((uint64_t)i * z_size) + k) * y_size) + j :
+			(layout == CORONAL) ? ((((uint64_t)j * x_size) + i) * z_size) + k :
+			morton_encode(i, j, k);
+		order.push_back(std::make_pair(key, slot));
+	}
+	std::sort(order.begin(), order.end());
+}
+
+/******************************************************************************
+*                                                                             *
+*                            SplatStore::get_slice                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  axis                                                                       *
+*           AXIAL, SAGITTAL or CORONAL.                                       *
+*  n                                                                          *
+*           Index of the slice along that axis.                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The slots of the slice, in draw order.                                     *
+*                                                                             *
+*******************************************************************************/
+Slice SplatStore::get_slice(GLuint axis, GLuint n)
+{
+	if (!sliced)
+		sort_slices();
+	return static_cast<const SplatStore*>(this)->get_slice(axis, n);
+}
+Slice SplatStore::get_slice(GLuint axis, GLuint n) const
+{
+	Slice slice = { NULL, 0 };
+	const std::vector<GLuint>& start = slice_start[axis];
+	if (n + 1 < start.size() && start[n] < start[n + 1])
+	{
+		slice.slots = &slice_order[axis][start[n]];
+		slice.count = start[n + 1] - start[n];
+	}
+	return slice;
+}
+Slice SplatStore::get_all()
+{
+	if (!sliced)
+		sort_slices();
+	return static_cast<const SplatStore*>(this)->get_all();
+}
+Slice SplatStore::get_all() const
+{
+	Slice all = { NULL, 0 };
+	if (!slice_order[AXIAL].empty())
+	{
+		all.slots = &slice_order[AXIAL][0];
+		all.count = slice_order[AXIAL].size();
+	}
+	return all;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            SplatStore::get_above                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  metric                                                                     *
+*           SPHERICAL, LINEAR or PLANAR.                                      *
+*  threshold                                                                  *
+*           Smallest coefficient to include.                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The slots at or above the threshold: a suffix of the metric's order, so    *
+*  any threshold costs one binary search.                                     *
+*                                                                             *
+*******************************************************************************/
+Slice SplatStore::get_above(GLuint metric, GLfloat threshold)
+{
+	if (!ranked)
+		sort_metrics();
+	return static_cast<const SplatStore*>(this)->get_above(metric, threshold);
+}
+Slice SplatStore::get_above(GLuint metric, GLfloat threshold) const
+{
+	const std::vector<GLuint>& order = metric_order[metric];
+	std::vector<GLuint>::const_iterator first = std::lower_bound(order.begin(),
+		order.end(), threshold, [&](GLuint slot, GLfloat t) { return coefficient(metric, slot) < t; });
+
+	Slice above = { NULL, 0 };
+	if (first != order.end())
+	{
+		above.slots = &*first;
+		above.count = order.end() - first;
+	}
+	return above;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::sort_slices                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Walks the occupied voxels once per axis, slice by slice, recording each    *
+*  one's slot and where each slice starts. Within a slice, axial views run    *
+*  along x then y, coronal views along z then x, and sagittal views along y   *
+*  then z, the order splats have always been drawn in. The axial walk scans   *
+*  the occupancy mask a word at a time and notes which rows of x are empty;   *
+*  the other two skip those rows and test the mask rather than the index, so  *
+*  background costs a bit per voxel at most instead of an index entry.        *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::sort_slices()
+{
+	for (GLuint axis = 0; axis < 3; axis++)
+	{
+		slice_order[axis].clear();
+		slice_order[axis].reserve(count());
+		slice_start[axis].clear();
+	}
+	sliced = true;
+	if (index.empty())
+		return;
+
+	// Row (j, k) of x is at row + i, and is occupied if row_used[j + y * k].
+	size_t row, voxel;
+	std::vector<char> row_used((size_t)y_size * z_size, 0);
+
+	std::vector<GLuint>& axial = slice_order[AXIAL];
+	for (GLuint k = 0; k < z_size; k++)
+	{
+		slice_start[AXIAL].push_back((GLuint)axial.size());
+		for (GLuint j = 0; j < y_size; j++)
+		{
+			row = (size_t)x_size * (j + ((size_t)y_size * k));
+			size_t before = axial.size();
+			for (GLuint i = 0; i < x_size; i += OCCUPANCY_WORD_BITS)
+			{
+				uint64_t word = occupied.word(row + i);
+				if (x_size - i < OCCUPANCY_WORD_BITS)
+					word &= ~BITS_FROM(x_size - i);
+				for (; word != 0; word &= word - 1)
+					axial.push_back(index[row + i + lowest_bit64(word)]);
+			}
+			row_used[j + ((size_t)y_size * k)] = (axial.size() > before);
+		}
+	}
+	slice_start[AXIAL].push_back((GLuint)axial.size());
+
+	std::vector<GLuint>& coronal = slice_order[CORONAL];
+	for (GLuint j = 0; j < y_size; j++)
+	{
+		slice_start[CORONAL].push_back((GLuint)coronal.size());
+		for (GLuint i = 0; i < x_size; i++)
+		for (GLuint k = 0; k < z_size; k++)
+		{
+			if (!row_used[j + ((size_t)y_size * k)])
+				continue;
+			voxel = i + ((size_t)x_size * (j + ((size_t)y_size * k)));
+			if (occupied.test(voxel))
+				coronal.push_back(index[voxel]);
+		}
+	}
+	slice_start[CORONAL].push_back((GLuint)coronal.size());
+
+	std::vector<GLuint>& sagittal = slice_order[SAGITTAL];
+	for (GLuint i = 0; i < x_size; i++)
+	{
+		slice_start[SAGITTAL].push_back((GLuint)sagittal.size());
+		for (GLuint k = 0; k < z_size; k++)
+		for (GLuint j = 0; j < y_size; j++)
+		{
+			if (!row_used[j + ((size_t)y_size * k)])
+				continue;
+			voxel = i + ((size_t)x_size * (j + ((size_t)y_size * k)));
+			if (occupied.test(voxel))
+				sagittal.push_back(index[voxel]);
+		}
+	}
+	slice_start[SAGITTAL].push_back((GLuint)sagittal.size());
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::find_in_box                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  lo                                                                         *
+*           Voxel at the low corner of the box.                               *
+*  hi                                                                         *
+*           Voxel just past the high corner, clamped to the field.            *
+*  slots                                                                      *
+*           Receives the slots of the occupied voxels in the box.             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Scans each row of the box through the occupancy mask, so an empty row      *
+*  costs a word or two of bits however long it is.                            *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::find_in_box(const glm::uvec3& lo, const glm::uvec3& hi,
+	std::vector<GLuint>& slots) const
+{
+	if (index.empty())
+		return;
+
+	GLuint i_end = std::min(hi.x, x_size);
+	GLuint j_end = std::min(hi.y, y_size);
+	GLuint k_end = std::min(hi.z, z_size);
+	if (lo.x >= i_end)
+		return;
+
+	for (GLuint k = lo.z; k < k_end; k++)
+	for (GLuint j = lo.y; j < j_end; j++)
+	{
+		size_t row = (size_t)x_size * (j + ((size_t)y_size * k));
+		for (size_t voxel = occupied.next(row + lo.x, row + i_end); voxel != NO_VOXEL;
+			voxel = occupied.next(voxel + 1, row + i_end))
+			slots.push_back(index[voxel]);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SplatStore::recalculate                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slot                                                                       *
+*           The slot to update.                                               *
+*  e                                                                          *
+*           Position of the eye.                                              *
+*  up                                                                         *
+*           Up direction of the camera.                                       *
+*  vertices                                                                   *
+*           Receives the vertices, colored with the slot's color.             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Radius of the splat's silhouette in parameter space.                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A compact slot is decoded on the way, so its splat is drawn from the       *
+*  quantized tensor and coefficients, and its tensor is inverted here rather  *
+*  than stored inverted.                                                      *
+*                                                                             *
+*******************************************************************************/
+GLfloat SplatStore::recalculate(GLuint slot, const glm::vec3& e, const glm::vec3& up,
+	TensorSplat_Vertex* vertices) const
+{
+	if (compacted)
+	{
+		GLfloat r = TensorSplat::recalculate(voxel_position(voxels[slot]),
+			compact_tensor(compact[slot]), e, up, vertices);
+		glm::vec4 color = compact_color(compact[slot]);
+		for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+			vertices[v].color = color;
+		return r;
+	}
+
+	GLfloat r = TensorSplat::recalculate(positions[slot], tensors[slot], inverses[slot],
+		inverse_squares[slot].unpack(), e, up, vertices);
+	for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+		vertices[v].color = colors[slot];
+	return r;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      SplatStore::recalculate (batch)                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slots                                                                      *
+*           The slots to update.                                              *
+*  count                                                                      *
+*           How many there are.                                               *
+*  e                                                                          *
+*           Position of the eye.                                              *
+*  up                                                                         *
+*           Up direction of the camera.                                       *
+*  vertices                                                                   *
+*           Receives SPLAT_NUM_VERTICES vertices for each slot, in turn.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gathers SPLAT_KERNEL_LANES slots at a time into a SplatLanes block, has    *
+*  SplatKernel expand them all at once, and scatters the results out to their *
+*  vertices. A short last block repeats its last slot to fill its lanes, and  *
+*  only its own slots are written. A compact store has no inverses to gather, *
+*  so expands its slots one at a time.                                        *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::recalculate(const GLuint* slots, size_t count, const glm::vec3& e,
+	const glm::vec3& up, TensorSplat_Vertex* vertices) const
+{
+	if (compacted)
+	{
+		for (size_t s = 0; s < count; s++)
+			recalculate(slots[s], e, up, &vertices[s * SPLAT_NUM_VERTICES]);
+		return;
+	}
+
+	static const GLfloat corners[SPLAT_NUM_VERTICES][2] =
+	{
+		{ +1.0f, +1.0f }, { +1.0f, -1.0f }, { -1.0f, -1.0f }, { -1.0f, +1.0f },
+	};
+
+	SplatLanes lanes;
+	for (GLuint i = 0; i < 3; i++)
+	{
+		lanes.e[i] = e[i];
+		lanes.up[i] = up[i];
+	}
+
+	for (size_t first = 0; first < count; first += SPLAT_KERNEL_LANES)
+	{
+		size_t n = std::min(count - first, (size_t)SPLAT_KERNEL_LANES);
+		for (GLuint lane = 0; lane < SPLAT_KERNEL_LANES; lane++)
+		{
+			GLuint slot = slots[first + std::min((size_t)lane, n - 1)];
+			const GLfloat* T = &tensors[slot][0][0];
+			const GLfloat* T_inv = &inverses[slot][0][0];
+			const SymMatrix3& T_inv_sq = inverse_squares[slot];
+			for (GLuint i = 0; i < 3; i++)
+				lanes.c[i][lane] = positions[slot][i];
+			for (GLuint i = 0; i < 9; i++)
+			{
+				lanes.T[i][lane] = T[i];
+				lanes.T_inv[i][lane] = T_inv[i];
+				lanes.T_inv_sq[i][lane] = T_inv_sq.entry(i);
+			}
+		}
+
+		SplatKernel::expand(lanes);
+
+		for (GLuint lane = 0; lane < n; lane++)
+		{
+			TensorSplat_Vertex* splat = &vertices[(first + lane) * SPLAT_NUM_VERTICES];
+			const glm::vec4& color = colors[slots[first + lane]];
+			glm::vec3 A_2(lanes.A_2[0][lane], lanes.A_2[1][lane], lanes.A_2[2][lane]);
+			for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+			{
+				splat[v].A_0 = glm::vec3(lanes.A_0[v][0][lane], lanes.A_0[v][1][lane],
+					lanes.A_0[v][2][lane]);
+				splat[v].A_1 = glm::vec3(corners[v][0], corners[v][1], lanes.mu[lane]);
+				splat[v].A_2 = A_2;
+				splat[v].A_3 = glm::vec3(lanes.A_3[v][0][lane], lanes.A_3[v][1][lane],
+					lanes.A_3[v][2][lane]);
+				splat[v].color = color;
+			}
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          SplatStore::get_instances                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slots                                                                      *
+*           The slots to copy.                                                *
+*  count                                                                      *
+*           How many there are.                                               *
+*  instances                                                                  *
+*           Receives one instance for each slot, in turn.                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A compact slot is decoded and its tensor inverted on the way.              *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::get_instances(const GLuint* slots, size_t count,
+	TensorSplat_Instance* instances) const
+{
+	for (size_t s = 0; s < count; s++)
+	{
+		GLuint slot = slots[s];
+		TensorSplat_Instance& instance = instances[s];
+		if (compacted)
+		{
+			instance.center = voxel_position(voxels[slot]);
+			instance.tensor = compact_tensor(compact[slot]);
+			instance.tensor_inv = glm::inverse(instance.tensor);
+			instance.tensor_inv_sq = instance.tensor_inv * instance.tensor_inv;
+			instance.color = compact_color(compact[slot]);
+			continue;
+		}
+
+		instance.center = positions[slot];
+		instance.tensor = tensors[slot];
+		instance.tensor_inv = inverses[slot];
+		instance.tensor_inv_sq = inverse_squares[slot].unpack();
+		instance.color = colors[slot];
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          SplatStore::voxel_position                         *
+*                                                                             *
+*******************************************************************************/
+glm::vec3 SplatStore::voxel_position(size_t voxel) const
+{
+	GLfloat i = (GLfloat)(voxel % x_size);
+	GLfloat j = (GLfloat)((voxel / x_size) % y_size);
+	GLfloat k = (GLfloat)(voxel / ((size_t)x_size * y_size));
+	return glm::vec3(voxel_to_world * glm::vec4(i, j, k, 1.0f));
+}
+
+/******************************************************************************
+*                                                                             *
+*                          SplatStore::sort_metrics                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sorts the axial order by each coefficient in turn. The sort is stable, so  *
+*  splats of equal coefficient keep their axial order.                        *
+*                                                                             *
+*******************************************************************************/
+void SplatStore::sort_metrics()
+{
+	Slice all = get_all();
+	for (GLuint metric = 0; metric < 3; metric++)
+	{
+		metric_order[metric].assign(all.slots, all.slots + all.count);
+		std::stable_sort(metric_order[metric].begin(), metric_order[metric].end(),
+			[&](GLuint a, GLuint b) { return coefficient(metric, a) < coefficient(metric, b); });
+	}
+	ranked = true;
+}
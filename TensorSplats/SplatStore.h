@@ -0,0 +1,344 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <stdint.h>
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+#include "AlignedAllocator.h"
+#include "OccupancyMask.h"
+#include "CompactSplat.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define NO_SLOT                 0xFFFFFFFFu
+#define FREE_VOXEL              0xFFFFFFFFu
+#define SPLAT_INVERT_BATCH      1024
+#define MORTON_LAYOUT           3
+#define NO_LAYOUT               0xFFFFFFFFu
+
+// Memory of one slot: its attributes and its voxel.
+#define SPLAT_SLOT_BYTES        (sizeof(glm::vec3) + (2 * sizeof(glm::mat3)) + \
+	sizeof(SymMatrix3) + sizeof(glm::vec4) + (3 * sizeof(GLfloat)) + sizeof(GLuint))
+#define COMPACT_SLOT_BYTES      (sizeof(CompactSplat) + sizeof(GLuint))
+
+struct TensorSample;
+struct TensorSplat_Vertex;
+struct TensorSplat_Instance;
+
+/******************************************************************************
+*                                                                             *
+*                                   Slice      (struct)                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A run of count slots drawn together, such as one slice of a view. It does  *
+*  not own the slots, and is valid until whatever it points into changes.     *
+*                                                                             *
+*******************************************************************************/
+struct Slice
+{
+
+	const GLuint*  slots;
+	size_t         count;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                 SymMatrix3     (struct)                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A symmetric 3 x 3 matrix as its six distinct entries, xx, xy, xz, yy, yz   *
+*  and zz, instead of the nine of a glm::mat3.                                *
+*                                                                             *
+*******************************************************************************/
+struct SymMatrix3
+{
+
+	GLfloat        m[6];
+
+	// Keep the upper triangle of a symmetric matrix.
+	static SymMatrix3 pack(const glm::mat3& M)
+	{
+		SymMatrix3 S = { { M[0][0], M[1][0], M[2][0], M[1][1], M[2][1], M[2][2] } };
+		return S;
+	}
+
+	// Entry n of the matrix in glm's column-major order, and the whole of it.
+	GLfloat entry(GLuint n) const
+	{
+		static const GLuint packed[9] = { 0, 1, 2, 1, 3, 4, 2, 4, 5 };
+		return m[packed[n]];
+	}
+	glm::mat3 unpack() const
+	{
+		return glm::mat3(m[0], m[1], m[2], m[1], m[3], m[4], m[2], m[4], m[5]);
+	}
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                SplatInverse     (struct)                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The view-independent quantities of a splat: the inverse of its tensor and  *
+*  the square of that. Loaders compute them for a whole slab at once with     *
+*  SplatStore::invert, so the thread filling the store only copies them.      *
+*                                                                             *
+*******************************************************************************/
+struct SplatInverse
+{
+
+	glm::mat3      inverse;
+	SymMatrix3     inverse_square;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                  SplatStore       (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  positions                                                                  *
+*           World position of the splat in each slot.                         *
+*  tensors                                                                    *
+*           The 3 x 3 tensor of each slot.                                    *
+*  inverses, inverse_squares                                                  *
+*           Inverse of each slot's tensor, and its square, computed when the  *
+*           splat is loaded so drawing does not invert it every frame. The    *
+*           square is symmetric, so only six of its entries are kept.         *
+*  colors                                                                     *
+*           The r, g, b, a color of each slot.                                *
+*  c                                                                          *
+*           Spherical, linear and planar coefficients, one array each,        *
+*           indexed by SPHERICAL, LINEAR and PLANAR.                          *
+*  voxels                                                                     *
+*           Linear voxel index (i + x * (j + y * k)) of each slot, or         *
+*           FREE_VOXEL for a free slot. 32 bits are enough, since no volume   *
+*           of more than NIFTI_MAX_VOXELS voxels is loaded.                   *
+*  compact                                                                    *
+*           Tensor and coefficients of each slot in a compact store, which    *
+*           keeps none of the arrays above but voxels.                        *
+*  compacted                                                                  *
+*           Whether the store is compact.                                     *
+*  voxel_to_world                                                             *
+*           Transform of a compact store from voxel index to world position.  *
+*  x_size, y_size, z_size                                                     *
+*           Size of the field the voxels belong to.                           *
+*  indexed                                                                    *
+*           Whether index is kept.                                            *
+*  index                                                                      *
+*           Slot of every voxel of the field, or NO_SLOT; allocated by the    *
+*           first add.                                                        *
+*  occupied                                                                   *
+*           Which voxels of index hold a slot, kept alongside it.             *
+*  free_slots                                                                 *
+*           Removed slots, reused before the arrays grow.                     *
+*  slice_order                                                                *
+*           For each of AXIAL, SAGITTAL and CORONAL, every slot sorted by its *
+*           slice along that axis, in draw order within the slice.            *
+*  slice_start                                                                *
+*           Where each slice begins in slice_order, plus its end.             *
+*  sliced                                                                     *
+*           Whether slice_order is up to date with the slots.                 *
+*  metric_order                                                               *
+*           For each of SPHERICAL, LINEAR and PLANAR, every slot sorted by    *
+*           that coefficient, smallest first.                                 *
+*  ranked                                                                     *
+*           Whether metric_order is up to date with the slots.                *
+*  layout                                                                     *
+*           The order the last sort left the slots in, or NO_LAYOUT once any  *
+*           have been added or removed since.                                 *
+*  id                                                                         *
+*           Identity of the store, taken from ids when it is created.         *
+*  revised                                                                    *
+*           The store's revision, counted up whenever it changes. With id it  *
+*           names one content of one store, without a counter shared between  *
+*           stores being touched on every change.                             *
+*  ids                                                                        *
+*           Identities handed out so far, to every store.                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Holds the splats of a field as a structure of arrays: each attribute is one*
+*  contiguous, SIMD-aligned array, and a splat is just a slot number into all *
+*  of them. Walking one attribute over many splats (as drawing and            *
+*  thresholding do) touches only that attribute's memory. The dense index maps*
+*  voxels to slots, and from it the store sorts its slots once along each     *
+*  axis, and once by each Westin coefficient, so any slice of any view, or any*
+*  thresholded view, is a ready-made run of slots. A store whose splats come  *
+*  and go by brick does without these. Slots hold no graphics state: the      *
+*  renderer expands them into its own shared buffers as it draws them. A store*
+*  is not synchronized, so it is changed only on the thread that draws it;    *
+*  once prepared and left alone it may be shared read-only between threads,   *
+*  as a field's published snapshots are.                                      *
+*  A compact store holds each splat in COMPACT_SLOT_BYTES instead of          *
+*  SPLAT_SLOT_BYTES, decoding it as it is drawn or queried; position() and    *
+*  coefficient() read either kind.                                            *
+*                                                                             *
+*******************************************************************************/
+class SplatStore
+{
+
+public:
+
+	// Attributes of each slot.
+	AlignedVector<glm::vec3>   positions;
+	AlignedVector<glm::mat3>   tensors;
+	AlignedVector<glm::mat3>   inverses;
+	AlignedVector<SymMatrix3>  inverse_squares;
+	AlignedVector<glm::vec4>   colors;
+	AlignedVector<GLfloat>     c[3];
+	AlignedVector<GLuint>      voxels;
+
+	// Constructors.
+	SplatStore(GLuint x, GLuint y, GLuint z, bool indexed);
+
+	// Keep splats in compact form from now on; the store must be empty.
+	void set_compact(const glm::mat4& voxel_to_world);
+
+	// Store a sample's splat and return its slot. In an indexed store a
+	// sample for an occupied voxel replaces the splat already there. The
+	// inverse is computed here unless invert() has been given the sample.
+	GLuint add(const TensorSample& sample, const SplatInverse* inverse = NULL);
+
+	// Compute the inverses of count samples on the shared pool, for add.
+	// Must not be called from inside a job of the pool.
+	static void invert(const TensorSample* samples, size_t count, SplatInverse* inverses);
+
+	// Free a slot for reuse.
+	void remove(GLuint slot);
+
+	// Free every slot and the index, or exchange them with another store's.
+	void clear();
+	void swap(SplatStore& other);
+
+	// Renumber the slots in Morton order of their voxels, dropping free
+	// ones. Slot numbers held elsewhere are invalid afterwards.
+	void sort_morton();
+
+	// Fill this empty store with another's splats in a layout: slice by
+	// slice along AXIAL, SAGITTAL or CORONAL, or MORTON_LAYOUT. The other
+	// is only read.
+	void sort_layout(const SplatStore& from, GLuint layout);
+
+	// Compute the SPLAT_NUM_VERTICES vertices of a slot's bounding quad for
+	// the eye and up direction; returns its radius in parameter space.
+	GLfloat recalculate(GLuint slot, const glm::vec3& e, const glm::vec3& up,
+		TensorSplat_Vertex* vertices) const;
+
+	// The same for count slots at once, into count * SPLAT_NUM_VERTICES
+	// vertices, several at a time with the widest SIMD the processor has.
+	void recalculate(const GLuint* slots, size_t count, const glm::vec3& e,
+		const glm::vec3& up, TensorSplat_Vertex* vertices) const;
+
+	// Copy the center, tensor, inverses and color of count slots, in turn,
+	// for the display to expand on the GPU.
+	void get_instances(const GLuint* slots, size_t count,
+		TensorSplat_Instance* instances) const;
+
+	// Bring the slice and metric orders up to date now rather than on the
+	// next query. A prepared store that is no longer changed may be read
+	// through its const methods from any number of threads at once.
+	void prepare();
+
+	// Slice n along AXIAL, SAGITTAL or CORONAL, and every slot in axial
+	// order (indexed stores only). The order is rebuilt on the first call
+	// after the store changes; until then the runs stay valid. The const
+	// forms rebuild nothing, so need a prepared store.
+	Slice get_slice(GLuint axis, GLuint n);
+	Slice get_slice(GLuint axis, GLuint n) const;
+	Slice get_all();
+	Slice get_all() const;
+
+	// Every slot whose SPHERICAL, LINEAR or PLANAR coefficient is at least
+	// threshold, found by binary search (indexed stores only). Rebuilt and
+	// valid as for get_slice.
+	Slice get_above(GLuint metric, GLfloat threshold);
+	Slice get_above(GLuint metric, GLfloat threshold) const;
+
+	// Append the slots of the occupied voxels in the box from lo up to, but
+	// not including, hi, in axial order (indexed stores only).
+	void find_in_box(const glm::uvec3& lo, const glm::uvec3& hi,
+		std::vector<GLuint>& slots) const;
+
+	// Slot of voxel (i, j, k), or NO_SLOT (indexed stores only).
+	GLuint slot_at(GLuint i, GLuint j, GLuint k) const
+	{
+		return index.empty() ? NO_SLOT : index[i + ((size_t)x_size * (j + ((size_t)y_size * k)))];
+	}
+
+	// The sample a slot's splat holds, as decoded if the store is compact.
+	TensorSample sample(GLuint slot) const;
+
+	// World position and SPHERICAL, LINEAR or PLANAR coefficient of a slot.
+	glm::vec3 position(GLuint slot) const
+	{
+		return compacted ? voxel_position(voxels[slot]) : positions[slot];
+	}
+	GLfloat coefficient(GLuint metric, GLuint slot) const
+	{
+		return compacted ? compact_coefficient(compact[slot], metric) : c[metric][slot];
+	}
+
+	// Getters.
+	bool          is_compact() const        {  return compacted;              }
+	size_t        size() const              {  return voxels.size();          }
+	size_t        count() const             {  return voxels.size() - free_slots.size();  }
+	bool          empty() const             {  return count() == 0;           }
+	uint64_t      identity() const          {  return id;                     }
+	uint64_t      revision() const          {  return revised;                }
+	GLuint        get_layout() const        {  return layout;                 }
+
+private:
+
+	AlignedVector<CompactSplat> compact;
+	bool                       compacted;
+	glm::mat4                  voxel_to_world;
+	GLuint                     x_size;
+	GLuint                     y_size;
+	GLuint                     z_size;
+	bool                       indexed;
+	std::vector<GLuint>        index;
+	OccupancyMask              occupied;
+	std::vector<GLuint>        free_slots;
+	std::vector<GLuint>        slice_order[3];
+	std::vector<GLuint>        slice_start[3];
+	bool                       sliced;
+	std::vector<GLuint>        metric_order[3];
+	bool                       ranked;
+	GLuint                     layout;
+	uint64_t                   id;
+	uint64_t                   revised;
+	static std::atomic<uint64_t> ids;
+
+	// World position of the center of a voxel of a compact store.
+	glm::vec3 voxel_position(size_t voxel) const;
+
+	// Rebuild slice_order from the occupancy mask, and metric_order from
+	// that.
+	void sort_slices();
+	void sort_metrics();
+
+	// The live slots in a layout's order, with their keys.
+	void layout_order(std::vector<std::pair<uint64_t, GLuint> >& order, GLuint layout) const;
+
+	// Stores are not copyable.
+	SplatStore(const SplatStore& other);
+	SplatStore& operator=(const SplatStore& other);
+
+};
@@ -1,635 +1,2044 @@
-#pragma comment( lib, "SDL2.lib" )
-#pragma comment( lib, "SDL2main.lib" )
-#pragma comment( lib, "SDL2_image.lib" )
-
-/******************************************************************************
-*                                                                             *
-*                              Included Header Files                          *
-*                                                                             *
-******************************************************************************/
-#include "TensorSplat.h"
-#include <string>
-#include <iostream>
-#include <fstream>
-#include <GL\glew.h>
-#include <glm\glm.hpp>
-#include <glm\gtx\transform.hpp>
-#include <SDL\SDL_image.h>
-
-// Initialize textureID to 0. 
-GLuint TensorSplat::textureID = 0;
-
-// Convenience function for flipping a double from big endian->little endian.
-double flip(double byte)
-{
-	double a;
-	unsigned char *dst = (unsigned char*)&a;
-	unsigned char *src = (unsigned char*)&byte;
-
-	dst[0] = src[7];
-	dst[1] = src[6];
-	dst[2] = src[5];
-	dst[3] = src[4];
-	dst[4] = src[3];
-	dst[5] = src[2];
-	dst[6] = src[1];
-	dst[7] = src[0];
-
-	return a;
-}
-
-/******************************************************************************
-*                                                                             *
-*                         TensorSplat::TensorSplat                            *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  pos                                                                        *
-*           Position of the TensorSplat in world space.                       *
-*  color                                                                      *
-*           The r, g, b, a color of the TensorSplat.                          *
-*  mat                                                                        *
-*           The 3 x 3 matrix representing the tensor.                         *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Public constructor for the TensorSplat object.                             *
-*                                                                             *
-*******************************************************************************/
-TensorSplat::TensorSplat(const glm::vec4& position, const glm::vec4& color, 
-	const glm::mat3 matrix)
-{
-	init_tensorsplat(position, color, matrix);
-}
-TensorSplat::TensorSplat()
-{
-	init_tensorsplat(DEFAULT_POSITION, DEFAULT_COLOR, DEFAULT_MATRIX);
-}
-TensorSplat::TensorSplat(const TensorSplat& other)
-{
-	init_tensorsplat(other.position, other.color, other.matrix);
-	c[SPHERICAL] = other.c[SPHERICAL];
-	c[LINEAR] = other.c[LINEAR];
-	c[PLANAR] = other.c[PLANAR];
-}
-TensorSplat& TensorSplat::operator=(const TensorSplat& other)
-{
-	if (this != &other)
-	{
-		init_tensorsplat(other.position, other.color, other.matrix);
-		c[SPHERICAL] = other.c[SPHERICAL];
-		c[LINEAR] = other.c[LINEAR];
-		c[PLANAR] = other.c[PLANAR];
-	}
-	return *this;
-}
-void TensorSplat::init_tensorsplat(const glm::vec4& position, 
-	const glm::vec4& color, const glm::mat3 matrix)
-{
-	// Initialize all members.
-	this->position = position;
-	this->color = color;
-	this->matrix = matrix;
-	this->c[SPHERICAL] = 0;
-	this->c[LINEAR] = 0;
-	this->c[PLANAR] = 0;
-
-	// Indices will always be constant.
-	GLuint localIndices[] = { 0, 1, 2, 3, };
-
-	// Generate the buffer space.
-	bufferIDs = new GLuint[2];
-	glGenBuffers(2, bufferIDs);
-
-	// Create vertex buffer.
-	glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[VERTEX]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(TensorSplat_Vertex) * SPLAT_NUM_VERTICES,
-		NULL, GL_DYNAMIC_DRAW);
-
-	// Create index buffer.
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIDs[ELEMENT]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(localIndices),
-		localIndices, GL_STATIC_DRAW);
-
-	// Generate Vertex Array Object.
-	glGenVertexArrays(1, &vertexArrayID);
-
-	GLenum err = glGetError();
-	if (err == GL_OUT_OF_MEMORY)
-		std::cout << "Out of memory!" << std::endl;
-
-	//std::cout << "Array #: " << vertexArrayID << std::endl;
-
-	// Bind this vertex array ID.
-	glBindVertexArray(vertexArrayID);
-
-
-	// Bind the vertex buffer.
-	glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[0]);
-
-	// Enable the vertex attributes.
-	glEnableVertexAttribArray(A_0_ATTRIB);
-	glEnableVertexAttribArray(A_1_ATTRIB);
-	glEnableVertexAttribArray(A_2_ATTRIB);
-	glEnableVertexAttribArray(A_3_ATTRIB);
-
-	// Vertex position attribute.
-	glVertexAttribPointer(A_0_ATTRIB, 3, GL_FLOAT, GL_FALSE, sizeof(TensorSplat_Vertex),
-		(void*)A_0_OFFSET);
-
-	// Vertex interpolator attribute.
-	glVertexAttribPointer(A_1_ATTRIB, 3, GL_FLOAT, GL_FALSE, sizeof(TensorSplat_Vertex),
-		(void*)A_1_OFFSET);
-
-	// Vertex color attribute.
-	glVertexAttribPointer(A_2_ATTRIB, 3, GL_FLOAT, GL_FALSE, sizeof(TensorSplat_Vertex),
-		(void*)A_2_OFFSET);
-
-	// Vertex color attribute.
-	glVertexAttribPointer(A_3_ATTRIB, 3, GL_FLOAT, GL_FALSE, sizeof(TensorSplat_Vertex),
-		(void*)A_3_OFFSET);
-
-	// Set the draw mode.
-	drawMode = GL_QUADS;
-
-}
-
-GLfloat TensorSplat::recalculate(glm::vec3 e, glm::vec3 up)
-{
-	// Grab variables from TensorSplat.
-	glm::vec3 c     = glm::vec3(position);
-	glm::mat3 T     = matrix;
-	glm::mat3 T_inv = glm::inverse(T);
-
-	// Calculate parameter-space variables.
-	glm::vec3 e_tilda    = T_inv * (e - c);
-	glm::vec3 up_tilda   = T_inv * up;
-	glm::vec3 z_hat      = -glm::normalize(e_tilda);
-	glm::vec3 y_hat      =  glm::normalize(up_tilda);
-	glm::vec3 x_hat      =  glm::normalize(glm::cross(z_hat, y_hat));
-	GLfloat   mu         = 1.0f / glm::length(e_tilda);
-	GLfloat   mu_squared = std::pow(mu, 2);
-	glm::vec3 m_tilda    = mu_squared * e_tilda;
-	GLfloat   r_tilda    = std::sqrt(1 - mu_squared);
-
-	// Calculate world-space variables.
-	glm::vec3 m = (T * m_tilda) + c;
-	glm::vec3 x = T * x_hat;
-	glm::vec3 y = T * y_hat;
-
-	GLfloat scale = 2.0f;
-
-	// Define local vertices.
-	glm::vec3 V[] =
-	{
-		{ m + (r_tilda * ( x + y) * scale) },
-		{ m + (r_tilda * (x - y) * scale) },
-		{ m + (r_tilda * (-x - y) * scale) },
-		{ m + (r_tilda * (-x + y) * scale) },
-	};
-
-	glm::vec3 loc_A_0[] =
-	{
-		V[0] - e,
-		V[1] - e,
-		V[2] - e,
-		V[3] - e,
-	};
-
-	glm::vec3 loc_A_1[] =
-	{
-		{+1.0f, +1.0f, mu},
-		{+1.0f, -1.0f, mu},
-		{-1.0f, -1.0f, mu},
-		{-1.0f, +1.0f, mu},
-	};
-
-	glm::mat3 in_sq = T_inv * T_inv;
-
-	glm::vec3 loc_A_2[] =
-	{
-		{ in_sq * (e - c) },
-		{ in_sq * (e - c) },
-		{ in_sq * (e - c) },
-		{ in_sq * (e - c) },
-	};
-
-	glm::vec3 loc_A_3[] =
-	{
-		{ in_sq * loc_A_0[0] },
-		{ in_sq * loc_A_0[1] },
-		{ in_sq * loc_A_0[2] },
-		{ in_sq * loc_A_0[3] },
-	};
-
-	TensorSplat_Vertex local_verts[] =
-	{
-		{ loc_A_0[0], loc_A_1[0], loc_A_2[0], loc_A_3[0] },
-		{ loc_A_0[1], loc_A_1[1], loc_A_2[1], loc_A_3[1] },
-		{ loc_A_0[2], loc_A_1[2], loc_A_2[2], loc_A_3[2] },
-		{ loc_A_0[3], loc_A_1[3], loc_A_2[3], loc_A_3[3] },
-	};
-	
-	// Send the data down.
-	glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[VERTEX]);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(local_verts), local_verts);
-
-	return r_tilda;
-}
-
-/******************************************************************************
-*                                                                             *
-*                         TensorSplat::initTexture                            *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  filename                                                                   *
-*           Path to the texture file to load as the splat texture.            *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Initializes the single texture used by all tensor splats.                  *
-*                                                                             *
-*******************************************************************************/
-void TensorSplat::init_texture(const char* filename)
-{
-	/* Enable Texture 2D. */
-	glEnable(GL_TEXTURE_2D);
-
-	/* If the filename is null, do nothing. */
-	if (filename != NULL)
-	{
-		/* Load the SDL_Surface from the file. */
-		SDL_Surface* textureSurface = IMG_Load(filename);
-
-		/* If the image was not loaded correctly, do nothing. */
-		if (textureSurface != NULL)
-		{
-			/* The default color scheme is RGB. */
-			GLenum colorScheme = GL_RGB;
-
-			/* If the file is a bitmap, change the color scheme to BGR. */
-			std::string file(filename);
-			std::string ext = file.substr(file.find('.'), file.length() - 1);
-			if (ext == ".bmp")
-				colorScheme = GL_BGR;
-
-			/* Generate the texture buffer. */
-			glGenTextures(1, &textureID);
-
-			/* Bind the texture ID to the appropriate binding point. */
-			glBindTexture(GL_TEXTURE_2D, textureID);
-
-			/* Send the image data down to the graphics card. */
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureSurface->w,
-				textureSurface->h, 0, colorScheme, GL_UNSIGNED_BYTE,
-				textureSurface->pixels);
-
-			/* Set the desred texture parameters. */
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-			glBindTexture(GL_TEXTURE_2D, TensorSplat::textureID);
-
-			glActiveTexture(GL_TEXTURE0);
-
-		}
-	}
-}
-
-/******************************************************************************
-*                                                                             *
-*                         TensorSplat::delete_texture                         *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Deletes the texture from the graphics hardware.                            *
-*                                                                             *
-*******************************************************************************/
-void TensorSplat::delete_texture()
-{
-	glDeleteTextures(1, &textureID);
-}
-
-/******************************************************************************
-*                                                                             *
-*                              TensorSplat::cleanUp                           *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Deletes the buffers from the graphics hardware.                            *
-*                                                                             *
-*******************************************************************************/
-void TensorSplat::cleanUp()
-{
-	glDeleteBuffers(2, bufferIDs);
-	glDeleteBuffers(1, &vertexArrayID);
-}
-
-/******************************************************************************
-*                                                                             *
-*                         TensorField::TensorField                            *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  x                                                                          *
-*           Length of the x-axis of the Tensor Field.                         *
-*  y                                                                          *
-*           Length of the y-axis of the Tensor Field.                         *
-*  z                                                                          *
-*           Length of the z-axis of the Tensor Field.                         *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Public constructor for the TensorField object.                             *
-*                                                                             *
-*******************************************************************************/
-TensorField::TensorField(GLuint x, GLuint y, GLuint z) :
-x_size(x), y_size(y), z_size(z)
-{
-	// Allocate x-axis.
-	field = new TensorSplat***[x];
-	for (GLuint i  = 0; i < x; i++)
-	{
-		// Allocate y-axis.
-		field[i] = new TensorSplat**[y];
-
-		for (GLuint j = 0; j < y; j++)
-		{
-			// Allocate z-axis.
-			field[i][j] = new TensorSplat*[z];
-
-			for (GLuint k = 0; k < z; k++)
-			{
-				// Initialize to null.
-				field[i][j][k] = NULL;
-			}
-		}
-	}
-}
-
-/******************************************************************************
-*                                                                             *
-*                              TensorField::cleanUp                           *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Deletes the previously allocated memory.                                   *
-*                                                                             *
-*******************************************************************************/
-void TensorField::cleanUp()
-{
-	GLuint i, j, k;
-
-	for (i = 0; i < x_size; i++)
-	{
-		std::cout << "Deleting " << i << std::endl;
-		for (j = 0; j < y_size; j++)
-		{
-			for (k = 0; k < z_size; k++)
-			{
-				if (field[i][j][k] != NULL)
-				{
-					field[i][j][k]->cleanUp();
-					delete field[i][j][k];
-				}
-			}
-			delete[] field[i][j];
-		}
-		delete[] field[i];
-	}
-	delete[] field;
-
-}
-
-/******************************************************************************
-*                                                                             *
-*                       TensorField::read_eig_file                            *
-*                                                                             *
-*******************************************************************************
-* PARAMETERS                                                                  *
-*  nifti_file_path                                                            *
-*           Path to file containing the relevant header information.          *
-*  eig_file_path                                                              *
-*           Path to the file containing the eigenvector/eigenvalue data.      *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Static method which reads an eigenvector/eigenvalue file into a Tensor     *
-*  Field object.                                                              *
-*                                                                             *
-*******************************************************************************/
-TensorField* TensorField::read_eig_file(const std::string nifti_file_path, 
-	const std::string eig_file_path)
-{
-	nifti_1_header hdr;
-	FILE *fp;
-	GLint ret;
-	GLdouble* data_double = NULL;
-	GLfloat* data_float = NULL;
-
-	// Open and read header file.
-	fp = fopen(nifti_file_path.c_str(), "rb");
-	if (fp == NULL) {
-		fprintf(stderr, "\nError opening header file %s\n", nifti_file_path.c_str());
-		return NULL;
-	}
-	ret = fread(&hdr, NII_HEADER_SIZE, 1, fp);
-	if (ret != 1) {
-		fprintf(stderr, "\nError reading header file %s\n", nifti_file_path.c_str());
-		return NULL;
-	}
-
-	// Print some header information.
-	fprintf(stderr, "\n%s header information:", nifti_file_path.c_str());
-	fprintf(stderr, "\nNumber of dimensions: %d", hdr.dim[0]);
-	fprintf(stderr, "\nXYZT dimensions: %d %d %d %d %d", hdr.dim[1], hdr.dim[2], hdr.dim[3], hdr.dim[4], hdr.dim[5]);
-	fprintf(stderr, "\nDatatype code and bits/pixel: %d %d", hdr.datatype, hdr.bitpix);
-	fprintf(stderr, "\nScaling slope and intercept: %.6f %.6f", hdr.scl_slope, hdr.scl_inter);
-	fprintf(stderr, "\nByte offset to data in datafile: %ld", (long)(hdr.vox_offset));
-	fprintf(stderr, "\n");
-
-	fclose(fp);
-
-	// Grab the dimensions of the volume.
-	GLuint X_DIM  = hdr.dim[1];
-	GLuint Y_DIM  = hdr.dim[2];
-	GLuint Z_DIM  = hdr.dim[3];
-	GLuint STRIDE = 12;
-	GLuint size   = X_DIM * Y_DIM * Z_DIM * STRIDE;
-
-	// Open the eigenvector file.
-	fp = fopen(eig_file_path.c_str(), "rb");
-	if (fp == NULL) {
-		fprintf(stderr, "\nError opening header file %s\n", eig_file_path.c_str());
-		return NULL;
-	}
-	// Read the float values out of the file.
-	data_float = (GLfloat*)malloc(sizeof(GLfloat) * size); 
-	ret = fread(data_float, sizeof(GLfloat), size, fp);
-
-	// Create new tensor field. 
-	TensorField* tf = new TensorField(X_DIM, Y_DIM, Z_DIM);
-
-	// Eigenvalues / Eigenvectors.
-	GLfloat e_val_1, e_val_2, e_val_3;
-	glm::vec3 e_vec_1, e_vec_2, e_vec_3;
-	
-	// Looping variables.
-	TensorSplat* tensor = NULL;
-	GLuint index;
-	GLfloat scale = 1e9;
-
-	// Parse the data and initialize the tensor field.
-	for (GLuint k = 0; k < Z_DIM; k++)
-	for (GLuint j = 0; j < Y_DIM; j++)
-	for (GLuint i = 0; i < X_DIM; i++)
-	{
-
-		// Access the matrix at the index.
-		index = (i + (j * X_DIM) + (k * X_DIM * Y_DIM)) * STRIDE;
-
-		// Grab the eigenvalues and eigenvectors.
-		e_val_1   = data_float[index +  0] * scale;
-		e_vec_1.x = data_float[index +  1];
-		e_vec_1.y = data_float[index +  2];
-		e_vec_1.z = data_float[index +  3];
-		e_val_2   = data_float[index +  4] * scale;
-		e_vec_2.x = data_float[index +  5];
-		e_vec_2.y = data_float[index +  6];
-		e_vec_2.z = data_float[index +  7];
-		e_val_3   = data_float[index +  8] * scale;
-		e_vec_3.x = data_float[index +  9];
-		e_vec_3.y = data_float[index + 10];
-		e_vec_3.z = data_float[index + 11];
-
-		// Determine if the tensor is significant or not.
-		if (e_val_1 != 0 || e_val_2 != 0 || e_val_3 != 0)
-		{
-			tensor = tf->field[i][j][k] = new TensorSplat();
-
-			glm::mat3 e_vec_matrix{ e_vec_1, e_vec_2, e_vec_3 };
-			glm::mat3 e_val_matrix{ e_val_1, 0, 0, 0, e_val_2, 0, 0, 0, e_val_3 };
-			glm::mat3 tensor_matrix = glm::mat3{ e_vec_matrix * e_val_matrix * glm::inverse(e_vec_matrix) };
-			GLfloat det = glm::determinant(tensor_matrix);
-
-			//std::cout << det << std::endl;
-
-			// Calculate the barycentric parameters.
-			GLfloat sum = e_val_1 + e_val_2 + e_val_3;
-
-			GLfloat max = (e_val_1 > e_val_2) ? e_val_1 : e_val_2;
-			        max = (max > e_val_3) ? max : e_val_3;
-			GLfloat min = (e_val_1 < e_val_2) ? e_val_1 : e_val_2;
-			        min = (min < e_val_3) ? min : e_val_3;
-			GLfloat med = sum - (max + min);
-
-			GLfloat c_linear = (max - med) / sum;
-			GLfloat c_planar = (2 * (med - min)) / sum;
-			GLfloat c_spherical = (3 * min) / sum;
-			sum = c_linear + c_planar;
-			GLfloat c_f = (sum == 0) ? 0 : c_linear / sum;
-
-			GLfloat alpha = std::exp(-2 * c_spherical );
-
-			// Set the tensor color.
-			if (det <= 10 && c_spherical < 0.95)
-			{
-				glm::vec4 color{ 1.0 - c_f, c_f, 0.0, alpha };
-				glm::vec4 position;
-				// Set the tensor position.
-				position.x = ((hdr.srow_x[0] * i) + (hdr.srow_x[1] * j) + (hdr.srow_x[2] * k)
-					+ hdr.srow_x[3]);
-				position.y = ((hdr.srow_y[0] * i) + (hdr.srow_y[1] * j) + (hdr.srow_y[2] * k)
-					+ hdr.srow_y[3]);
-				position.z = ((hdr.srow_z[0] * i) + (hdr.srow_z[1] * j) + (hdr.srow_z[2] * k)
-					+ hdr.srow_z[3]);
-
-				tensor = tf->field[i][j][k] = new TensorSplat(position, color, tensor_matrix);
-				tensor->c[SPHERICAL] = c_spherical;
-				tensor->c[LINEAR] = c_linear;
-				tensor->c[PLANAR] = c_planar;
-			}
-		}
-	}
-
-	// Free the float buffer.
-	free(data_float);
-	fclose(fp);
-
-	// Return the tensor field.
-	return tf;
-}
-
-void TensorField::get_slices(SliceList& splats, GLuint view_plane, GLfloat threshold)
-{
-	splats.clear();
-	switch (view_plane)
-	{
-	case AXIAL:
-		for (GLuint k = 0; k < z_size; k++)
-		{
-			splats.push_back(std::vector<TensorSplat*>());
-			for (GLuint j = 0; j < y_size; j++)
-			for (GLuint i = 0; i < x_size; i++)
-				if (field[i][j][k] != NULL)
-					splats[k].push_back(field[i][j][k]);
-		}
-		return;
-	case CORONAL:
-		for (GLuint j = 0; j < y_size; j++)
-		{
-			splats.push_back(std::vector<TensorSplat*>());
-			for (GLuint i = 0; i < x_size; i++)
-			for (GLuint k = 0; k < z_size; k++)
-				if (field[i][j][k] != NULL)
-					splats[j].push_back(field[i][j][k]);
-		}
-		return;
-	case SAGITTAL:
-		for (GLuint i = 0; i < x_size; i++)
-		{
-			splats.push_back(std::vector<TensorSplat*>());
-			for (GLuint k = 0; k < z_size; k++)
-			for (GLuint j = 0; j < y_size; j++)
-				if (field[i][j][k] != NULL)
-					splats[i].push_back(field[i][j][k]);
-		}
-		return;
-	case ALL_LINEAR:
-		for (GLuint k = 0; k < z_size; k++)
-		{
-			splats.push_back(std::vector<TensorSplat*>());
-			for (GLuint j = 0; j < y_size; j++)
-				for (GLuint i = 0; i < x_size; i++)
-					if (field[i][j][k] != NULL)
-						if (field[i][j][k]->c[LINEAR] >= threshold)
-							splats[0].push_back(field[i][j][k]);
-		}
-		return;
-	case ALL_PLANAR:
-		for (GLuint k = 0; k < z_size; k++)
-		{
-			splats.push_back(std::vector<TensorSplat*>());
-			for (GLuint j = 0; j < y_size; j++)
-			for (GLuint i = 0; i < x_size; i++)
-			if (field[i][j][k] != NULL)
-				if (field[i][j][k]->c[PLANAR] >= threshold)
-					splats[0].push_back(field[i][j][k]);
-		}
-		return;
-		return;
-	case ALL:		
-		for (GLuint k = 0; k < z_size; k++)
-		{
-			splats.push_back(std::vector<TensorSplat*>());
-			for (GLuint j = 0; j < y_size; j++)
-			for (GLuint i = 0; i < x_size; i++)
-				if (field[i][j][k] != NULL)
-					splats[0].push_back(field[i][j][k]);
-		}
-		return;
-	}
-}
\ No newline at end of file
+#pragma comment( lib, "SDL2.lib" )
+#pragma comment( lib, "SDL2main.lib" )
+#pragma comment( lib, "SDL2_image.lib" )
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "TensorSplat.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "NiftiVolume.h"
+#include "InflateStream.h"
+#include "AsyncReader.h"
+#include "SplatCache.h"
+#include "BrickCache.h"
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+#include <glm\gtx\transform.hpp>
+#include <SDL\SDL_image.h>
+
+// Initialize textureID to 0. 
+GLuint TensorSplat::textureID = 0;
+
+// Splats are stored in full unless --compact is given.
+bool TensorField::compact_splats = false;
+
+// Convenience function for flipping a double from big endian->little endian.
+double flip(double byte)
+{
+	double a;
+	unsigned char *dst = (unsigned char*)&a;
+	unsigned char *src = (unsigned char*)&byte;
+
+	dst[0] = src[7];
+	dst[1] = src[6];
+	dst[2] = src[5];
+	dst[3] = src[4];
+	dst[4] = src[3];
+	dst[5] = src[2];
+	dst[6] = src[1];
+	dst[7] = src[0];
+
+	return a;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TensorSplat::recalculate                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  c                                                                          *
+*           Position of the splat in world space.                             *
+*  T                                                                          *
+*           The 3 x 3 tensor of the splat.                                    *
+*  T_inv, T_inv_sq                                                            *
+*           Its inverse and the square of its inverse.                        *
+*  e                                                                          *
+*           Position of the eye.                                              *
+*  up                                                                         *
+*           Up direction of the camera.                                       *
+*  vertices                                                                   *
+*           Receives the SPLAT_NUM_VERTICES vertices of the bounding quad.    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Radius of the splat's silhouette in parameter space.                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Only the view-dependent work is done here; the inverses never change once  *
+*  a splat is loaded, so they are computed in one batch as its slab arrives.  *
+*  The form without them inverts T first.                                     *
+*                                                                             *
+*******************************************************************************/
+GLfloat TensorSplat::recalculate(const glm::vec3& c, const glm::mat3& T,
+	const glm::mat3& T_inv, const glm::mat3& T_inv_sq, const glm::vec3& e,
+	const glm::vec3& up, TensorSplat_Vertex* vertices)
+{
+	// Calculate parameter-space variables.
+	glm::vec3 e_tilda    = T_inv * (e - c);
+	glm::vec3 up_tilda   = T_inv * up;
+	glm::vec3 z_hat      = -glm::normalize(e_tilda);
+	glm::vec3 y_hat      =  glm::normalize(up_tilda);
+	glm::vec3 x_hat      =  glm::normalize(glm::cross(z_hat, y_hat));
+	GLfloat   mu         = 1.0f / glm::length(e_tilda);
+	GLfloat   mu_squared = mu * mu;
+	glm::vec3 m_tilda    = mu_squared * e_tilda;
+	GLfloat   r_tilda    = std::sqrt(1 - mu_squared);
+
+	// Calculate world-space variables.
+	GLfloat scale = 2.0f;
+	glm::vec3 m = (T * m_tilda) + c;
+	glm::vec3 x = T * x_hat * (r_tilda * scale);
+	glm::vec3 y = T * y_hat * (r_tilda * scale);
+
+	// Define local vertices, relative to the eye.
+	glm::vec3 loc_A_0[] =
+	{
+		(m - e) + ( x + y),
+		(m - e) + ( x - y),
+		(m - e) + (-x - y),
+		(m - e) + (-x + y),
+	};
+
+	glm::vec3 loc_A_1[] =
+	{
+		{+1.0f, +1.0f, mu},
+		{+1.0f, -1.0f, mu},
+		{-1.0f, -1.0f, mu},
+		{-1.0f, +1.0f, mu},
+	};
+
+	// The same for every vertex, and linear in the offset from m, so each is
+	// found from its center and its axes.
+	glm::vec3 loc_A_2 = T_inv_sq * (e - c);
+	glm::vec3 sq_m = T_inv_sq * (m - e);
+	glm::vec3 sq_x = T_inv_sq * x;
+	glm::vec3 sq_y = T_inv_sq * y;
+
+	glm::vec3 loc_A_3[] =
+	{
+		sq_m + ( sq_x + sq_y),
+		sq_m + ( sq_x - sq_y),
+		sq_m + (-sq_x - sq_y),
+		sq_m + (-sq_x + sq_y),
+	};
+
+	for (GLuint v = 0; v < SPLAT_NUM_VERTICES; v++)
+	{
+		vertices[v].A_0 = loc_A_0[v];
+		vertices[v].A_1 = loc_A_1[v];
+		vertices[v].A_2 = loc_A_2;
+		vertices[v].A_3 = loc_A_3[v];
+	}
+
+	return r_tilda;
+}
+GLfloat TensorSplat::recalculate(const glm::vec3& c, const glm::mat3& T,
+	const glm::vec3& e, const glm::vec3& up, TensorSplat_Vertex* vertices)
+{
+	glm::mat3 T_inv = glm::inverse(T);
+	return recalculate(c, T, T_inv, T_inv * T_inv, e, up, vertices);
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TensorSplat::initTexture                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  filename                                                                   *
+*           Path to the texture file to load as the splat texture.            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Initializes the single texture used by all tensor splats.                  *
+*                                                                             *
+*******************************************************************************/
+void TensorSplat::init_texture(const char* filename)
+{
+	/* Enable Texture 2D. */
+	glEnable(GL_TEXTURE_2D);
+
+	/* If the filename is null, do nothing. */
+	if (filename != NULL)
+	{
+		/* Load the SDL_Surface from the file. */
+		SDL_Surface* textureSurface = IMG_Load(filename);
+
+		/* If the image was not loaded correctly, do nothing. */
+		if (textureSurface != NULL)
+		{
+			/* The default color scheme is RGB. */
+			GLenum colorScheme = GL_RGB;
+
+			/* If the file is a bitmap, change the color scheme to BGR. */
+			std::string file(filename);
+			std::string ext = file.substr(file.find('.'), file.length() - 1);
+			if (ext == ".bmp")
+				colorScheme = GL_BGR;
+
+			/* Generate the texture buffer. */
+			glGenTextures(1, &textureID);
+
+			/* Bind the texture ID to the appropriate binding point. */
+			glBindTexture(GL_TEXTURE_2D, textureID);
+
+			/* Send the image data down to the graphics card. */
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureSurface->w,
+				textureSurface->h, 0, colorScheme, GL_UNSIGNED_BYTE,
+				textureSurface->pixels);
+
+			/* Set the desred texture parameters. */
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+			glBindTexture(GL_TEXTURE_2D, TensorSplat::textureID);
+
+			glActiveTexture(GL_TEXTURE0);
+
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TensorSplat::delete_texture                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Deletes the texture from the graphics hardware.                            *
+*                                                                             *
+*******************************************************************************/
+void TensorSplat::delete_texture()
+{
+	glDeleteTextures(1, &textureID);
+	textureID = 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TensorField::TensorField                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  x                                                                          *
+*           Length of the x-axis of the Tensor Field.                         *
+*  y                                                                          *
+*           Length of the y-axis of the Tensor Field.                         *
+*  z                                                                          *
+*           Length of the z-axis of the Tensor Field.                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the TensorField object. The store's voxel index is  *
+*  allocated by the first add_samples, so a field that only passes its        *
+*  samples to a sink never needs it.                                          *
+*                                                                             *
+*******************************************************************************/
+TensorField::TensorField(GLuint x, GLuint y, GLuint z) :
+x_size(x), y_size(y), z_size(z), store(x, y, z, true), cancelled(false), bricks(NULL),
+voxel_to_world(1.0f)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TensorField::TensorField                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  bricks                                                                     *
+*           Brick cache holding the field; the field frees it in cleanUp().   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for a bricked TensorField. Its own store stays empty;   *
+*  its splats exist only while their brick is loaded, in the cache's store,   *
+*  and are reached through get_slice().                                       *
+*                                                                             *
+*******************************************************************************/
+TensorField::TensorField(BrickCache* bricks) :
+x_size(bricks->get_header().x_size), y_size(bricks->get_header().y_size),
+z_size(bricks->get_header().z_size), store(0, 0, 0, false), cancelled(false),
+bricks(bricks), voxel_to_world(1.0f)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                              TensorField::cleanUp                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Frees the splats and the brick cache, if any. Must run on the GL thread.   *
+*  A snapshot another thread still holds is freed when it lets go of it.      *
+*                                                                             *
+*******************************************************************************/
+void TensorField::cleanUp()
+{
+	delete bricks;
+	bricks = NULL;
+	store.clear();
+	std::atomic_store(&published, FieldSnapshot());
+	drawn.reset();
+}
+
+/******************************************************************************
+*                                                                             *
+*                            TensorField::get_store                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The store holding the splats the slice list was filled from: the cache's   *
+*  for a bricked field, and the drawn snapshot for a loaded one.              *
+*                                                                             *
+*******************************************************************************/
+const SplatStore& TensorField::get_store() const
+{
+	if (bricks != NULL)
+		return bricks->get_store();
+	return (drawn != NULL) ? *drawn : store;
+}
+
+/******************************************************************************
+*                                                                             *
+*                     TensorField::snapshot / is_stale                        *
+*                                                                             *
+*******************************************************************************/
+FieldSnapshot TensorField::snapshot() const
+{
+	return std::atomic_load(&published);
+}
+bool TensorField::is_stale() const
+{
+	return snapshot() != drawn;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             TensorField::publish                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  keep_store                                                                 *
+*           Whether store may still be drawn, so must be left as it is.       *
+*  base                                                                       *
+*           The snapshot the new version was built from.                      *
+*  derived                                                                    *
+*           The new version, already prepared.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether derived was published: false if another version was published      *
+*  after base was taken, in which case the caller may rebuild from that one.  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The first form hands the splats the loader created to the first version,   *
+*  sorted into Morton order and prepared so that readers never have to change *
+*  it. It may run on any thread once nothing adds to store any more, and      *
+*  leaves store empty, or, when it is kept, copies from it and leaves it to   *
+*  get_slices to free once the first version is drawn instead. Neither form   *
+*  waits for readers: they keep whatever version they hold.                   *
+*                                                                             *
+*******************************************************************************/
+void TensorField::publish(bool keep_store)
+{
+	std::shared_ptr<SplatStore> first = std::make_shared<SplatStore>(0, 0, 0, false);
+	if (keep_store)
+		first->sort_layout(store, MORTON_LAYOUT);
+	else
+	{
+		first->swap(store);
+		first->sort_morton();
+	}
+	first->prepare();
+	std::atomic_store(&published, FieldSnapshot(first));
+}
+bool TensorField::publish(const FieldSnapshot& base, const FieldSnapshot& derived)
+{
+	FieldSnapshot expected = base;
+	return std::atomic_compare_exchange_strong(&published, &expected, derived);
+}
+
+/******************************************************************************
+*                                                                             *
+*                    TensorField::is_laid_out / relayout                      *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  view_plane                                                                 *
+*           One of AXIAL, CORONAL, SAGITTAL, ALL_LINEAR, ALL_PLANAR or ALL.   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A slice view draws fastest from a version whose slices along its axis are  *
+*  runs of consecutive slots, and the whole-volume views from Morton order.   *
+*  relayout copies the latest version into that layout and publishes it, the  *
+*  way any analysis would: the renderer goes on drawing the version it holds  *
+*  and takes the new one at its next refill. A field with no version yet, or  *
+*  a bricked one, counts as laid out.                                         *
+*                                                                             *
+*******************************************************************************/
+bool TensorField::is_laid_out(GLuint view_plane) const
+{
+	FieldSnapshot base = snapshot();
+	GLuint layout = (view_plane <= CORONAL) ? view_plane : MORTON_LAYOUT;
+	return (base == NULL) || (base->get_layout() == layout);
+}
+bool TensorField::relayout(GLuint view_plane)
+{
+	FieldSnapshot base = snapshot();
+	GLuint layout = (view_plane <= CORONAL) ? view_plane : MORTON_LAYOUT;
+	if (base == NULL || base->get_layout() == layout)
+		return false;
+
+	std::shared_ptr<SplatStore> derived = std::make_shared<SplatStore>(0, 0, 0, false);
+	derived->sort_layout(*base, layout);
+	derived->prepare();
+	return publish(base, derived);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           TensorField::add_samples                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  samples                                                                    *
+*           Significant voxels produced by a loader or read from a cache.     *
+*  count                                                                      *
+*           Number of samples.                                                *
+*  inverses                                                                   *
+*           The samples' inverses from SplatStore::invert, or NULL.           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Stores a splat for every sample at its voxel. The store is read while      *
+*  drawing, so this must run on the thread that owns the GL context. A load   *
+*  running on that thread passes no inverses, so they are computed here in    *
+*  one pooled pass over the slab before any splat is stored.                  *
+*                                                                             *
+*******************************************************************************/
+void TensorField::add_samples(const SampleList& samples)
+{
+	if (!samples.empty())
+		add_samples(&samples[0], samples.size());
+}
+void TensorField::add_samples(const TensorSample* samples, size_t count,
+	const SplatInverse* inverses)
+{
+	std::vector<SplatInverse> computed;
+	if (inverses == NULL && count > 0 && !store.is_compact())
+	{
+		computed.resize(count);
+		SplatStore::invert(samples, count, &computed[0]);
+		inverses = &computed[0];
+	}
+	for (size_t s = 0; s < count; s++)
+		store.add(samples[s], (inverses != NULL) ? &inverses[s] : NULL);
+}
+
+/******************************************************************************
+*                                                                             *
+*                          TensorField::submit_samples                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  samples                                                                    *
+*           A slab of significant voxels. May be left empty.                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  false once the sink has declined the rest of the load.                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Called by the loaders, from the thread running the load, for every slab    *
+*  in order. With no sink the splats are created at once, which is only safe  *
+*  when the load runs on the GL thread. Once the sink has returned false no   *
+*  further slab is passed on, and the loader stops at its next check.         *
+*                                                                             *
+*******************************************************************************/
+bool TensorField::submit_samples(SampleList& samples)
+{
+	if (cancelled)
+		return false;
+	if (sink)
+		cancelled = !sink(this, samples);
+	else
+		add_samples(samples);
+	return !cancelled;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            TensorField::is_wanted                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  false once the sink has declined the rest of the load.                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Asks the sink with an empty slab. Loaders call it between the slabs they   *
+*  read without submitting, such as the planes they hold, so a load that is   *
+*  no longer wanted stops within one slab however it reads the file.          *
+*                                                                             *
+*******************************************************************************/
+bool TensorField::is_wanted()
+{
+	SampleList none;
+	return submit_samples(none);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             TensorField::create                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  x, y, z                                                                    *
+*           Size of the field.                                                *
+*  voxel_to_world                                                             *
+*           Transform the loader places each voxel's splat with.              *
+*  sink                                                                       *
+*           Where the loader's slabs go, or empty to create splats directly.  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Creates the empty field a loader fills, compact if compact_splats is set.  *
+*  A sink is told about the field straight away with an empty slab, and from  *
+*  then on owns it: the receiving thread may draw the field while the loader  *
+*  is still filling it.                                                       *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::create(GLuint x, GLuint y, GLuint z,
+	const glm::mat4& voxel_to_world, const SampleSink& sink)
+{
+	TensorField* tf = new TensorField(x, y, z);
+	tf->voxel_to_world = voxel_to_world;
+	if (compact_splats)
+		tf->store.set_compact(voxel_to_world);
+	tf->sink = sink;
+
+	SampleList none;
+	tf->submit_samples(none);
+	return tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             TensorField::abandon                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  tf                                                                         *
+*           A field whose load failed.                                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  NULL, for the loader to return.                                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Frees the field, unless it was announced to a sink, in which case it       *
+*  belongs to the receiver and the NULL result tells it the load failed. A    *
+*  load the sink cancelled is abandoned the same way, but reports no error.   *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::abandon(TensorField* tf)
+{
+	if (!tf->sink)
+	{
+		tf->cleanUp();
+		delete tf;
+	}
+	return NULL;
+}
+
+// The voxel-to-world rows of a header as a transform of (i, j, k, 1).
+static glm::mat4 sform(const nifti_1_header& hdr)
+{
+	glm::mat4 m(1.0f);
+	for (GLuint c = 0; c < 4; c++)
+		m[c] = glm::vec4(hdr.srow_x[c], hdr.srow_y[c], hdr.srow_z[c], (c == 3) ? 1.0f : 0.0f);
+	return m;
+}
+
+/******************************************************************************
+*                                                                             *
+*                                make_sample                                  *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  e_val_1, e_val_2, e_val_3                                                  *
+*           Eigenvalues of the tensor, in any order.                          *
+*  tensor_matrix                                                              *
+*           The 3 x 3 tensor.                                                 *
+*  hdr                                                                        *
+*           NIfTI header holding the voxel-to-world rows.                     *
+*  i, j, k                                                                    *
+*           Voxel index of the tensor.                                        *
+*  samples                                                                    *
+*           List receiving the tensor if it is significant.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Computes the Westin barycentric metrics, color and world position of a     *
+*  tensor, and appends it to the list unless it fails the significance test.  *
+*                                                                             *
+*******************************************************************************/
+static void make_sample(GLfloat e_val_1, GLfloat e_val_2, GLfloat e_val_3,
+	const glm::mat3& tensor_matrix, const nifti_1_header& hdr,
+	GLuint i, GLuint j, GLuint k, SampleList& samples)
+{
+	GLfloat det = glm::determinant(tensor_matrix);
+
+	// Calculate the barycentric parameters.
+	GLfloat sum = e_val_1 + e_val_2 + e_val_3;
+
+	GLfloat max = (e_val_1 > e_val_2) ? e_val_1 : e_val_2;
+	        max = (max > e_val_3) ? max : e_val_3;
+	GLfloat min = (e_val_1 < e_val_2) ? e_val_1 : e_val_2;
+	        min = (min < e_val_3) ? min : e_val_3;
+	GLfloat med = sum - (max + min);
+
+	GLfloat c_linear = (max - med) / sum;
+	GLfloat c_planar = (2 * (med - min)) / sum;
+	GLfloat c_spherical = (3 * min) / sum;
+	sum = c_linear + c_planar;
+	GLfloat c_f = (sum == 0) ? 0 : c_linear / sum;
+
+	GLfloat alpha = std::exp(-2 * c_spherical );
+
+	// Set the tensor color.
+	if (det <= SIGNIFICANT_DETERMINANT && c_spherical < SIGNIFICANT_SPHERICAL)
+	{
+		TensorSample sample;
+		sample.i = i;
+		sample.j = j;
+		sample.k = k;
+		sample.color = glm::vec4{ 1.0 - c_f, c_f, 0.0, alpha };
+		// Set the tensor position.
+		sample.position = glm::vec4();
+		sample.position.x = ((hdr.srow_x[0] * i) + (hdr.srow_x[1] * j) + (hdr.srow_x[2] * k)
+			+ hdr.srow_x[3]);
+		sample.position.y = ((hdr.srow_y[0] * i) + (hdr.srow_y[1] * j) + (hdr.srow_y[2] * k)
+			+ hdr.srow_y[3]);
+		sample.position.z = ((hdr.srow_z[0] * i) + (hdr.srow_z[1] * j) + (hdr.srow_z[2] * k)
+			+ hdr.srow_z[3]);
+		sample.matrix = tensor_matrix;
+		sample.c[SPHERICAL] = c_spherical;
+		sample.c[LINEAR] = c_linear;
+		sample.c[PLANAR] = c_planar;
+		samples.push_back(sample);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                              make_eig_sample                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  record                                                                     *
+*           EIG_STRIDE floats: each eigenvalue followed by its eigenvector,   *
+*           largest first.                                                    *
+*  scale                                                                      *
+*           Factor applied to the eigenvalues.                                *
+*  hdr                                                                        *
+*           NIfTI header holding the voxel-to-world rows.                     *
+*  i, j, k                                                                    *
+*           Voxel index of the tensor.                                        *
+*  samples                                                                    *
+*           List receiving the tensor if it is significant.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Rebuilds the tensor of one voxel from its eigensystem and appends it to    *
+*  the list, unless its eigenvalues are all zero (background) or it fails the *
+*  significance test.                                                         *
+*                                                                             *
+*******************************************************************************/
+static void make_eig_sample(const GLfloat* record, GLfloat scale,
+	const nifti_1_header& hdr, GLuint i, GLuint j, GLuint k, SampleList& samples)
+{
+	// Eigenvalues / Eigenvectors.
+	GLfloat e_val_1, e_val_2, e_val_3;
+	glm::vec3 e_vec_1, e_vec_2, e_vec_3;
+
+	// Grab the eigenvalues and eigenvectors.
+	e_val_1   = record[ 0] * scale;
+	e_vec_1.x = record[ 1];
+	e_vec_1.y = record[ 2];
+	e_vec_1.z = record[ 3];
+	e_val_2   = record[ 4] * scale;
+	e_vec_2.x = record[ 5];
+	e_vec_2.y = record[ 6];
+	e_vec_2.z = record[ 7];
+	e_val_3   = record[ 8] * scale;
+	e_vec_3.x = record[ 9];
+	e_vec_3.y = record[10];
+	e_vec_3.z = record[11];
+
+	// Determine if the tensor is significant or not.
+	if (e_val_1 != 0 || e_val_2 != 0 || e_val_3 != 0)
+	{
+		glm::mat3 e_vec_matrix{ e_vec_1, e_vec_2, e_vec_3 };
+		glm::mat3 e_val_matrix{ e_val_1, 0, 0, 0, e_val_2, 0, 0, 0, e_val_3 };
+		glm::mat3 tensor_matrix = glm::mat3{ e_vec_matrix * e_val_matrix * glm::inverse(e_vec_matrix) };
+
+		make_sample(e_val_1, e_val_2, e_val_3, tensor_matrix, hdr, i, j, k, samples);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                              parse_eig_rows                                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slab                                                                       *
+*           Pointer to the first float of voxel (0, 0, k_begin).              *
+*  hdr                                                                        *
+*           NIfTI header holding the dimensions and voxel-to-world rows.      *
+*  k_begin                                                                    *
+*           z-slice the slab starts at.                                       *
+*  row_begin                                                                  *
+*           First row to parse, counting x-rows from the start of the slab    *
+*           along y and then z.                                               *
+*  row_end                                                                    *
+*           One past the last row to parse.                                   *
+*  samples                                                                    *
+*           List receiving the significant tensors, in k/j/i scan order.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  As parse_eig_slab, for any run of x-rows, so a single slice can be split   *
+*  across threads. Consecutive runs give the samples of the whole run in      *
+*  order.                                                                     *
+*                                                                             *
+*******************************************************************************/
+static void parse_eig_rows(const GLfloat* slab, const nifti_1_header& hdr,
+	GLuint k_begin, GLuint row_begin, GLuint row_end, SampleList& samples)
+{
+	GLuint X_DIM = hdr.dim[1];
+	GLuint Y_DIM = hdr.dim[2];
+	GLfloat scale = EIG_SCALE;
+
+	for (GLuint row = row_begin; row < row_end; row++)
+	{
+		GLuint j = row % Y_DIM;
+		GLuint k = k_begin + (row / Y_DIM);
+
+		// Records of the row follow one another.
+		const GLfloat* records = slab + ((size_t)row * X_DIM * EIG_STRIDE);
+		for (GLuint i = 0; i < X_DIM; i++)
+			make_eig_sample(records + ((size_t)i * EIG_STRIDE), scale, hdr, i, j, k, samples);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                              parse_eig_slab                                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  slab                                                                       *
+*           Pointer to the first float of voxel (0, 0, k_begin).              *
+*  hdr                                                                        *
+*           NIfTI header holding the dimensions and voxel-to-world rows.      *
+*  k_begin                                                                    *
+*           First z-slice of the slab.                                        *
+*  k_end                                                                      *
+*           One past the last z-slice of the slab.                            *
+*  samples                                                                    *
+*           List receiving the significant tensors, in k/j/i scan order.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Parses a contiguous run of z-slices of interleaved eigenvalue/eigenvector  *
+*  records (EIG_STRIDE floats per voxel). Voxels whose eigenvalues are all    *
+*  zero, or which fail the significance test, produce no sample. Touches no   *
+*  shared state, so slabs may be parsed concurrently.                         *
+*                                                                             *
+*******************************************************************************/
+static void parse_eig_slab(const GLfloat* slab, const nifti_1_header& hdr,
+	GLuint k_begin, GLuint k_end, SampleList& samples)
+{
+	parse_eig_rows(slab, hdr, k_begin, 0, (k_end - k_begin) * hdr.dim[2], samples);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             parse_dtifit_slab                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  planes                                                                     *
+*           For each float of an eigen record, a pointer to its raw value at  *
+*           voxel (0, 0, k_begin) in the dtifit file holding it.              *
+*  sources                                                                    *
+*           For each float of an eigen record, the volume it is read from.    *
+*  k_begin                                                                    *
+*           First z-slice of the slab.                                        *
+*  k_end                                                                      *
+*           One past the last z-slice of the slab.                            *
+*  samples                                                                    *
+*           List receiving the significant tensors, in k/j/i scan order.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gathers a run of z-slices of the six FSL dtifit maps into eigen records.   *
+*  Each map is converted to floats on its own (the files need not share a     *
+*  datatype or byte order), eigenvalues scaled by NIFTI_TENSOR_SCALE as for   *
+*  tensor volumes, and each voxel's record is then parsed as an eigen file's  *
+*  would be.                                                                  *
+*                                                                             *
+*******************************************************************************/
+static void parse_dtifit_slab(const unsigned char* const* planes,
+	const NiftiVolume* const* sources, GLuint k_begin, GLuint k_end, SampleList& samples)
+{
+	const nifti_1_header& hdr = sources[0]->hdr;
+	GLuint X_DIM     = hdr.dim[1];
+	GLuint Y_DIM     = hdr.dim[2];
+	size_t count     = (size_t)X_DIM * Y_DIM * (k_end - k_begin);
+
+	// Convert each map of the slab into its own array; every fourth is an
+	// eigenvalue.
+	std::vector<GLfloat> components(count * EIG_STRIDE);
+	for (GLuint p = 0; p < EIG_STRIDE; p++)
+		sources[p]->convert(planes[p], count,
+			(p % 4 == 0) ? (GLfloat)NIFTI_TENSOR_SCALE : 1.0f, &components[count * p]);
+
+	size_t v = 0;
+	GLfloat record[EIG_STRIDE];
+	for (GLuint k = k_begin; k < k_end; k++)
+	for (GLuint j = 0; j < Y_DIM; j++)
+	for (GLuint i = 0; i < X_DIM; i++, v++)
+	{
+		for (GLuint p = 0; p < EIG_STRIDE; p++)
+			record[p] = components[(count * p) + v];
+		make_eig_sample(record, 1.0f, hdr, i, j, k, samples);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           symmetric_eigenvalues                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  count                                                                      *
+*           Number of tensors in the batch.                                   *
+*  xx, xy, yy, xz, yz, zz                                                     *
+*           Arrays holding each unique component of the tensors.              *
+*  e_1, e_2, e_3                                                              *
+*           Arrays receiving the eigenvalues, largest first.                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Closed-form (trigonometric) eigenvalues of a batch of symmetric 3 x 3      *
+*  matrices. The loop body is branch-free and works on plain arrays, so the   *
+*  compiler vectorizes it across tensors. Isotropic tensors (p == 0) fall out *
+*  as three equal eigenvalues without a special case.                         *
+*                                                                             *
+*******************************************************************************/
+static void symmetric_eigenvalues(size_t count, const GLfloat* xx,
+	const GLfloat* xy, const GLfloat* yy, const GLfloat* xz, const GLfloat* yz,
+	const GLfloat* zz, GLfloat* e_1, GLfloat* e_2, GLfloat* e_3)
+{
+	const GLfloat third_turn = 2.09439510f;
+
+	for (size_t v = 0; v < count; v++)
+	{
+		// Shift by the mean eigenvalue and normalize: B = (A - qI) / p.
+		GLfloat q     = (xx[v] + yy[v] + zz[v]) / 3.0f;
+		GLfloat d_x   = xx[v] - q;
+		GLfloat d_y   = yy[v] - q;
+		GLfloat d_z   = zz[v] - q;
+		GLfloat off   = (xy[v] * xy[v]) + (xz[v] * xz[v]) + (yz[v] * yz[v]);
+		GLfloat p     = std::sqrt(((d_x * d_x) + (d_y * d_y) + (d_z * d_z) + (2 * off)) / 6.0f);
+		GLfloat inv_p = (p > 0) ? 1.0f / p : 0.0f;
+
+		GLfloat b_xx = d_x * inv_p, b_yy = d_y * inv_p, b_zz = d_z * inv_p;
+		GLfloat b_xy = xy[v] * inv_p, b_xz = xz[v] * inv_p, b_yz = yz[v] * inv_p;
+
+		// Half the determinant of B lies in [-1, 1] up to rounding.
+		GLfloat r = 0.5f * ((b_xx * ((b_yy * b_zz) - (b_yz * b_yz)))
+			- (b_xy * ((b_xy * b_zz) - (b_yz * b_xz)))
+			+ (b_xz * ((b_xy * b_yz) - (b_yy * b_xz))));
+		r = (r < -1.0f) ? -1.0f : ((r > 1.0f) ? 1.0f : r);
+
+		GLfloat phi = std::acos(r) / 3.0f;
+		e_1[v] = q + (2 * p * std::cos(phi));
+		e_3[v] = q + (2 * p * std::cos(phi + third_turn));
+		e_2[v] = (3 * q) - e_1[v] - e_3[v];
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                             parse_tensor_slab                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  planes                                                                     *
+*           For each component, a pointer to its raw value at voxel           *
+*           (0, 0, k_begin).                                                  *
+*  volume                                                                     *
+*           Header and datatype description of the tensor volume.             *
+*  k_begin                                                                    *
+*           First z-slice of the slab.                                        *
+*  k_end                                                                      *
+*           One past the last z-slice of the slab.                            *
+*  samples                                                                    *
+*           List receiving the significant tensors, in k/j/i scan order.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Parses a run of z-slices of a NIFTI_INTENT_SYMMATRIX volume. The six       *
+*  components are stored as separate planes (the fifth dimension varies       *
+*  slowest), in lower-triangle row order: xx, xy, yy, xz, yz, zz. Each plane  *
+*  of the slab is converted to floats, the whole slab's eigenvalues are       *
+*  computed in one batch, and then the samples are built voxel by voxel.      *
+*                                                                             *
+*******************************************************************************/
+static void parse_tensor_slab(const unsigned char* const* planes,
+	const NiftiVolume& volume, GLuint k_begin, GLuint k_end, SampleList& samples)
+{
+	const nifti_1_header& hdr = volume.hdr;
+	GLuint X_DIM     = hdr.dim[1];
+	GLuint Y_DIM     = hdr.dim[2];
+	size_t count     = (size_t)X_DIM * Y_DIM * (k_end - k_begin);
+
+	// Convert each component of the slab into its own array.
+	std::vector<GLfloat> components(count * NIFTI_TENSOR_COMPONENTS);
+	GLfloat* comp[NIFTI_TENSOR_COMPONENTS];
+	for (GLuint c = 0; c < NIFTI_TENSOR_COMPONENTS; c++)
+	{
+		comp[c] = &components[count * c];
+		volume.convert(planes[c], count, (GLfloat)NIFTI_TENSOR_SCALE, comp[c]);
+	}
+	const GLfloat* xx = comp[0];
+	const GLfloat* xy = comp[1];
+	const GLfloat* yy = comp[2];
+	const GLfloat* xz = comp[3];
+	const GLfloat* yz = comp[4];
+	const GLfloat* zz = comp[5];
+
+	// Eigenvalues of the whole slab at once.
+	std::vector<GLfloat> eigenvalues(count * 3);
+	GLfloat* e_1 = &eigenvalues[0];
+	GLfloat* e_2 = &eigenvalues[count];
+	GLfloat* e_3 = &eigenvalues[count * 2];
+	symmetric_eigenvalues(count, xx, xy, yy, xz, yz, zz, e_1, e_2, e_3);
+
+	size_t v = 0;
+	for (GLuint k = k_begin; k < k_end; k++)
+	for (GLuint j = 0; j < Y_DIM; j++)
+	for (GLuint i = 0; i < X_DIM; i++, v++)
+	{
+		// Skip background.
+		if (xx[v] == 0 && xy[v] == 0 && yy[v] == 0 &&
+			xz[v] == 0 && yz[v] == 0 && zz[v] == 0)
+			continue;
+
+		glm::mat3 tensor_matrix{ xx[v], xy[v], xz[v],
+		                         xy[v], yy[v], yz[v],
+		                         xz[v], yz[v], zz[v] };
+
+		make_sample(e_1[v], e_2[v], e_3[v], tensor_matrix, hdr, i, j, k, samples);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                               parse_slabs                                   *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  tf                                                                         *
+*           Tensor field receiving the significant tensors.                   *
+*  k_begin                                                                    *
+*           First z-slice to parse.                                           *
+*  k_end                                                                      *
+*           One past the last z-slice to parse.                               *
+*  depth                                                                      *
+*           Number of z-slices handed to each call of parse_slab.             *
+*  parse_slab                                                                 *
+*           Function parsing slices [k, k_slab_end) into a sample list.       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  false if the sink declined the rest of the load, which is then left        *
+*  unparsed.                                                                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Splits [k_begin, k_end) into slabs of depth z-slices and parses them on    *
+*  the shared thread pool. Every slab writes to its own sample list, and the  *
+*  lists are handed to the field in slab order on the calling thread, so the  *
+*  result is identical to a serial parse regardless of the thread count.      *
+*  Slabs are parsed a few per thread at a time, so only that many slabs of    *
+*  samples are ever held at once however deep the volume is. The range may    *
+*  be of rows instead of slices, to split a slice between threads.            *
+*                                                                             *
+*******************************************************************************/
+static bool parse_slabs(TensorField* tf, GLuint k_begin, GLuint k_end, GLuint depth,
+	const std::function<void(GLuint, GLuint, SampleList&)>& parse_slab)
+{
+	GLuint num_slabs = (k_end - k_begin + depth - 1) / depth;
+	GLuint window = ThreadPool::shared().size() * 2;
+
+	std::vector<SampleList> slab_samples(window);
+
+	for (GLuint first = 0; first < num_slabs; first += window)
+	{
+		if (tf->cancelled)
+			return false;
+
+		GLuint count = (first + window < num_slabs) ? window : num_slabs - first;
+
+		ThreadPool::shared().parallel_for(count, [&](size_t slab)
+		{
+			GLuint k          = k_begin + ((first + (GLuint)slab) * depth);
+			GLuint k_slab_end = (k + depth < k_end) ? k + depth : k_end;
+			parse_slab(k, k_slab_end, slab_samples[slab]);
+		});
+
+		// Merge in slab order.
+		for (GLuint slab = 0; slab < count; slab++)
+		{
+			tf->submit_samples(slab_samples[slab]);
+			SampleList().swap(slab_samples[slab]);
+		}
+	}
+	return !tf->cancelled;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             parse_eig_volume                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  data                                                                       *
+*           Pointer to the first float of the eigen volume.                   *
+*  hdr                                                                        *
+*           NIfTI header holding the dimensions and voxel-to-world rows.      *
+*  tf                                                                         *
+*           Tensor field receiving the significant tensors.                   *
+*  source                                                                     *
+*           Mapping the data lives in, whose pages are released as each slab  *
+*           is consumed, or NULL for a heap buffer.                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  false if the sink declined the rest of the load.                           *
+*                                                                             *
+*******************************************************************************/
+static bool parse_eig_volume(const GLfloat* data, const nifti_1_header& hdr,
+	TensorField* tf, MappedFile* source)
+{
+	size_t slice = (size_t)hdr.dim[1] * hdr.dim[2] * EIG_STRIDE;
+
+	return parse_slabs(tf, 0, tf->z_size, EIG_SLAB_DEPTH,
+		[&](GLuint k, GLuint k_end, SampleList& samples)
+	{
+		parse_eig_slab(data + (slice * k), hdr, k, k_end, samples);
+
+		// The slab has been consumed; let its pages go.
+		if (source != NULL)
+			source->discard((const unsigned char*)(data + (slice * k)) -
+				(const unsigned char*)source->data(), sizeof(GLfloat) * slice * (k_end - k));
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                             stream_eig_volume                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  stream                                                                     *
+*           Open stream positioned at the first float of the eigen volume.    *
+*  hdr                                                                        *
+*           NIfTI header holding the dimensions and voxel-to-world rows.      *
+*  tf                                                                         *
+*           Tensor field receiving the significant tensors.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the whole volume was read, false if the stream ended early or the  *
+*  sink declined the rest of the load.                                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Pulls the eigen volume from the stream one slab of EIG_SLAB_DEPTH slices   *
+*  at a time and parses each slab's slices on the thread pool. The stream's   *
+*  producer inflates the following slabs meanwhile, and only one slab is ever *
+*  held here, so memory does not grow with the volume.                        *
+*                                                                             *
+*******************************************************************************/
+static bool stream_eig_volume(InflateStream& stream, const nifti_1_header& hdr,
+	TensorField* tf)
+{
+	size_t slice = (size_t)hdr.dim[1] * hdr.dim[2] * EIG_STRIDE;
+	std::vector<GLfloat> slab(slice * EIG_SLAB_DEPTH);
+
+	for (GLuint k = 0; k < tf->z_size; k += EIG_SLAB_DEPTH)
+	{
+		GLuint k_end = (k + EIG_SLAB_DEPTH < tf->z_size) ? k + EIG_SLAB_DEPTH : tf->z_size;
+		size_t bytes = sizeof(GLfloat) * slice * (k_end - k);
+		if (tf->cancelled || stream.read(&slab[0], bytes) != bytes)
+			return false;
+
+		if (!parse_slabs(tf, k, k_end, 1,
+			[&](GLuint k_slice, GLuint k_slice_end, SampleList& samples)
+		{
+			parse_eig_slab(&slab[0] + (slice * (k_slice - k)), hdr, k_slice, k_slice_end,
+				samples);
+		}))
+			return false;
+	}
+	return !tf->cancelled;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              read_eig_volume                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  reader                                                                     *
+*           Reader opened on the eigen volume, in blocks of whole z-slices.   *
+*  hdr                                                                        *
+*           NIfTI header holding the dimensions and voxel-to-world rows.      *
+*  tf                                                                         *
+*           Tensor field receiving the significant tensors.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the whole volume was read, false if a read failed or the sink      *
+*  declined the rest of the load.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Parses each block of slices on the thread pool as soon as its read         *
+*  completes, split into runs of rows so that a block holding a single slice  *
+*  still keeps every thread busy. The reader's own thread keeps the reads of  *
+*  the following blocks in flight meanwhile, so the device and the parser     *
+*  work at the same time and this thread does nothing but parse.              *
+*                                                                             *
+*******************************************************************************/
+static bool read_eig_volume(AsyncReader& reader, const nifti_1_header& hdr,
+	TensorField* tf)
+{
+	size_t slice = (size_t)hdr.dim[1] * hdr.dim[2] * EIG_STRIDE;
+	size_t bytes;
+	GLuint k = 0;
+
+	GLuint parts = ThreadPool::shared().size() * 2;
+
+	const GLfloat* block;
+	while (!tf->cancelled && (block = (const GLfloat*)reader.next(bytes)) != NULL)
+	{
+		GLuint k_end = k + (GLuint)(bytes / (sizeof(GLfloat) * slice));
+		GLuint rows  = (k_end - k) * hdr.dim[2];
+		GLuint depth = (rows + parts - 1) / parts;
+		if (!parse_slabs(tf, 0, rows, (depth > 0) ? depth : 1,
+			[&](GLuint row, GLuint row_end, SampleList& samples)
+		{
+			parse_eig_rows(block, hdr, k, row, row_end, samples);
+		}))
+			return false;
+		k = k_end;
+	}
+	return !tf->cancelled && k == tf->z_size;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           stream_tensor_volume                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  streams                                                                    *
+*           One open stream per tensor component, each positioned at the      *
+*           first value of the volume's plane of that component.              *
+*  volume                                                                     *
+*           Header and datatype description of the tensor volume.             *
+*  tf                                                                         *
+*           Tensor field receiving the significant tensors.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the whole volume was read, false if a stream ended early or the    *
+*  sink declined the rest of the load.                                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The components of a tensor volume are stored one whole plane after the     *
+*  other, so a voxel's six values lie a plane apart in the file. Each         *
+*  component is inflated by a stream of its own, started at its plane, and    *
+*  the six are pulled a slab at a time in step. Only one slab of each         *
+*  component is ever held, so memory does not grow with the volume; the       *
+*  price is that the stream of a later component inflates the planes before   *
+*  it only to skip them.                                                      *
+*                                                                             *
+*******************************************************************************/
+static bool stream_tensor_volume(InflateStream* streams, const NiftiVolume& volume,
+	TensorField* tf)
+{
+	size_t slice = (size_t)tf->x_size * tf->y_size * volume.value_bytes();
+
+	std::vector<unsigned char> slabs[NIFTI_TENSOR_COMPONENTS];
+	for (GLuint c = 0; c < NIFTI_TENSOR_COMPONENTS; c++)
+		slabs[c].resize(slice * EIG_SLAB_DEPTH);
+
+	for (GLuint k = 0; k < tf->z_size; k += EIG_SLAB_DEPTH)
+	{
+		GLuint k_end = (k + EIG_SLAB_DEPTH < tf->z_size) ? k + EIG_SLAB_DEPTH : tf->z_size;
+		size_t bytes = slice * (k_end - k);
+		if (tf->cancelled)
+			return false;
+		for (GLuint c = 0; c < NIFTI_TENSOR_COMPONENTS; c++)
+			if (streams[c].read(&slabs[c][0], bytes) != bytes)
+				return false;
+
+		if (!parse_slabs(tf, k, k_end, 1,
+			[&](GLuint k_slice, GLuint k_slice_end, SampleList& samples)
+		{
+			const unsigned char* planes[NIFTI_TENSOR_COMPONENTS];
+			for (GLuint c = 0; c < NIFTI_TENSOR_COMPONENTS; c++)
+				planes[c] = &slabs[c][slice * (k_slice - k)];
+			parse_tensor_slab(planes, volume, k_slice, k_slice_end, samples);
+		}))
+			return false;
+	}
+	return !tf->cancelled;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           stream_dtifit_volume                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  streams                                                                    *
+*           One open stream per float of an eigen record, each positioned at  *
+*           the first value of the dtifit volume that float is read from.     *
+*  sources                                                                    *
+*           For each float of an eigen record, the volume it is read from.    *
+*  tf                                                                         *
+*           Tensor field receiving the significant tensors.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if the whole volume was read, false if a stream ended early or the    *
+*  sink declined the rest of the load.                                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  As stream_tensor_volume, over the maps of a dtifit run. Each eigenvector   *
+*  file stores its x, y and z volumes one after the other, so every map has a *
+*  stream of its own and all twelve are pulled a slab at a time in step.      *
+*  Only one slab of each map is ever held.                                    *
+*                                                                             *
+*******************************************************************************/
+static bool stream_dtifit_volume(InflateStream* streams, const NiftiVolume* const* sources,
+	TensorField* tf)
+{
+	size_t slice = (size_t)tf->x_size * tf->y_size;
+
+	std::vector<unsigned char> slabs[EIG_STRIDE];
+	for (GLuint p = 0; p < EIG_STRIDE; p++)
+		slabs[p].resize(slice * EIG_SLAB_DEPTH * sources[p]->value_bytes());
+
+	for (GLuint k = 0; k < tf->z_size; k += EIG_SLAB_DEPTH)
+	{
+		GLuint k_end = (k + EIG_SLAB_DEPTH < tf->z_size) ? k + EIG_SLAB_DEPTH : tf->z_size;
+		if (tf->cancelled)
+			return false;
+		for (GLuint p = 0; p < EIG_STRIDE; p++)
+		{
+			size_t bytes = slice * (k_end - k) * sources[p]->value_bytes();
+			if (streams[p].read(&slabs[p][0], bytes) != bytes)
+				return false;
+		}
+
+		if (!parse_slabs(tf, k, k_end, 1,
+			[&](GLuint k_slice, GLuint k_slice_end, SampleList& samples)
+		{
+			const unsigned char* planes[EIG_STRIDE];
+			for (GLuint p = 0; p < EIG_STRIDE; p++)
+				planes[p] = &slabs[p][slice * (k_slice - k) * sources[p]->value_bytes()];
+			parse_dtifit_slab(planes, sources, k_slice, k_slice_end, samples);
+		}))
+			return false;
+	}
+	return !tf->cancelled;
+}
+
+// Seek to a byte offset that may lie beyond what a long can hold.
+static bool seek_file(FILE* fp, size_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/******************************************************************************
+*                                                                             *
+*                             build_eig_field                                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  volume                                                                     *
+*           Header describing the eigen volume.                               *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  load_mode                                                                  *
+*           One of the EIG_LOAD_ modes.                                       *
+*  index                                                                      *
+*           Which volume of a series to read.                                 *
+*  sink                                                                       *
+*           Receives the field and its slabs, or empty to build splats here.  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A new tensor field, or NULL if the eigen file could not be read.           *
+*                                                                             *
+*******************************************************************************/
+static TensorField* build_eig_field(const NiftiVolume& volume,
+	const std::string& eig_file_path, GLuint load_mode, GLuint index,
+	const SampleSink& sink)
+{
+	FILE *fp;
+	size_t ret;
+	const nifti_1_header& hdr = volume.hdr;
+
+	// Grab the dimensions of the volume.
+	GLuint X_DIM  = hdr.dim[1];
+	GLuint Y_DIM  = hdr.dim[2];
+	GLuint Z_DIM  = hdr.dim[3];
+	size_t size   = (size_t)X_DIM * Y_DIM * Z_DIM * EIG_STRIDE;
+
+	// The volumes of a series are stored one after the other.
+	size_t offset = size * index;
+
+	// Parse slabs as they are inflated.
+	if (load_mode == EIG_LOAD_STREAMED || InflateStream::is_compressed(eig_file_path))
+	{
+		InflateStream stream;
+		if (!stream.open(eig_file_path, sizeof(GLfloat) * offset))
+			return NULL;
+
+		TensorField* tf = TensorField::create(X_DIM, Y_DIM, Z_DIM, sform(hdr), sink);
+		if (!stream_eig_volume(stream, hdr, tf))
+		{
+			if (!tf->cancelled)
+				fprintf(stderr, "\nEigen file %s is smaller than the volume\n",
+					eig_file_path.c_str());
+			return TensorField::abandon(tf);
+		}
+		return tf;
+	}
+
+	// Parse each block of slices as its read completes.
+	if (load_mode == EIG_LOAD_ASYNC)
+	{
+		size_t slice_bytes  = sizeof(GLfloat) * X_DIM * Y_DIM * EIG_STRIDE;
+		size_t block_slices = ASYNC_READ_BLOCK_BYTES / slice_bytes;
+		if (block_slices == 0)
+			block_slices = 1;
+
+		AsyncReader reader;
+		if (!reader.open(eig_file_path, sizeof(GLfloat) * offset, sizeof(GLfloat) * size,
+			slice_bytes * block_slices))
+			return NULL;
+
+		TensorField* tf = TensorField::create(X_DIM, Y_DIM, Z_DIM, sform(hdr), sink);
+		if (!read_eig_volume(reader, hdr, tf))
+		{
+			if (!tf->cancelled)
+				fprintf(stderr, "\nEigen file %s is smaller than the volume or unreadable\n",
+					eig_file_path.c_str());
+			return TensorField::abandon(tf);
+		}
+		return tf;
+	}
+
+	// Parse straight out of a mapping of the eigenvector file.
+	if (load_mode == EIG_LOAD_MAPPED)
+	{
+		MappedFile eig_file;
+		if (eig_file.open(eig_file_path))
+		{
+			if (eig_file.size() < sizeof(GLfloat) * (offset + size))
+			{
+				fprintf(stderr, "\nEigen file %s is smaller than the volume\n",
+					eig_file_path.c_str());
+				return NULL;
+			}
+			eig_file.advise_sequential();
+
+			// Create new tensor field.
+			TensorField* tf = TensorField::create(X_DIM, Y_DIM, Z_DIM, sform(hdr), sink);
+			if (!parse_eig_volume((const GLfloat*)eig_file.data() + offset, hdr, tf, &eig_file))
+				return TensorField::abandon(tf);
+
+			// Return the tensor field.
+			return tf;
+		}
+		fprintf(stderr, "\nFalling back to buffered read of %s\n", eig_file_path.c_str());
+	}
+
+	// Open the eigenvector file.
+	fp = fopen(eig_file_path.c_str(), "rb");
+	if (fp == NULL) {
+		fprintf(stderr, "\nError opening header file %s\n", eig_file_path.c_str());
+		return NULL;
+	}
+	// Create new tensor field. 
+	TensorField* tf = TensorField::create(X_DIM, Y_DIM, Z_DIM, sform(hdr), sink);
+
+	// Read the float values out of the file, a slab at a time so that a load
+	// the sink no longer wants stops reading.
+	GLfloat* data_float = (GLfloat*)malloc(sizeof(GLfloat) * size); 
+	size_t slab = (size_t)X_DIM * Y_DIM * EIG_STRIDE * EIG_SLAB_DEPTH;
+	ret = 0;
+	if (seek_file(fp, sizeof(GLfloat) * offset))
+	{
+		size_t got;
+		do
+		{
+			got = fread(data_float + ret, sizeof(GLfloat), std::min(slab, size - ret), fp);
+			ret += got;
+		} while (got != 0 && ret < size && tf->is_wanted());
+	}
+	bool parsed = (ret == size) && parse_eig_volume(data_float, hdr, tf, NULL);
+	if (ret != size && !tf->cancelled)
+		fprintf(stderr, "\nEigen file %s is smaller than the volume\n", eig_file_path.c_str());
+
+	// Free the float buffer.
+	free(data_float);
+	fclose(fp);
+
+	// Return the tensor field.
+	return parsed ? tf : TensorField::abandon(tf);
+}
+
+/******************************************************************************
+*                                                                             *
+*                       TensorField::read_eig_file                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to file containing the relevant header information.          *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  load_mode                                                                  *
+*           EIG_LOAD_MAPPED to parse straight out of a memory mapping of the  *
+*           eigen file, EIG_LOAD_BUFFERED to read it into a heap buffer, or   *
+*           EIG_LOAD_STREAMED to parse it as it is read, or EIG_LOAD_ASYNC to *
+*           parse each block as its read completes, with many reads in        *
+*           flight. Gzipped (.gz) eigen files are always streamed.            *
+*  index                                                                      *
+*           Which volume of a series to read, below the header's dim[4].      *
+*  sink                                                                       *
+*           If given, receives the new field and then each slab of samples,   *
+*           and the caller creates the splats with add_samples on the GL      *
+*           thread. This lets the load itself run on any thread.              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Static method which reads an eigenvector/eigenvalue file into a Tensor     *
+*  Field object. In mapped mode each slab's pages are released once it has    *
+*  been parsed, so the raw file never needs to be resident alongside the      *
+*  splats built from it. If the file cannot be mapped the buffered path is    *
+*  used instead. The result is cached next to the eigen file (.tsplat), and   *
+*  later runs on the same, unchanged files load the cache instead. The        *
+*  volumes of a series follow one another in the eigen file.                  *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::read_eig_file(const std::string nifti_file_path, 
+	const std::string eig_file_path, GLuint load_mode, GLuint index,
+	const SampleSink& sink)
+{
+	// Read and print the header.
+	NiftiVolume volume;
+	if (!volume.read_header(nifti_file_path))
+		return NULL;
+	volume.print_header();
+
+	if (index >= volume.num_volumes())
+	{
+		fprintf(stderr, "\n%s has no volume %u\n", nifti_file_path.c_str(), index);
+		return NULL;
+	}
+
+	// Skip the whole parse when a valid cache of its result exists.
+	std::vector<std::string> sources;
+	sources.push_back(nifti_file_path);
+	sources.push_back(eig_file_path);
+	return SplatCache::load_or_build(SplatCache::volume_path(eig_file_path, index),
+		"eig", sources, sink, [&](const SampleSink& target) { return build_eig_field(volume,
+		eig_file_path, load_mode, index, target); });
+}
+
+/******************************************************************************
+*                                                                             *
+*                      TensorField::read_eig_uncached                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  volume                                                                     *
+*           Header describing the eigen volume, already read.                 *
+*  eig_file_path                                                              *
+*           Path to the file containing the eigenvector/eigenvalue data.      *
+*  load_mode                                                                  *
+*           One of the EIG_LOAD_ modes.                                       *
+*  index                                                                      *
+*           Which volume of a series to read.                                 *
+*  sink                                                                       *
+*           As for read_eig_file.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  As read_eig_file, but always parses the eigen file and neither reads nor   *
+*  writes the splat cache, so that every load mode can be timed.              *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::read_eig_uncached(const NiftiVolume& volume,
+	const std::string& eig_file_path, GLuint load_mode, GLuint index,
+	const SampleSink& sink)
+{
+	return build_eig_field(volume, eig_file_path, load_mode, index, sink);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            build_tensor_field                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  volume                                                                     *
+*           Header of a tensor volume already checked by read_nifti_file.     *
+*  index                                                                      *
+*           Which volume of the series to read.                               *
+*  sink                                                                       *
+*           Receives the field and its slabs, or empty to build splats here.  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A new tensor field, or NULL if the voxel data could not be read.           *
+*                                                                             *
+*******************************************************************************/
+static TensorField* build_tensor_field(const NiftiVolume& volume, GLuint index,
+	const SampleSink& sink)
+{
+	const nifti_1_header& hdr = volume.hdr;
+
+	// Each component plane holds every volume of the series in turn.
+	size_t plane = volume.volume_values() * volume.num_volumes();
+	size_t first = volume.volume_values() * index;
+
+	// Gzipped volumes are streamed, one stream per component plane.
+	if (InflateStream::is_compressed(volume.data_path()))
+	{
+		InflateStream streams[NIFTI_TENSOR_COMPONENTS];
+		for (GLuint c = 0; c < NIFTI_TENSOR_COMPONENTS; c++)
+			if (!streams[c].open(volume.data_path(), volume.data_offset() +
+				(((plane * c) + first) * volume.value_bytes()), STREAM_PLANE_BYTES))
+				return NULL;
+
+		TensorField* tf = TensorField::create(hdr.dim[1], hdr.dim[2], hdr.dim[3],
+			sform(hdr), sink);
+		if (!stream_tensor_volume(streams, volume, tf))
+		{
+			if (!tf->cancelled)
+				fprintf(stderr, "\nData file %s is smaller than the volume\n",
+					volume.data_path().c_str());
+			return TensorField::abandon(tf);
+		}
+		return tf;
+	}
+
+	// Map the voxel data.
+	MappedFile data_file;
+	if (!data_file.open(volume.data_path()))
+		return NULL;
+
+	size_t bytes = plane * NIFTI_TENSOR_COMPONENTS * volume.value_bytes();
+	if (data_file.size() < volume.data_offset() + bytes)
+	{
+		fprintf(stderr, "\nData file %s is smaller than the volume\n",
+			volume.data_path().c_str());
+		return NULL;
+	}
+	const unsigned char* data = (const unsigned char*)data_file.data() + volume.data_offset();
+
+	// Create new tensor field.
+	TensorField* tf = TensorField::create(hdr.dim[1], hdr.dim[2], hdr.dim[3],
+		sform(hdr), sink);
+	size_t slice = (size_t)hdr.dim[1] * hdr.dim[2];
+	parse_slabs(tf, 0, tf->z_size, EIG_SLAB_DEPTH,
+		[&](GLuint k, GLuint k_end, SampleList& samples)
+	{
+		const unsigned char* planes[NIFTI_TENSOR_COMPONENTS];
+		for (GLuint c = 0; c < NIFTI_TENSOR_COMPONENTS; c++)
+			planes[c] = data + (((plane * c) + first + (slice * k)) * volume.value_bytes());
+		parse_tensor_slab(planes, volume, k, k_end, samples);
+	});
+
+	// Return the tensor field, unless the sink declined it.
+	return tf->cancelled ? TensorField::abandon(tf) : tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       TensorField::read_nifti_file                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Path to a .nii (or .hdr/.img pair) holding a tensor volume.       *
+*  index                                                                      *
+*           Which volume of a series (dim[4]) to read.                        *
+*  sink                                                                       *
+*           As for read_eig_file.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Static method which reads a NIFTI_INTENT_SYMMATRIX diffusion tensor volume *
+*  (six unique components per voxel, any integer or floating point datatype)  *
+*  directly into a Tensor Field object, with no eigen file preprocessing.     *
+*  Gzipped (.nii.gz) volumes are streamed rather than mapped.                 *
+*  Values are scaled by scl_slope / scl_inter and then NIFTI_TENSOR_SCALE,    *
+*  which brings diffusivities in mm^2/s into the range the significance test  *
+*  expects. One volume of a series is read per call. As for eigen files, the  *
+*  result is cached in a .tsplat file next to the volume.                     *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::read_nifti_file(const std::string nifti_file_path,
+	GLuint index, const SampleSink& sink)
+{
+	// Read and print the header.
+	NiftiVolume volume;
+	if (!volume.read_header(nifti_file_path))
+		return NULL;
+	volume.print_header();
+	const nifti_1_header& hdr = volume.hdr;
+
+	if (!volume.is_tensor())
+	{
+		fprintf(stderr, "\n%s is not a symmetric tensor volume\n", nifti_file_path.c_str());
+		return NULL;
+	}
+	if (volume.value_bytes() == 0)
+	{
+		fprintf(stderr, "\nUnsupported datatype %d in %s\n", hdr.datatype,
+			nifti_file_path.c_str());
+		return NULL;
+	}
+
+	if (index >= volume.num_volumes())
+	{
+		fprintf(stderr, "\n%s has no volume %u\n", nifti_file_path.c_str(), index);
+		return NULL;
+	}
+
+	// Skip the whole parse when a valid cache of its result exists.
+	std::vector<std::string> sources;
+	sources.push_back(nifti_file_path);
+	if (volume.data_path() != nifti_file_path)
+		sources.push_back(volume.data_path());
+	return SplatCache::load_or_build(SplatCache::volume_path(nifti_file_path, index),
+		"nifti", sources, sink, [&](const SampleSink& target) { return build_tensor_field(volume,
+		index, target); });
+}
+
+// Suffixes of the dtifit maps, in the order read_dtifit_files holds them.
+static const char* dtifit_maps[DTIFIT_FILES] = { "L1", "L2", "L3", "V1", "V2", "V3" };
+
+// The dtifit file and volume holding float p of an eigen record: eigenvalue
+// c comes from L(c+1), and the x, y and z of its eigenvector are the three
+// volumes of V(c+1).
+static void dtifit_plane(GLuint p, GLuint& file, GLuint& component)
+{
+	file      = (p % 4 == 0) ? p / 4 : 3 + (p / 4);
+	component = (p % 4 == 0) ? 0 : (p % 4) - 1;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            build_dtifit_field                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  volumes                                                                    *
+*           Headers of the six dtifit files, already checked to match.        *
+*  sink                                                                       *
+*           Receives the field and its slabs, or empty to build splats here.  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A new tensor field, or NULL if the voxel data could not be read.           *
+*                                                                             *
+*******************************************************************************/
+static TensorField* build_dtifit_field(const NiftiVolume* volumes, const SampleSink& sink)
+{
+	const nifti_1_header& hdr = volumes[0].hdr;
+	size_t slice = (size_t)hdr.dim[1] * hdr.dim[2];
+
+	// Where each float of an eigen record is read from.
+	const NiftiVolume* sources[EIG_STRIDE];
+	GLuint files[EIG_STRIDE];
+	size_t offsets[EIG_STRIDE];
+	bool compressed = false;
+	for (GLuint p = 0; p < EIG_STRIDE; p++)
+	{
+		GLuint component;
+		dtifit_plane(p, files[p], component);
+		sources[p] = &volumes[files[p]];
+		offsets[p] = volumes[files[p]].data_offset() +
+			(volumes[files[p]].volume_values() * component * volumes[files[p]].value_bytes());
+		compressed = compressed || InflateStream::is_compressed(volumes[files[p]].data_path());
+	}
+
+	// Gzipped files are streamed, one stream per map.
+	if (compressed)
+	{
+		InflateStream streams[EIG_STRIDE];
+		for (GLuint p = 0; p < EIG_STRIDE; p++)
+			if (!streams[p].open(sources[p]->data_path(), offsets[p], STREAM_PLANE_BYTES))
+				return NULL;
+
+		TensorField* tf = TensorField::create(hdr.dim[1], hdr.dim[2], hdr.dim[3],
+			sform(hdr), sink);
+		if (!stream_dtifit_volume(streams, sources, tf))
+		{
+			if (!tf->cancelled)
+				fprintf(stderr, "\ndtifit files %s... are smaller than the volume\n",
+					volumes[0].data_path().c_str());
+			return TensorField::abandon(tf);
+		}
+		return tf;
+	}
+
+	// Map the voxel data of all six files.
+	MappedFile data_files[DTIFIT_FILES];
+	for (GLuint f = 0; f < DTIFIT_FILES; f++)
+	{
+		if (!data_files[f].open(volumes[f].data_path()))
+			return NULL;
+
+		size_t bytes = volumes[f].volume_values() * volumes[f].num_volumes() *
+			volumes[f].value_bytes();
+		if (data_files[f].size() < volumes[f].data_offset() + bytes)
+		{
+			fprintf(stderr, "\nData file %s is smaller than the volume\n",
+				volumes[f].data_path().c_str());
+			return NULL;
+		}
+		data_files[f].advise_sequential();
+	}
+	const unsigned char* data[EIG_STRIDE];
+	for (GLuint p = 0; p < EIG_STRIDE; p++)
+		data[p] = (const unsigned char*)data_files[files[p]].data() + offsets[p];
+
+	// Create new tensor field.
+	TensorField* tf = TensorField::create(hdr.dim[1], hdr.dim[2], hdr.dim[3],
+		sform(hdr), sink);
+	parse_slabs(tf, 0, tf->z_size, EIG_SLAB_DEPTH,
+		[&](GLuint k, GLuint k_end, SampleList& samples)
+	{
+		const unsigned char* planes[EIG_STRIDE];
+		for (GLuint p = 0; p < EIG_STRIDE; p++)
+			planes[p] = data[p] + (slice * k * sources[p]->value_bytes());
+		parse_dtifit_slab(planes, sources, k, k_end, samples);
+	});
+
+	// Return the tensor field, unless the sink declined it.
+	return tf->cancelled ? TensorField::abandon(tf) : tf;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      TensorField::find_dtifit_files                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  basename                                                                   *
+*           Output basename given to dtifit, e.g. "subject/dti".              *
+*  paths                                                                      *
+*           Receives the paths of the L1, L2, L3, V1, V2 and V3 files.        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true if all six files exist, as basename_XX.nii.gz or basename_XX.nii.     *
+*                                                                             *
+*******************************************************************************/
+bool TensorField::find_dtifit_files(const std::string& basename,
+	std::vector<std::string>& paths)
+{
+	static const char* extensions[] = { ".nii.gz", ".nii" };
+
+	paths.clear();
+	for (GLuint f = 0; f < DTIFIT_FILES; f++)
+	{
+		for (GLuint e = 0; e < ARRAY_SIZE(extensions); e++)
+		{
+			std::string path = basename + "_" + dtifit_maps[f] + extensions[e];
+			FILE* fp = fopen(path.c_str(), "rb");
+			if (fp != NULL)
+			{
+				fclose(fp);
+				paths.push_back(path);
+				break;
+			}
+		}
+		if (paths.size() != f + 1)
+			return false;
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      TensorField::read_dtifit_files                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  basename                                                                   *
+*           Output basename given to dtifit.                                  *
+*  sink                                                                       *
+*           As for read_eig_file.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Static method which reads the eigensystem FSL dtifit writes as six         *
+*  separate files (eigenvalue maps L1-L3, and eigenvector files V1-V3 of      *
+*  three volumes each) straight into a Tensor Field object. The maps are      *
+*  gathered voxel by voxel a slab at a time, in one pass over the volume,     *
+*  so they never have to be interleaved into an eigen file first. Gzipped     *
+*  files are streamed, the rest mapped, and the files may differ in datatype. *
+*  The result is cached in basename.tsplat.                                   *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::read_dtifit_files(const std::string& basename,
+	const SampleSink& sink)
+{
+	std::vector<std::string> paths;
+	if (!find_dtifit_files(basename, paths))
+	{
+		fprintf(stderr, "\nMissing dtifit output %s_{L1,L2,L3,V1,V2,V3}.nii[.gz]\n",
+			basename.c_str());
+		return NULL;
+	}
+
+	// Read every header, and check the files describe the same grid.
+	NiftiVolume volumes[DTIFIT_FILES];
+	for (GLuint f = 0; f < DTIFIT_FILES; f++)
+	{
+		if (!volumes[f].read_header(paths[f]))
+			return NULL;
+		if (volumes[f].value_bytes() == 0)
+		{
+			fprintf(stderr, "\nUnsupported datatype %d in %s\n", volumes[f].hdr.datatype,
+				paths[f].c_str());
+			return NULL;
+		}
+		for (GLuint d = 1; d <= 3; d++)
+			if (volumes[f].hdr.dim[d] != volumes[0].hdr.dim[d])
+			{
+				fprintf(stderr, "\n%s does not match the size of %s\n", paths[f].c_str(),
+					paths[0].c_str());
+				return NULL;
+			}
+		GLuint expected = (f < 3) ? 1 : 3;
+		if (volumes[f].num_volumes() != expected)
+		{
+			fprintf(stderr, "\n%s should hold %u volume(s)\n", paths[f].c_str(), expected);
+			return NULL;
+		}
+	}
+	volumes[0].print_header();
+
+	// Skip the whole parse when a valid cache of its result exists.
+	return SplatCache::load_or_build(SplatCache::volume_path(basename, 0),
+		"dtifit", paths, sink, [&](const SampleSink& target) { return build_dtifit_field(
+		volumes, target); });
+}
+
+/******************************************************************************
+*                                                                             *
+*                           TensorField::read_bricked                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  nifti_file_path                                                            *
+*           Header of the eigen volume, the tensor volume itself, or the      *
+*           basename of dtifit output.                                        *
+*  eig_file_path                                                              *
+*           File containing the eigenvector/eigenvalue data, or empty to read *
+*           a tensor volume with read_nifti_file, or dtifit output with       *
+*           read_dtifit_files if nifti_file_path is its basename.             *
+*  index                                                                      *
+*           Volume of a series to open.                                       *
+*  cache_bytes                                                                *
+*           Memory the field's loaded bricks may use.                         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A bricked tensor field with no splats loaded, or NULL on failure.          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Opens the .tbrick file next to the data, building it first if it is        *
+*  missing or older than its sources. The build runs the usual loader with a  *
+*  sink that writes each slab straight to the brick file, so the field is     *
+*  never held in memory, however large it is.                                 *
+*                                                                             *
+*******************************************************************************/
+TensorField* TensorField::read_bricked(const std::string& nifti_file_path,
+	const std::string& eig_file_path, GLuint index, size_t cache_bytes)
+{
+	// Key the brick file exactly as the loader keys its splat cache.
+	bool eig = !eig_file_path.empty();
+	std::vector<std::string> sources;
+	bool dtifit = !eig && find_dtifit_files(nifti_file_path, sources);
+	if (!dtifit)
+	{
+		NiftiVolume volume;
+		if (!volume.read_header(nifti_file_path))
+			return NULL;
+		sources.push_back(nifti_file_path);
+		if (eig)
+			sources.push_back(eig_file_path);
+		else if (volume.data_path() != nifti_file_path)
+			sources.push_back(volume.data_path());
+	}
+	uint64_t key = SplatCache::source_key(eig ? "eig" : (dtifit ? "dtifit" : "nifti"), sources);
+
+	BrickCache* bricks = BrickCache::open_or_build(
+		SplatCache::volume_path(eig ? eig_file_path : nifti_file_path, index, BRICK_EXTENSION),
+		key, cache_bytes, [&](const SampleSink& sink)
+	{
+		if (eig)
+			return read_eig_file(nifti_file_path, eig_file_path, EIG_LOAD_ASYNC, index, sink);
+		if (dtifit)
+			return read_dtifit_files(nifti_file_path, sink);
+		return read_nifti_file(nifti_file_path, index, sink);
+	});
+	return (bricks != NULL) ? new TensorField(bricks) : NULL;
+}
+
+// Point every slice of a view at the splats of a store: one still loading,
+// whose orders are rebuilt as needed, or a prepared snapshot.
+template <class Store>
+static void fill_slices(Store& store, SliceList& splats, GLuint view_plane,
+	GLfloat threshold)
+{
+	// One with nothing added yet has only empty slices.
+	if (store.empty())
+		return;
+
+	switch (view_plane)
+	{
+	case AXIAL:
+	case CORONAL:
+	case SAGITTAL:
+		for (GLuint n = 0; n < splats.size(); n++)
+			splats[n] = store.get_slice(view_plane, n);
+		return;
+	// Whole-volume views keep every splat in the first of z_size slices.
+	case ALL_LINEAR:
+		splats[0] = store.get_above(LINEAR, threshold);
+		return;
+	case ALL_PLANAR:
+		splats[0] = store.get_above(PLANAR, threshold);
+		return;
+	case ALL:
+		splats[0] = store.get_all();
+		return;
+	}
+}
+
+void TensorField::get_slices(SliceList& splats, GLuint view_plane, GLfloat threshold)
+{
+	Slice none = { NULL, 0 };
+	splats.assign((view_plane == SAGITTAL) ? x_size :
+		(view_plane == CORONAL) ? y_size : z_size, none);
+
+	// A bricked field fills its slices one at a time, in get_slice.
+	if (bricks != NULL)
+	{
+		bricks->invalidate();
+		return;
+	}
+
+	// A loaded field draws the latest version until it is next asked.
+	drawn = snapshot();
+	if (drawn != NULL)
+	{
+		// Nothing refers to the splats a kept store was copied from any more.
+		if (store.size() > 0)
+			store.clear();
+		fill_slices(*drawn, splats, view_plane, threshold);
+	}
+	else
+		fill_slices(store, splats, view_plane, threshold);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            TensorField::get_slice                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  splats                                                                     *
+*           Slice list last filled by get_slices.                             *
+*  view_plane                                                                 *
+*           The view, as for get_slices.                                      *
+*  threshold                                                                  *
+*           The threshold, as for get_slices.                                 *
+*  slice                                                                      *
+*           The slice about to be drawn.                                      *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  true once the slice holds all of its splats.                               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Called every frame before a slice is drawn. A field held in memory already *
+*  has every slice filled, so this only does work for a bricked field, whose  *
+*  cache reads the bricks the slice crosses and empties the other slices.     *
+*                                                                             *
+*******************************************************************************/
+bool TensorField::get_slice(SliceList& splats, GLuint view_plane, GLfloat threshold,
+	GLuint slice)
+{
+	if (bricks == NULL)
+		return true;
+	return bricks->get_slice(splats, view_plane, threshold, slice);
+}
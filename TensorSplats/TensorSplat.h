@@ -1,182 +1,346 @@
-#pragma once
-
-/******************************************************************************
-*                                                                             *
-*                              Included Header Files                          *
-*                                                                             *
-******************************************************************************/
-#include <GL\glew.h>
-#include <SDL\SDL.h>
-#include <glm\glm.hpp>
-#include <nifticlib\nifti1.h>
-#include <vector>
-
-/******************************************************************************
-*                                                                             *
-*                           Defined Constants / Macros                        *
-*                                                                             *
-******************************************************************************/
-#define SPLAT_NUM_VERTICES      4
-#define SPLAT_NUM_INDICES       8
-#define NII_HEADER_SIZE         352
-#define A_0_OFFSET              (sizeof(GLfloat) * 0)
-#define A_1_OFFSET              (sizeof(GLfloat) * 3)
-#define A_2_OFFSET              (sizeof(GLfloat) * 6)
-#define A_3_OFFSET              (sizeof(GLfloat) * 9)
-#define VERTEX                  0
-#define ELEMENT                 1
-#define SPHERICAL               0
-#define LINEAR                  1
-#define PLANAR                  2
-#define A_0_ATTRIB              0
-#define A_1_ATTRIB              1
-#define A_2_ATTRIB	            2
-#define A_3_ATTRIB              3
-#define AXIAL                   0
-#define SAGITTAL                1
-#define CORONAL                 2
-#define ALL_LINEAR              3
-#define ALL_PLANAR              4
-#define ALL                     5
-#define DEFAULT_THRESHOLD       0.5f
-#define THRESHOLD_INCREMENT     0.05f
-#define MAX_THRESHOLD           0.9f
-#define MIN_THRESHOLD           0.3f
-#define ARRAY_SIZE(a)           sizeof(a) / sizeof(*a)
-#define PRINT_VEC3(a)			"{ " << a.x << ", " << a.y << ", " << a.z << "}"
-#define DEFAULT_POSITION        glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}
-#define DEFAULT_COLOR           glm::vec4{1.0f, 1.0f, 1.0f, 0.0f}
-#define DEFAULT_MATRIX          glm::mat3()
-
-
-/******************************************************************************
-*                                                                             *
-*                             Splat_Vertex     (struct)                       *
-*                                                                             *
-******************************************************************************/
-struct TensorSplat_Vertex
-{
-
-	glm::vec3      A_0;
-	glm::vec3      A_1;
-	glm::vec3      A_2;
-	glm::vec3      A_3;
-
-};
-
-/******************************************************************************
-*                                                                             *
-*                                  TensorSplat      (class)                   *
-*                                                                             *
-*******************************************************************************
-* MEMBERS                                                                     *
-*  position                                                                   *
-*           The x, y, z, w position of the TensorSplat in world space.        *
-*  color                                                                      *
-*           The r, g, b, a color of the TensorSplat.                          *
-*  matrix                                                                     *
-*           The 3 x 3 matrix representing the tensor.                         *
-*  inverse                                                                    *
-*           The 3 x 3 inverse tensor.                                         *
-*  c                                                                          *
-*           Array of barycentric values representing the linear, planar, and  *
-*           spherical components of the tensor.                               *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Class representing a tensor splat in 3-D space.                            *
-*                                                                             *
-*******************************************************************************/
-class TensorSplat
-{
-
-public:
-
-	// Single texture for all TensorSplat objects.
-	static GLuint textureID;
-
-	// Initialize TensorSplat texture.
-	static void init_texture(const char* filename);
-	static void delete_texture();
-
-	// Graphics buffer variables.
-	GLuint*        bufferIDs;
-	GLuint         vertexArrayID;
-	GLenum         drawMode;
-
-	// Attributes of the TensorSplat.
-	glm::vec4      position;
-	glm::vec4      color;
-	glm::mat3      matrix;
-	GLfloat        c[3];
-
-	// Constructors.
-	TensorSplat();
-	TensorSplat(const TensorSplat& other);
-	TensorSplat(const glm::vec4& pos, const glm::vec4& color, const glm::mat3 mat);
-	TensorSplat& operator=(const TensorSplat& other);
-	GLfloat& operator()(GLuint i, GLuint j) { return matrix[i][j]; }
-	GLfloat operator()(GLuint i, GLuint j) const { return matrix[i][j]; }
-
-	// Re-position bounding box.
-	GLfloat recalculate(glm::vec3 e, glm::vec3 up);
-
-	// Free up stuff on graphics card.
-	void cleanUp();
-
-private:
-
-	// Initialization function.
-	void init_tensorsplat(const glm::vec4& position, const glm::vec4& color, 
-		const glm::mat3 matrix);
-
-};
-
-typedef std::vector<std::vector<TensorSplat*>> SliceList;
-
-/******************************************************************************
-*                                                                             *
-*                                  TensorField      (class)                   *
-*                                                                             *
-*******************************************************************************
-* MEMBERS                                                                     *
-*  x_size                                                                     *
-*           The number of tensors aligned on the x-axis.                      *
-*  y_size                                                                     *
-*           The number of tensors aligned on the y-axis.                      *
-*  z_size                                                                     *
-*           The number of tensors aligned on the z-axis.                      *
-*  field                                                                      *
-*           The 3-D array of tensors.                                         *
-*                                                                             *
-*******************************************************************************
-* DESCRIPTION                                                                 *
-*  Class representing a field of tensor splats.                               *
-*                                                                             *
-*******************************************************************************/
-class TensorField {
-
-public:
-
-	// Size of the field.
-	GLuint x_size;
-	GLuint y_size;
-	GLuint z_size;
-
-	// 3-D array of tensors.
-	TensorSplat**** field;
-
-	// Constructors.
-	TensorField(GLuint x, GLuint y, GLuint z);
-	TensorField(const TensorField& other);
-	TensorField& operator=(const TensorField& rhs);
-
-	// Deallocate memory.
-	void cleanUp();
-
-	void TensorField::get_slices(SliceList& splats, GLuint view_plane, GLfloat threshold);
-	static TensorField* read_nifti_file(const std::string nifti_file_path);
-	static TensorField* TensorField::read_eig_file(const std::string nifti_file_path,
-		std::string eig_file_path);
-};
-
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <GL\glew.h>
+#include <SDL\SDL.h>
+#include <glm\glm.hpp>
+#include <nifticlib\nifti1.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include "SplatStore.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define SPLAT_NUM_VERTICES      4
+#define SPLAT_NUM_INDICES       8
+#define NII_HEADER_SIZE         352
+#define A_0_OFFSET              (sizeof(GLfloat) * 0)
+#define A_1_OFFSET              (sizeof(GLfloat) * 3)
+#define A_2_OFFSET              (sizeof(GLfloat) * 6)
+#define A_3_OFFSET              (sizeof(GLfloat) * 9)
+#define COLOR_OFFSET            (sizeof(GLfloat) * 12)
+#define VERTEX                  0
+#define ELEMENT                 1
+#define SPHERICAL               0
+#define LINEAR                  1
+#define PLANAR                  2
+#define A_0_ATTRIB              0
+#define A_1_ATTRIB              1
+#define A_2_ATTRIB	            2
+#define A_3_ATTRIB              3
+#define COLOR_ATTRIB            4
+#define SPLAT_NUM_ATTRIBS       5
+#define AXIAL                   0
+#define SAGITTAL                1
+#define CORONAL                 2
+#define ALL_LINEAR              3
+#define ALL_PLANAR              4
+#define ALL                     5
+#define DEFAULT_THRESHOLD       0.5f
+#define THRESHOLD_INCREMENT     0.05f
+#define THRESHOLD_SCRUB_STEP    0.01f
+#define MAX_THRESHOLD           0.9f
+#define MIN_THRESHOLD           0.3f
+#define ARRAY_SIZE(a)           sizeof(a) / sizeof(*a)
+#define PRINT_VEC3(a)			"{ " << a.x << ", " << a.y << ", " << a.z << "}"
+#define DEFAULT_POSITION        glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}
+#define DEFAULT_COLOR           glm::vec4{1.0f, 1.0f, 1.0f, 0.0f}
+#define DEFAULT_MATRIX          glm::mat3()
+#define EIG_STRIDE              12
+#define EIG_SCALE               1e9
+#define NIFTI_TENSOR_SCALE      1e3
+#define EIG_LOAD_MAPPED         0
+#define EIG_LOAD_BUFFERED       1
+#define EIG_LOAD_STREAMED       2
+#define EIG_LOAD_ASYNC          3
+#define EIG_SLAB_DEPTH          8
+#define DTIFIT_FILES            6
+#define SIGNIFICANT_DETERMINANT 10
+#define SIGNIFICANT_SPHERICAL   0.95
+
+
+/******************************************************************************
+*                                                                             *
+*                             Splat_Vertex     (struct)                       *
+*                                                                             *
+******************************************************************************/
+struct TensorSplat_Vertex
+{
+
+	glm::vec3      A_0;
+	glm::vec3      A_1;
+	glm::vec3      A_2;
+	glm::vec3      A_3;
+	glm::vec4      color;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                            Splat_Instance     (struct)                      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  What the vertex shader needs to expand one splat itself: its center, its   *
+*  tensor, the tensor's inverse and squared inverse, and its color.           *
+*                                                                             *
+*******************************************************************************/
+struct TensorSplat_Instance
+{
+
+	glm::vec3      center;
+	glm::mat3      tensor;
+	glm::mat3      tensor_inv;
+	glm::mat3      tensor_inv_sq;
+	glm::vec4      color;
+
+};
+
+/******************************************************************************
+*                                                                             *
+*                                  TensorSplat      (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  textureID                                                                  *
+*           The texture every splat is drawn with.                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  What all tensor splats share: their texture, and the construction of the   *
+*  bounding quad a splat is drawn on. The splats themselves are slots of a    *
+*  SplatStore.                                                                *
+*                                                                             *
+*******************************************************************************/
+class TensorSplat
+{
+
+public:
+
+	// Single texture for all TensorSplat objects.
+	static GLuint textureID;
+
+	// Initialize TensorSplat texture.
+	static void init_texture(const char* filename);
+	static void delete_texture();
+
+	// Compute the bounding quad of a splat for the eye and up direction,
+	// from the inverse of its tensor and its square if they are at hand.
+	static GLfloat recalculate(const glm::vec3& c, const glm::mat3& T,
+		const glm::mat3& T_inv, const glm::mat3& T_inv_sq, const glm::vec3& e,
+		const glm::vec3& up, TensorSplat_Vertex* vertices);
+	static GLfloat recalculate(const glm::vec3& c, const glm::mat3& T,
+		const glm::vec3& e, const glm::vec3& up, TensorSplat_Vertex* vertices);
+
+};
+
+// Slots of the splats of each slice of a view.
+typedef std::vector<Slice> SliceList;
+
+/******************************************************************************
+*                                                                             *
+*                             TensorSample     (struct)                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Plain record of one significant voxel produced by a loader. Samples hold   *
+*  no graphics state, so they can be built on any thread and turned into      *
+*  splats later on the thread that owns the GL context.                       *
+*                                                                             *
+*******************************************************************************/
+struct TensorSample
+{
+
+	GLuint         i, j, k;
+	glm::vec4      position;
+	glm::vec4      color;
+	glm::mat3      matrix;
+	GLfloat        c[3];
+
+};
+
+typedef std::vector<TensorSample> SampleList;
+
+// Receives each slab of samples a loader produces, with the field it belongs
+// to. The sink may take the samples by swapping them out of the list, and
+// returns false once the rest of the load is no longer wanted.
+class TensorField;
+typedef std::function<bool(TensorField*, SampleList&)> SampleSink;
+
+// One published version of a field's splats: a prepared store that is never
+// changed again, freed once the last thread reading it lets go.
+typedef std::shared_ptr<const SplatStore> FieldSnapshot;
+
+class BrickCache;
+class NiftiVolume;
+
+/******************************************************************************
+*                                                                             *
+*                                  TensorField      (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  x_size                                                                     *
+*           The number of tensors aligned on the x-axis.                      *
+*  y_size                                                                     *
+*           The number of tensors aligned on the y-axis.                      *
+*  z_size                                                                     *
+*           The number of tensors aligned on the z-axis.                      *
+*  store                                                                      *
+*           The splats of the field, indexed by voxel (unused by a bricked    *
+*           field, whose splats live in its cache's store).                   *
+*  sink                                                                       *
+*           While the field is loading, where its slabs of samples go. When   *
+*           empty, the samples are turned into splats straight away.          *
+*  bricks                                                                     *
+*           For a field too large to hold in memory, the cache its splats are *
+*           paged in from a slice at a time; otherwise NULL.                  *
+*  voxel_to_world                                                             *
+*           Transform from voxel index to world position (the header's sform) *
+*           that the field's splats were placed with.                         *
+*  compact_splats                                                             *
+*           Whether fields created from now on keep their splats in compact   *
+*           form (see SplatStore).                                            *
+*  published                                                                  *
+*           Latest version of the splats, or NULL while the field loads. Only *
+*           read and replaced through the atomic shared_ptr functions.        *
+*  drawn                                                                      *
+*           Version the slice list was last filled from, kept alive until the *
+*           list is refilled (GL thread only).                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Class representing a field of tensor splats. While it loads its splats are *
+*  in store and change only on the GL thread. Once loaded they move into a    *
+*  published snapshot, and every later version is published the same way,     *
+*  read-copy-update style: any thread may take the latest snapshot and read   *
+*  it without locks, or build a new version from it and publish that, while   *
+*  the renderer keeps drawing the version it holds until it next fills its    *
+*  slices. A version is freed when no thread holds it any longer.             *
+*                                                                             *
+*******************************************************************************/
+class TensorField {
+
+public:
+
+	// Size of the field.
+	GLuint x_size;
+	GLuint y_size;
+	GLuint z_size;
+
+	// Splats of the field.
+	SplatStore store;
+
+	// Destination of loaded samples, and whether it has declined the rest.
+	SampleSink sink;
+	bool cancelled;
+
+	// Out-of-core storage.
+	BrickCache* bricks;
+
+	// Voxel to world transform.
+	glm::mat4 voxel_to_world;
+
+	// Store the splats of new fields in compact form.
+	static bool compact_splats;
+
+	// Constructors. A bricked field takes ownership of its cache.
+	TensorField(GLuint x, GLuint y, GLuint z);
+	TensorField(BrickCache* bricks);
+	TensorField(const TensorField& other);
+	TensorField& operator=(const TensorField& rhs);
+
+	// Deallocate memory.
+	void cleanUp();
+
+	// The store the slots of this field's slice lists refer to.
+	const SplatStore& get_store() const;
+
+	// The latest published version of the splats, or NULL until the field
+	// has loaded (and always for a bricked field). Any thread.
+	FieldSnapshot snapshot() const;
+
+	// Move the loaded splats into the first version, in Morton order (any
+	// thread, once the load is complete), copying them if store is still
+	// being drawn.
+	void publish(bool keep_store = false);
+
+	// Publish a prepared version derived from base, unless another has been
+	// published since base was taken; true if it was. Any thread.
+	bool publish(const FieldSnapshot& base, const FieldSnapshot& derived);
+
+	// Whether the latest version is laid out for drawing a view, and if not,
+	// derive one that is and publish it; true if it was. Any thread.
+	bool is_laid_out(GLuint view_plane) const;
+	bool relayout(GLuint view_plane);
+
+	// Whether a newer version has been published than the one the slice
+	// list was filled from (GL thread).
+	bool is_stale() const;
+
+	// Create splats for loader output (must run on the GL thread).
+	void add_samples(const SampleList& samples);
+	void add_samples(const TensorSample* samples, size_t count,
+		const SplatInverse* inverses = NULL);
+
+	// Hand loader output to the sink, or create its splats if there is none.
+	// False once the sink has declined the rest of the load, which the
+	// loader then abandons; is_wanted() asks between slabs it does not submit.
+	bool submit_samples(SampleList& samples);
+	bool is_wanted();
+
+	// Create an empty field for a loader and announce it to the sink, and
+	// dispose of one whose load failed.
+	static TensorField* create(GLuint x, GLuint y, GLuint z,
+		const glm::mat4& voxel_to_world, const SampleSink& sink);
+	static TensorField* abandon(TensorField* tf);
+
+	// Point every slice of a view at its splats. The list is valid until the
+	// field changes or is asked for another view.
+	void get_slices(SliceList& splats, GLuint view_plane, GLfloat threshold);
+
+	// Fill a slice of a bricked field, a few bricks per call; true once it
+	// is complete. Fields held in memory fill every slice in get_slices.
+	bool get_slice(SliceList& splats, GLuint view_plane, GLfloat threshold, GLuint slice);
+	static TensorField* read_nifti_file(const std::string nifti_file_path,
+		GLuint index = 0, const SampleSink& sink = SampleSink());
+	static TensorField* TensorField::read_eig_file(const std::string nifti_file_path,
+		std::string eig_file_path, GLuint load_mode = EIG_LOAD_MAPPED, GLuint index = 0,
+		const SampleSink& sink = SampleSink());
+
+	// Read the six eigenvalue / eigenvector files of an FSL dtifit run, given
+	// its output basename, and find them.
+	static TensorField* read_dtifit_files(const std::string& basename,
+		const SampleSink& sink = SampleSink());
+	static bool find_dtifit_files(const std::string& basename,
+		std::vector<std::string>& paths);
+
+	// As read_eig_file, for a header already read and bypassing the splat
+	// cache.
+	static TensorField* read_eig_uncached(const NiftiVolume& volume,
+		const std::string& eig_file_path, GLuint load_mode, GLuint index,
+		const SampleSink& sink = SampleSink());
+
+	// Open one volume as a bricked field, building its brick file with
+	// read_eig_file (or read_nifti_file or read_dtifit_files, if eig_file_path
+	// is empty) first if needed. Does not touch GL state, so it may run on a
+	// loader thread.
+	static TensorField* read_bricked(const std::string& nifti_file_path,
+		const std::string& eig_file_path, GLuint index, size_t cache_bytes);
+
+private:
+
+	FieldSnapshot published;
+	FieldSnapshot drawn;
+
+};
+
@@ -0,0 +1,234 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "ThreadPool.h"
+#include <algorithm>
+
+/******************************************************************************
+*                                                                             *
+*                          ThreadPool::ThreadPool                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  num_threads                                                                *
+*           Total number of threads a job runs on, including the caller. Zero *
+*           uses std::thread::hardware_concurrency().                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the ThreadPool object. Starts the worker threads,   *
+*  which sleep until a job is submitted.                                      *
+*                                                                             *
+*******************************************************************************/
+ThreadPool::ThreadPool(unsigned num_threads) :
+job(NULL), job_first(0), ranges(thread_count(num_threads)), active(0), generation(0),
+stopping(false)
+{
+	for (size_t t = 0; t < ranges.size(); t++)
+		ranges[t].items = 0;
+	for (size_t t = 1; t < ranges.size(); t++)
+		workers.push_back(std::thread(&ThreadPool::worker_loop, this, (unsigned)t - 1));
+}
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ThreadPool::thread_count                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  num_threads, or one per hardware thread when that is zero.                 *
+*                                                                             *
+*******************************************************************************/
+unsigned ThreadPool::thread_count(unsigned num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::thread::hardware_concurrency();
+	if (num_threads == 0)
+		num_threads = 1;
+	return num_threads;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              ThreadPool::shared                             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The process-wide pool, created on first use.                               *
+*                                                                             *
+*******************************************************************************/
+ThreadPool& ThreadPool::shared()
+{
+	static std::once_flag once;
+	static ThreadPool* pool = NULL;
+	std::call_once(once, []() { pool = new ThreadPool(); });
+	return *pool;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ThreadPool::parallel_for                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  count                                                                      *
+*           Number of items to run.                                           *
+*  body                                                                       *
+*           Function called once with each item index in [0, count).          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Runs every item across the workers and the calling thread, and returns     *
+*  once all of them have finished. Which thread runs an item is unspecified,  *
+*  so bodies must only write to state owned by their own index. Thread t      *
+*  starts on the t-th contiguous share of the items, so neighbouring items    *
+*  tend to run on the same thread.                                            *
+*                                                                             *
+*******************************************************************************/
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	// Small jobs are not worth waking anyone for.
+	if (count == 1 || workers.empty())
+	{
+		for (size_t index = 0; index < count; index++)
+			body(index);
+		return;
+	}
+
+	// Runs hold 32-bit item numbers, so a larger job goes in parts.
+	std::lock_guard<std::mutex> submit(submit_mutex);
+	for (size_t first = 0; first < count; first += POOL_MAX_ITEMS)
+	{
+		uint64_t part = std::min(count - first, (size_t)POOL_MAX_ITEMS);
+		unsigned threads = size();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &body;
+			job_first = first;
+			for (unsigned t = 0; t < threads; t++)
+				ranges[t].items = ((part * t / threads) << 32) | (part * (t + 1) / threads);
+			active = (unsigned)workers.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		// The caller works too.
+		run_items(threads - 1);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (active != 0)
+			done.wait(lock);
+		job = NULL;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ThreadPool::run_items                            *
+*                                                                             *
+*******************************************************************************/
+void ThreadPool::run_items(unsigned self)
+{
+	for (;;)
+	{
+		uint32_t item;
+		if (claim(self, item))
+			(*job)(job_first + item);
+		else if (!steal(self))
+			return;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          ThreadPool::claim / steal                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Both change a run with a compare-and-swap of its first and end together,   *
+*  so an owner taking from the front and a thief taking from the back never   *
+*  both get the same item. A thief only writes its own run once it is empty,  *
+*  when no other thread will touch it. Once a sweep of every other run finds  *
+*  nothing the thread is done; items are never added to a job once started.   *
+*                                                                             *
+*******************************************************************************/
+bool ThreadPool::claim(unsigned self, uint32_t& item)
+{
+	std::atomic<uint64_t>& run = ranges[self].items;
+	uint64_t items = run.load();
+	for (;;)
+	{
+		uint32_t first = (uint32_t)(items >> 32), end = (uint32_t)items;
+		if (first >= end)
+			return false;
+		if (run.compare_exchange_weak(items, ((uint64_t)(first + 1) << 32) | end))
+		{
+			item = first;
+			return true;
+		}
+	}
+}
+bool ThreadPool::steal(unsigned self)
+{
+	unsigned threads = size();
+	for (unsigned n = 1; n < threads; n++)
+	{
+		std::atomic<uint64_t>& victim = ranges[(self + n) % threads].items;
+		uint64_t items = victim.load();
+		for (;;)
+		{
+			uint32_t first = (uint32_t)(items >> 32), end = (uint32_t)items;
+			if (first >= end)
+				break;
+			uint32_t middle = first + ((end - first) / 2);
+			if (victim.compare_exchange_weak(items, ((uint64_t)first << 32) | middle))
+			{
+				ranges[self].items = ((uint64_t)middle << 32) | end;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ThreadPool::worker_loop                           *
+*                                                                             *
+*******************************************************************************/
+void ThreadPool::worker_loop(unsigned self)
+{
+	unsigned long seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping && generation == seen)
+				wake.wait(lock);
+			if (stopping)
+				return;
+			seen = generation;
+		}
+
+		run_items(self);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--active == 0)
+			done.notify_one();
+	}
+}
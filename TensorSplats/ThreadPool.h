@@ -0,0 +1,132 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <memory>
+#include <stdint.h>
+#include "AlignedAllocator.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define CACHE_LINE_BYTES        64
+#define POOL_MAX_ITEMS          0xFFFFFFFFu
+
+// Aligns a type to a cache line (VS2013 has no alignas).
+#ifdef _MSC_VER
+#define CACHE_ALIGNED           __declspec(align(CACHE_LINE_BYTES))
+#else
+#define CACHE_ALIGNED           alignas(CACHE_LINE_BYTES)
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                                 WorkRange     (struct)                      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  One thread's run of unclaimed items, aligned and padded to a cache line of *
+*  its own so that claims by one thread do not slow down those by its         *
+*  neighbours. Arrays of them must come from a cache-line AlignedAllocator.   *
+*                                                                             *
+*******************************************************************************/
+struct CACHE_ALIGNED WorkRange
+{
+
+	std::atomic<uint64_t>  items;
+	char                   padding[CACHE_LINE_BYTES - sizeof(std::atomic<uint64_t>)];
+
+};
+
+// Runs of a pool, one per cache line.
+typedef std::vector<WorkRange, AlignedAllocator<WorkRange, CACHE_LINE_BYTES> > WorkRanges;
+
+/******************************************************************************
+*                                                                             *
+*                                  ThreadPool       (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  workers                                                                    *
+*           Persistent worker threads (the caller is the extra thread).       *
+*  job                                                                        *
+*           Body of the parallel_for currently running, or NULL.              *
+*  ranges                                                                     *
+*           Items of the current job not yet claimed, one run per thread      *
+*           (the caller's last), each packed into 64 bits as first | end.     *
+*  active                                                                     *
+*           Number of workers that have not yet finished the current job.     *
+*  generation                                                                 *
+*           Incremented for every job so sleeping workers notice new work.    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Fixed set of threads which run fork-join loops. A job's items are split    *
+*  into one contiguous run per thread. Each thread claims items one at a time *
+*  from the front of its own run, and once that is empty steals the back half *
+*  of another's, so uneven items balance themselves without every claim       *
+*  going through one shared counter. Only one job runs at a time and          *
+*  parallel_for must not be called from inside a body.                        *
+*                                                                             *
+*******************************************************************************/
+class ThreadPool
+{
+
+public:
+
+	// Constructors. Zero threads means one per hardware thread.
+	explicit ThreadPool(unsigned num_threads = 0);
+	~ThreadPool();
+
+	// Pool shared by the loaders.
+	static ThreadPool& shared();
+
+	// Number of threads a job runs on, including the caller.
+	unsigned size() const                   {  return (unsigned)workers.size() + 1;  }
+
+	// Run body(0) ... body(count - 1) across the pool and wait for them all.
+	void parallel_for(size_t count, const std::function<void(size_t)>& body);
+
+private:
+
+	std::vector<std::thread>                  workers;
+	std::mutex                                submit_mutex;
+	std::mutex                                mutex;
+	std::condition_variable                   wake;
+	std::condition_variable                   done;
+	const std::function<void(size_t)>*        job;
+	size_t                                    job_first;
+	WorkRanges                                ranges;
+	unsigned                                  active;
+	unsigned long                             generation;
+	bool                                      stopping;
+
+	// Claim and run items of the current job, from the thread's own run and
+	// then from others', until none remain.
+	void run_items(unsigned self);
+	void worker_loop(unsigned self);
+
+	// Take the first item of a thread's run, or the back half of another
+	// thread's run as its own; false if there is nothing to take.
+	bool claim(unsigned self, uint32_t& item);
+	bool steal(unsigned self);
+
+	// Number of threads to run on when num_threads are asked for.
+	static unsigned thread_count(unsigned num_threads);
+
+	// Pools are not copyable.
+	ThreadPool(const ThreadPool& other);
+	ThreadPool& operator=(const ThreadPool& other);
+
+};
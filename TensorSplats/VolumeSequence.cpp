@@ -0,0 +1,344 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cstdio>
+#include "VolumeSequence.h"
+
+/******************************************************************************
+*                                                                             *
+*                        VolumeSequence::VolumeSequence                       *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  load                                                                       *
+*           Loader for a single volume, which must route its output through   *
+*           the sink it is passed.                                            *
+*  num_volumes                                                                *
+*           Number of volumes in the series.                                  *
+*  max_resident                                                               *
+*           Most volumes to hold in memory at once. At least two are needed   *
+*           to prefetch while a volume is shown.                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Public constructor for the VolumeSequence object. The first volume starts  *
+*  loading on the first call to update().                                     *
+*                                                                             *
+*******************************************************************************/
+VolumeSequence::VolumeSequence(const VolumeLoad& load, GLuint num_volumes,
+	GLuint max_resident) :
+load(load), max_resident(max_resident), resident(num_volumes, (TensorField*)NULL),
+failed(num_volumes, false), loader(NULL), loading(0), requested(0), step(1),
+shown(0), shown_field(NULL), view(ALL), derived(false)
+{
+	if (this->max_resident < MIN_RESIDENT_VOLUMES)
+		this->max_resident = MIN_RESIDENT_VOLUMES;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       VolumeSequence::~VolumeSequence                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Waits for any load in progress and frees every field, including the one    *
+*  being shown. Must run on the GL thread.                                    *
+*                                                                             *
+*******************************************************************************/
+VolumeSequence::~VolumeSequence()
+{
+	stop_relayout();
+	if (loader != NULL)
+	{
+		// Once stopped, a last poll hands over whatever field was started.
+		loader->stop();
+		loader->poll();
+		TensorField* partial = loader->get_field();
+		delete loader;
+		free_field(partial);
+	}
+
+	for (GLuint v = 0; v < resident.size(); v++)
+		free_field(resident[v]);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           VolumeSequence::request                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  index                                                                      *
+*           Volume to show. Out of range indices are ignored.                 *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Records the volume the viewer wants. It is shown by update() as soon as it *
+*  is resident, and the direction of the change decides which neighbour is    *
+*  prefetched next.                                                           *
+*                                                                             *
+*******************************************************************************/
+void VolumeSequence::request(GLuint index)
+{
+	if (index >= resident.size() || index == requested)
+		return;
+
+	// A step back from the first volume to the last still counts as backward.
+	GLuint last = (GLuint)resident.size() - 1;
+	if (requested == 0 && index == last)
+		step = -1;
+	else if (requested == last && index == 0)
+		step = 1;
+	else
+		step = (index > requested) ? 1 : -1;
+	requested = index;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            VolumeSequence::update                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  budget_ms                                                                  *
+*           Time to spend creating splats for the volume being loaded.        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the field to draw has changed, gained splats or published a new    *
+*  version, in which case the caller should rebuild its slices.               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Called once a frame on the GL thread. The first volume is drawn as it      *
+*  fills; every later one is only shown once it is complete. When no load is  *
+*  running, the requested volume is loaded if it is not resident, and         *
+*  otherwise its neighbour in the direction of travel is prefetched.          *
+*                                                                             *
+*******************************************************************************/
+bool VolumeSequence::update(GLuint budget_ms)
+{
+	bool changed = false;
+
+	if (loader != NULL)
+	{
+		size_t added = loader->poll(budget_ms);
+
+		// Nothing is on screen yet, so draw the first volume as it arrives.
+		if (shown_field == NULL && loader->get_field() != NULL)
+		{
+			shown = loading;
+			shown_field = loader->get_field();
+			changed = true;
+		}
+		else if (added > 0 && shown_field == loader->get_field())
+		{
+			changed = true;
+		}
+
+		// Once every splat is in, the worker sorts and publishes the field,
+		// copying it if it is being drawn, and it is renumbered after that.
+		if (loader->is_complete())
+			loader->publish(shown_field == loader->get_field());
+		if (loader->is_done())
+		{
+			TensorField* partial = shown_field;
+			bool drawn = (shown_field == loader->get_field());
+			finish();
+			changed = changed || drawn || (shown_field != partial);
+		}
+	}
+
+	// Switch as soon as the requested volume is resident.
+	if (requested != shown && resident[requested] != NULL)
+	{
+		shown = requested;
+		shown_field = resident[requested];
+		touch(shown);
+		changed = true;
+	}
+
+	// Another thread may have published a new version of the shown field.
+	if (shown_field != NULL && shown_field->is_stale())
+		changed = true;
+
+	if (loader == NULL)
+	{
+		GLuint next = (resident[requested] == NULL) ? requested : next_prefetch();
+		if (resident[next] == NULL && !failed[next] && make_room())
+			start(next);
+	}
+
+	relayout();
+	return changed;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            VolumeSequence::start                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Begins loading a volume on a new background loader.                        *
+*                                                                             *
+*******************************************************************************/
+void VolumeSequence::start(GLuint index)
+{
+	VolumeLoad load = this->load;
+
+	loading = index;
+	loader = new FieldLoader();
+	loader->start([load, index](const SampleSink& sink)
+	{
+		return load(index, sink);
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                            VolumeSequence::finish                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Takes the field of a finished load. A complete field, which the loader has *
+*  published in Morton order, becomes resident; a failed one is freed and its *
+*  volume is not tried again.                                                 *
+*                                                                             *
+*******************************************************************************/
+void VolumeSequence::finish()
+{
+	TensorField* tf = loader->get_field();
+	bool ok = !loader->has_failed();
+	delete loader;
+	loader = NULL;
+
+	if (ok)
+	{
+		resident[loading] = tf;
+		touch(loading);
+		return;
+	}
+
+	fprintf(stderr, "Volume %u could not be loaded.\n", loading);
+	failed[loading] = true;
+	if (shown_field == tf)
+		shown_field = NULL;
+	free_field(tf);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             VolumeSequence::touch                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Marks a resident volume as the most recently used.                         *
+*                                                                             *
+*******************************************************************************/
+void VolumeSequence::touch(GLuint index)
+{
+	lru.remove(index);
+	lru.push_back(index);
+}
+
+/******************************************************************************
+*                                                                             *
+*                          VolumeSequence::relayout                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reaps a finished deriver, and starts one if the shown field is not laid    *
+*  out for the view. The deriver only reads the published version and         *
+*  publishes another, so the GL thread goes on drawing throughout; the new    *
+*  version shows up as a change in a later update. stop_relayout waits for    *
+*  it, and must be called before a field it may be deriving is freed.         *
+*                                                                             *
+*******************************************************************************/
+void VolumeSequence::relayout()
+{
+	if (deriver.joinable() && derived.load(std::memory_order_acquire))
+		deriver.join();
+	if (deriver.joinable() || shown_field == NULL || shown_field->is_laid_out(view))
+		return;
+
+	TensorField* tf = shown_field;
+	GLuint view_plane = view;
+	derived.store(false, std::memory_order_relaxed);
+	deriver = std::thread([this, tf, view_plane]()
+	{
+		tf->relayout(view_plane);
+		derived.store(true, std::memory_order_release);
+	});
+}
+void VolumeSequence::stop_relayout()
+{
+	if (deriver.joinable())
+		deriver.join();
+}
+
+/******************************************************************************
+*                                                                             *
+*                        VolumeSequence::next_prefetch                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The neighbour of the requested volume in the direction of travel, wrapping *
+*  around the ends of the series.                                             *
+*                                                                             *
+*******************************************************************************/
+GLuint VolumeSequence::next_prefetch() const
+{
+	GLint count = (GLint)resident.size();
+	return (GLuint)(((GLint)requested + step + count) % count);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           VolumeSequence::make_room                         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether another volume may be loaded without exceeding max_resident.       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Frees least recently shown volumes until there is room for one more. The   *
+*  shown and requested volumes are never freed.                               *
+*                                                                             *
+*******************************************************************************/
+bool VolumeSequence::make_room()
+{
+	std::list<GLuint>::iterator it = lru.begin();
+	while (lru.size() + 1 > max_resident)
+	{
+		while (it != lru.end() && (*it == shown || *it == requested))
+			++it;
+		if (it == lru.end())
+			return false;
+
+		stop_relayout();
+		free_field(resident[*it]);
+		resident[*it] = NULL;
+		it = lru.erase(it);
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          VolumeSequence::free_field                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Deletes a field and its splats (GL thread only).                           *
+*                                                                             *
+*******************************************************************************/
+void VolumeSequence::free_field(TensorField* tf)
+{
+	if (tf == NULL)
+		return;
+	tf->cleanUp();
+	delete tf;
+}
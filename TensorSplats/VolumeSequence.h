@@ -0,0 +1,133 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <list>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include "TensorSplat.h"
+#include "FieldLoader.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define DEFAULT_RESIDENT_VOLUMES  3
+#define MIN_RESIDENT_VOLUMES      2
+
+// Loads one volume of a series through the given sink.
+typedef std::function<TensorField*(GLuint, const SampleSink&)> VolumeLoad;
+
+/******************************************************************************
+*                                                                             *
+*                                 VolumeSequence    (class)                   *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  load                                                                       *
+*           Loader for a single volume.                                       *
+*  max_resident                                                               *
+*           Most volumes held in memory at once, counting the one loading.    *
+*  resident                                                                   *
+*           Fully loaded field of each volume, or NULL.                       *
+*  lru                                                                        *
+*           Resident volumes, least recently shown first.                     *
+*  failed                                                                     *
+*           Volumes whose load has failed; they are not tried again.          *
+*  loader                                                                     *
+*           Background load in progress, or NULL.                             *
+*  loading                                                                    *
+*           Volume the loader is reading.                                     *
+*  requested                                                                  *
+*           Volume the viewer wants to see.                                   *
+*  step                                                                       *
+*           Direction of the last change of request, +1 or -1, which decides  *
+*           the volume to prefetch.                                           *
+*  shown                                                                      *
+*           Volume currently drawn.                                           *
+*  shown_field                                                                *
+*           Field currently drawn, or NULL before the first volume arrives.   *
+*  view                                                                       *
+*           View the field is drawn in, which it is laid out for.             *
+*  deriver                                                                    *
+*           Thread relaying out the shown field for the view, if running.     *
+*  derived                                                                    *
+*           Set by the deriver once it has returned.                          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Plays back the volumes of a 4-D tensor series, one at a time. The volume   *
+*  being viewed stays resident while the next one in the direction of travel  *
+*  is parsed on a background thread and its splats are created a few at a     *
+*  time each frame, so stepping to it is a pointer swap rather than a load.   *
+*  At most max_resident volumes are kept; the least recently shown is freed   *
+*  to make room for a prefetch. Whenever the shown field is not laid out for  *
+*  the view, a version that is is derived and published on a thread of its    *
+*  own while the current one is drawn.                                        *
+*                                                                             *
+*******************************************************************************/
+class VolumeSequence
+{
+
+public:
+
+	// Constructors. Destroying a sequence frees every field it loaded.
+	VolumeSequence(const VolumeLoad& load, GLuint num_volumes,
+		GLuint max_resident = DEFAULT_RESIDENT_VOLUMES);
+	~VolumeSequence();
+
+	// Ask for a volume to be shown as soon as it is loaded.
+	void request(GLuint index);
+
+	// Set the view the field is drawn in (AXIAL ... ALL).
+	void set_view(GLuint view_plane)        {  view = view_plane;             }
+
+	// Advance loading and switching for up to budget_ms (GL thread only).
+	// Returns true if the field to draw has changed, gained splats or been
+	// given a new version.
+	bool update(GLuint budget_ms = LOADER_FRAME_BUDGET_MS);
+
+	// Getters.
+	TensorField*  get_field() const         {  return shown_field;            }
+	GLuint        get_shown() const         {  return shown;                  }
+	GLuint        size() const              {  return (GLuint)resident.size();}
+	bool          has_failed(GLuint i) const{  return failed[i];              }
+
+private:
+
+	VolumeLoad                 load;
+	GLuint                     max_resident;
+	std::vector<TensorField*>  resident;
+	std::list<GLuint>          lru;
+	std::vector<bool>          failed;
+	FieldLoader*               loader;
+	GLuint                     loading;
+	GLuint                     requested;
+	GLint                      step;
+	GLuint                     shown;
+	TensorField*               shown_field;
+	GLuint                     view;
+	std::thread                deriver;
+	std::atomic<bool>          derived;
+
+	// Helpers.
+	void start(GLuint index);
+	void finish();
+	void touch(GLuint index);
+	void relayout();
+	void stop_relayout();
+	GLuint next_prefetch() const;
+	bool make_room();
+	static void free_field(TensorField* tf);
+
+	// Sequences are not copyable.
+	VolumeSequence(const VolumeSequence& other);
+	VolumeSequence& operator=(const VolumeSequence& other);
+
+};
@@ -1,37 +1,89 @@
-#version 130
-
-precision highp float;
-
-// Transformation data.
-uniform   mat4  model_to_projection;
-uniform   mat4  model_to_world;
-uniform   vec3  C_0;
-uniform vec4  eye_position;
-
-varying   vec4  out_position;
-varying   vec4  out_eye_position;
-varying   vec3  A_0_inter;
-varying   vec3  A_1_inter;
-varying   vec3  A_2_inter;
-varying   vec3  A_3_inter;
-varying   vec2  tex_coord;
-
-attribute vec3  A_0;
-attribute vec3  A_1;
-attribute vec3  A_2;
-attribute vec3  A_3;
-
-void main()
-{
-	out_position = model_to_world * vec4(A_0 + C_0, 1.0);
-	out_eye_position = model_to_world * eye_position;
-
-	A_0_inter = A_0;
-	A_1_inter = A_1;
-	A_2_inter = A_2;
-	A_3_inter = A_3;
-
-	tex_coord = 0.5 * vec2(A_1.x + 1.0, A_1.y + 1.0);
-
-	gl_Position = model_to_projection * vec4(A_0 + C_0, 1.0);
-}
+#version 130
+
+precision highp float;
+
+// Transformation data.
+uniform   mat4  model_to_projection;
+uniform   mat4  model_to_world;
+uniform   vec3  C_0;
+uniform vec4  eye_position;
+
+// Expand each splat here from its instance attributes, rather than take
+// the quad the CPU built.
+uniform   bool  instanced;
+uniform   vec3  up;
+
+// Point the A_0 of each vertex from the CPU is relative to: the eye its quad
+// was expanded for, or one shared by quads expanded for different eyes.
+uniform   vec3  origin;
+
+varying   vec4  out_position;
+varying   vec4  out_eye_position;
+varying   vec3  A_0_inter;
+varying   vec3  A_1_inter;
+varying   vec3  A_2_inter;
+varying   vec3  A_3_inter;
+varying   vec2  tex_coord;
+varying   vec4  splat_color;
+
+// Per vertex, from the CPU.
+attribute vec3  A_0;
+attribute vec3  A_1;
+attribute vec3  A_2;
+attribute vec3  A_3;
+attribute vec4  color;
+
+// Per instance.
+attribute vec3  center;
+attribute mat3  tensor;
+attribute mat3  tensor_inv;
+attribute mat3  tensor_inv_sq;
+
+// Corners of the bounding quad, in the order the CPU emits them.
+const vec2 corners[4] = vec2[4](vec2(+1.0, +1.0), vec2(+1.0, -1.0),
+                                vec2(-1.0, -1.0), vec2(-1.0, +1.0));
+
+void main()
+{
+	vec3 a_0 = A_0 + (origin - C_0);
+	vec3 a_1 = A_1;
+	vec3 a_2 = A_2;
+	vec3 a_3 = A_3;
+
+	// The steps of TensorSplat::recalculate, for this vertex's corner.
+	if (instanced)
+	{
+		vec2  corner     = corners[gl_VertexID];
+		vec3  e_tilda    = tensor_inv * (C_0 - center);
+		vec3  up_tilda   = tensor_inv * up;
+		vec3  z_hat      = -normalize(e_tilda);
+		vec3  y_hat      =  normalize(up_tilda);
+		vec3  x_hat      =  normalize(cross(z_hat, y_hat));
+		float mu         = 1.0 / length(e_tilda);
+		float mu_squared = mu * mu;
+		vec3  m_tilda    = mu_squared * e_tilda;
+		float r_tilda    = sqrt(1.0 - mu_squared);
+
+		vec3 m = (tensor * m_tilda) + center;
+		vec3 x = tensor * x_hat * (r_tilda * 2.0);
+		vec3 y = tensor * y_hat * (r_tilda * 2.0);
+
+		a_0 = (m - C_0) + ((corner.x * x) + (corner.y * y));
+		a_1 = vec3(corner, mu);
+		a_2 = tensor_inv_sq * (C_0 - center);
+		a_3 = tensor_inv_sq * a_0;
+	}
+
+	out_position = model_to_world * vec4(a_0 + C_0, 1.0);
+	out_eye_position = model_to_world * eye_position;
+
+	A_0_inter = a_0;
+	A_1_inter = a_1;
+	A_2_inter = a_2;
+	A_3_inter = a_3;
+
+	tex_coord = 0.5 * vec2(a_1.x + 1.0, a_1.y + 1.0);
+	splat_color = color;
+
+	gl_Position = model_to_projection * vec4(a_0 + C_0, 1.0);
+}